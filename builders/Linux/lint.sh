@@ -10,7 +10,7 @@ MEDIAFX_BUILD=${BUILD_ROOT}/${BUILD_TYPE}
 mkdir -p "${MEDIAFX_BUILD}"
 cmake -S "${SOURCE_ROOT}" -B "$MEDIAFX_BUILD" -DCMAKE_EXPORT_COMPILE_COMMANDS=ON -DCMAKE_BUILD_TYPE=${BUILD_TYPE} --install-prefix ${QTDIR} || exit 1
 # Generate *.moc include files for tests
-cmake --build "${MEDIAFX_BUILD}" --target tst_encoder_autogen/fast tst_decoder_autogen/fast tst_interval_autogen/fast || exit 1
+cmake --build "${MEDIAFX_BUILD}" --target tst_encoder_autogen/fast tst_decoder_autogen/fast tst_interval_autogen/fast tst_tracer_autogen/fast tst_latencyhistogram_autogen/fast tst_memoryaccounting_autogen/fast tst_renderjob_autogen/fast tst_framecache_autogen/fast tst_imageclip_autogen/fast tst_numberedimageclip_autogen/fast tst_videoitem_autogen/fast tst_renderserver_autogen/fast tst_framering_autogen/fast || exit 1
 
 cd /mediafx
 git config --global --add safe.directory /mediafx
@@ -0,0 +1,18 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import QtQuick
+import MediaFX.Transition
+
+/*!
+    \qmltype NumberedImageSequenceClip
+    \inqmlmodule MediaFX
+    \inherits NumberedImageClip
+    \brief NumberedImageClip type that can be used with MediaSequence.
+*/
+NumberedImageClip {
+    /*! The \l MediaTransition to use at the end of this clip to transition to the next clip. */
+    property MediaTransition endTransition
+    /*! A \l Transformer to transform the video */
+    property Transformer transformer
+}
@@ -0,0 +1,18 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import QtQuick
+import MediaFX.Transition
+
+/*!
+    \qmltype StillSequenceClip
+    \inqmlmodule MediaFX
+    \inherits ImageClip
+    \brief ImageClip type that can be used with MediaSequence.
+*/
+ImageClip {
+    /*! The \l MediaTransition to use at the end of this clip to transition to the next clip. */
+    property MediaTransition endTransition
+    /*! A \l Transformer to transform the video */
+    property Transformer transformer
+}
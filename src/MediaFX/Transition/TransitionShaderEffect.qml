@@ -2,25 +2,45 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 import QtQuick
+import MediaFX
 
 /*!
     \qmltype TransitionShaderEffect
     \inherits ShaderEffect
     \inqmlmodule MediaFX.Transition
     \brief \l MediaTransition subclasses that internally use a \l ShaderEffect should use a subclass of this class.
+
+    Plain \l {VideoRenderer}s are sampled directly using \l VideoTexture,
+    other items are rendered into a ShaderEffectSource layer.
 */
 ShaderEffect {
     id: root
 
-    property alias source: sourceEffect
-    property alias sourceItem: sourceEffect.sourceItem
-    property alias dest: destEffect
-    property alias destItem: destEffect.sourceItem
+    readonly property Item source: sourceTexture.direct ? sourceTexture : sourceEffect
+    property Item sourceItem
+    readonly property Item dest: destTexture.direct ? destTexture : destEffect
+    property Item destItem
     property real time
     property int textureMirroring: ShaderEffectSource.MirrorVertically
 
+    VideoTexture {
+        id: sourceTexture
+        sourceItem: root.sourceItem
+        mirrorVertically: root.textureMirroring === ShaderEffectSource.NoMirroring
+        visible: false
+        anchors.fill: parent
+    }
+    VideoTexture {
+        id: destTexture
+        sourceItem: root.destItem
+        mirrorVertically: root.textureMirroring === ShaderEffectSource.NoMirroring
+        visible: false
+        anchors.fill: parent
+    }
     ShaderEffectSource {
         id: sourceEffect
+        // Only layer the source if it can not be sampled directly
+        sourceItem: sourceTexture.direct ? null : root.sourceItem
         hideSource: true
         visible: false
         smooth: true
@@ -29,6 +49,7 @@ ShaderEffect {
     }
     ShaderEffectSource {
         id: destEffect
+        sourceItem: destTexture.direct ? null : root.destItem
         hideSource: true
         visible: false
         smooth: true
@@ -8,13 +8,20 @@ RenderWindow {
     width: RenderContext.frameSize.width
     height: RenderContext.frameSize.height
     renderSession: renderSession
+    renditions: RenderContext.renditions
+    threadedRendering: RenderContext.pipelineDepth > 0
+    pipelineCacheDirectory: RenderContext.shaderCacheDirectory
 
     Component.onCompleted: {
         renderWindow.contentItem.enabled = false;
         renderWindow.frameReady.connect(encoder.encode);
         renderSession.renderScene.connect(renderWindow.render);
+        // The last frame must be emitted before the encoder finishes
+        renderSession.sessionEnded.connect(renderWindow.finishRendering);
         renderSession.sessionEnded.connect(encoder.finish);
         encoder.encodingError.connect(renderSession.fatalError);
+        if (RenderContext.shaderWarmup)
+            renderWindow.warmUpPipelines();
         renderSession.beginSession();
     }
 
@@ -23,6 +30,10 @@ RenderWindow {
         sourceUrl: RenderContext.sourceUrl
         frameRate: RenderContext.frameRate
         sampleRate: RenderContext.sampleRate
+        pipelineDepth: RenderContext.pipelineDepth
+        framesPerEvent: RenderContext.framesPerEvent
+        reportFileName: RenderContext.reportFileName
+        initialProperties: RenderContext.initialProperties
         anchors.fill: parent
     }
     Encoder {
@@ -31,5 +42,10 @@ RenderWindow {
         frameSize: RenderContext.frameSize
         frameRate: RenderContext.frameRate
         sampleRate: RenderContext.sampleRate
+        renditions: RenderContext.renditions
+        segmentFrames: RenderContext.segmentFrames
+        manifestFileName: RenderContext.manifestFileName
+        pipelineDepth: RenderContext.pipelineDepth
+        fileIO: RenderContext.fileIO
     }
 }
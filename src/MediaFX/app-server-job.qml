@@ -0,0 +1,51 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import QtQuick
+
+// One render server job, created in the server RenderWindow with the job parameters in RenderContext
+Item {
+    id: job
+
+    required property RenderWindow renderWindow
+
+    width: renderWindow.width
+    height: renderWindow.height
+
+    Component.onCompleted: {
+        job.renderWindow.renderSession = renderSession;
+        job.renderWindow.frameReady.connect(encoder.encode);
+        renderSession.renderScene.connect(job.renderWindow.render);
+        // The last frame must be emitted before the encoder finishes
+        renderSession.sessionEnded.connect(job.renderWindow.finishRendering);
+        renderSession.sessionEnded.connect(encoder.finish);
+        encoder.encodingError.connect(renderSession.fatalError);
+        if (RenderContext.shaderWarmup)
+            job.renderWindow.warmUpPipelines();
+        renderSession.beginSession();
+    }
+
+    RenderSession {
+        id: renderSession
+        sourceUrl: RenderContext.sourceUrl
+        frameRate: RenderContext.frameRate
+        sampleRate: RenderContext.sampleRate
+        pipelineDepth: RenderContext.pipelineDepth
+        framesPerEvent: RenderContext.framesPerEvent
+        reportFileName: RenderContext.reportFileName
+        initialProperties: RenderContext.initialProperties
+        anchors.fill: parent
+    }
+    Encoder {
+        id: encoder
+        outputFileName: RenderContext.outputFileName
+        frameSize: RenderContext.frameSize
+        frameRate: RenderContext.frameRate
+        sampleRate: RenderContext.sampleRate
+        renditions: RenderContext.renditions
+        segmentFrames: RenderContext.segmentFrames
+        manifestFileName: RenderContext.manifestFileName
+        pipelineDepth: RenderContext.pipelineDepth
+        fileIO: RenderContext.fileIO
+    }
+}
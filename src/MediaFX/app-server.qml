@@ -0,0 +1,18 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import QtQuick
+
+// Reused by every render server job, each job assigns its own renderSession
+RenderWindow {
+    id: renderWindow
+    width: RenderContext.frameSize.width
+    height: RenderContext.frameSize.height
+    renderSession: null
+    threadedRendering: RenderContext.pipelineDepth > 0
+    pipelineCacheDirectory: RenderContext.shaderCacheDirectory
+
+    Component.onCompleted: {
+        renderWindow.contentItem.enabled = false;
+    }
+}
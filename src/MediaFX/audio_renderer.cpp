@@ -3,6 +3,7 @@
 
 #include "audio_renderer.h"
 #include "render_session.h"
+#include "tracer.h"
 #include <QAudioFormat>
 #include <QObject>
 #include <QPointer>
@@ -109,6 +110,7 @@ void AudioRenderer::addAudioBuffer(QAudioBuffer audioBuffer)
 
 QAudioBuffer AudioRenderer::mix()
 {
+    Tracer::Span span("AudioRenderer::mix");
     // No sound
     if (volume() == 0.0) {
         audioBuffers.clear();
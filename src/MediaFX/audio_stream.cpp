@@ -3,6 +3,7 @@
 
 #include "audio_stream.h"
 #include "formats.h"
+#include "memory_accounting.h"
 #include "util.h"
 #include <QAudioBuffer>
 #include <QAudioFormat>
@@ -97,6 +98,7 @@ int AudioStream::configureBufferSink()
     }
 
     m_outputAudioBuffer = QAudioBuffer(outputAudioFrameCount(), m_outputAudioFormat);
+    m_outputAudioBufferAllocation = MemoryAccounting::Allocation(memoryAccount(), MemoryAccounting::Category::AudioBuffers, m_outputAudioBuffer.byteCount());
 
     return ret;
 }
@@ -126,6 +128,7 @@ void AudioStream::processFrame(AVFrame* frame)
     Stream::processFrame(frame);
     if (!frame) {
         m_outputAudioBuffer = QAudioBuffer();
+        m_outputAudioBufferAllocation = MemoryAccounting::Allocation();
         return;
     }
     // Despite docs, av_buffersink_set_frame_size does not zero pad the last frame. It can be short.
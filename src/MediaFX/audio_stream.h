@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "memory_accounting.h"
 #include "stream.h"
 #include <QAudioBuffer>
 #include <QAudioFormat>
@@ -42,4 +43,5 @@ private:
 
     QAudioFormat m_outputAudioFormat;
     QAudioBuffer m_outputAudioBuffer;
+    MemoryAccounting::Allocation m_outputAudioBufferAllocation;
 };
\ No newline at end of file
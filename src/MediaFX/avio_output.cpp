@@ -0,0 +1,30 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "avio_output.h"
+extern "C" {
+#include <libavformat/avio.h>
+#include <libavutil/mem.h>
+}
+
+AVIOOutput::~AVIOOutput()
+{
+    if (m_context) {
+        av_freep(&m_context->buffer);
+        avio_context_free(&m_context);
+    }
+}
+
+bool AVIOOutput::allocateContext(int bufferSize, bool direct, int (*writePacket)(void*, AVIOWriteBuffer, int))
+{
+    auto* buffer = static_cast<unsigned char*>(av_malloc(bufferSize));
+    if (!buffer)
+        return false;
+    m_context = avio_alloc_context(buffer, bufferSize, 1, this, nullptr, writePacket, nullptr);
+    if (!m_context) {
+        av_free(buffer);
+        return false;
+    }
+    m_context->direct = direct ? 1 : 0;
+    return true;
+}
@@ -0,0 +1,42 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <stdint.h>
+extern "C" {
+#include <libavformat/version.h>
+}
+class QByteArray;
+struct AVIOContext;
+
+#if LIBAVFORMAT_VERSION_MAJOR < 61
+using AVIOWriteBuffer = uint8_t*;
+#else
+using AVIOWriteBuffer = const uint8_t*;
+#endif
+
+// Base for custom AVIOContext output backends used by Muxer in place of avio_open
+class AVIOOutput {
+public:
+    AVIOOutput() = default;
+    AVIOOutput(AVIOOutput&&) = delete;
+    AVIOOutput(const AVIOOutput&) = delete;
+    AVIOOutput& operator=(AVIOOutput&&) = delete;
+    AVIOOutput& operator=(const AVIOOutput&) = delete;
+    virtual ~AVIOOutput();
+
+    AVIOContext* context() const { return m_context; }
+
+    // Video frame that is about to be written, backends may reference it instead of copying
+    virtual void retain(const QByteArray&) { }
+    // Flush all output, the context must not be used afterwards
+    virtual bool finish() = 0;
+
+protected:
+    // direct bypasses the AVIOContext buffer for large writes
+    bool allocateContext(int bufferSize, bool direct, int (*writePacket)(void*, AVIOWriteBuffer, int));
+
+private:
+    AVIOContext* m_context = nullptr;
+};
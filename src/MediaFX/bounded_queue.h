@@ -0,0 +1,103 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <stddef.h>
+#include <utility>
+
+// Fixed capacity FIFO used to hand work between threads.
+// push() blocks while the queue is full, pop() blocks while it is empty.
+// Once closed, push() fails and pop() drains the remaining items then returns nullopt.
+template <class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity)
+        : m_capacity(capacity > 0 ? capacity : 1)
+    {
+    }
+    BoundedQueue(BoundedQueue&&) = delete;
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(BoundedQueue&&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+    ~BoundedQueue() = default;
+
+    bool push(T value)
+    {
+        std::unique_lock lock(m_mutex);
+        m_notFull.wait(lock, [this] { return m_closed || m_queue.size() < m_capacity; });
+        if (m_closed)
+            return false;
+        m_queue.push_back(std::move(value));
+        m_peakSize = std::max(m_peakSize, m_queue.size());
+        lock.unlock();
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    // Blocks until fewer than size items are queued, returns false if closed
+    bool waitUntilSizeBelow(size_t size)
+    {
+        std::unique_lock lock(m_mutex);
+        m_notFull.wait(lock, [this, size] { return m_closed || m_queue.size() < size; });
+        return !m_closed;
+    }
+
+    std::optional<T> pop()
+    {
+        std::unique_lock lock(m_mutex);
+        m_notEmpty.wait(lock, [this] { return m_closed || !m_queue.empty(); });
+        if (m_queue.empty())
+            return std::nullopt;
+        T value(std::move(m_queue.front()));
+        m_queue.pop_front();
+        lock.unlock();
+        m_notFull.notify_one();
+        return value;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_closed = true;
+        }
+        m_notFull.notify_all();
+        m_notEmpty.notify_all();
+    }
+
+    bool isClosed() const
+    {
+        std::lock_guard lock(m_mutex);
+        return m_closed;
+    }
+
+    size_t size() const
+    {
+        std::lock_guard lock(m_mutex);
+        return m_queue.size();
+    }
+
+    size_t capacity() const { return m_capacity; }
+
+    // Largest size() reached since construction
+    size_t peakSize() const
+    {
+        std::lock_guard lock(m_mutex);
+        return m_peakSize;
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+    std::deque<T> m_queue;
+    size_t m_capacity;
+    size_t m_peakSize = 0;
+    bool m_closed = false;
+};
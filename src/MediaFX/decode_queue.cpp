@@ -0,0 +1,146 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "decode_queue.h"
+#include "decoder.h"
+#include "memory_accounting.h"
+#include "memory_governor.h"
+#include "profiler.h"
+#include "tracer.h"
+#include <QAudioBuffer>
+#include <QByteArray>
+#include <QString>
+#include <QVideoFrame>
+#include <QVideoFrameFormat>
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <stdint.h>
+#include <utility>
+using namespace Qt::Literals::StringLiterals;
+
+QVideoFrame DecodeQueue::copyVideoFrame(const QVideoFrame& videoFrame)
+{
+    if (!videoFrame.isValid())
+        return QVideoFrame();
+    QVideoFrame source(videoFrame);
+    QVideoFrame copy(source.surfaceFormat());
+    if (!source.map(QVideoFrame::ReadOnly))
+        return QVideoFrame();
+    if (copy.map(QVideoFrame::WriteOnly)) {
+        Q_ASSERT(copy.mappedBytes(0) == source.mappedBytes(0));
+        std::memcpy(copy.bits(0), source.bits(0), source.mappedBytes(0));
+        copy.unmap();
+    }
+    source.unmap();
+    copy.setStartTime(source.startTime());
+    return copy;
+}
+
+int64_t DecodeQueue::videoFrameBytes(const QVideoFrame& videoFrame)
+{
+    if (!videoFrame.isValid())
+        return 0;
+    const QVideoFrameFormat format = videoFrame.surfaceFormat();
+    // Frames are a single packed RGBA plane, see VideoPixelFormat_Qt
+    return static_cast<int64_t>(format.frameWidth()) * format.frameHeight() * 4; // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+}
+
+QAudioBuffer DecodeQueue::copyAudioBuffer(const QAudioBuffer& audioBuffer)
+{
+    if (!audioBuffer.isValid())
+        return QAudioBuffer();
+    return QAudioBuffer(QByteArray(audioBuffer.constData<char>(), audioBuffer.byteCount()), audioBuffer.format(), audioBuffer.startTime());
+}
+
+DecodeQueue::DecodeQueue(Decoder* decoder, size_t depth)
+    : m_decoder(decoder)
+    , m_queue(depth)
+    , m_thread(&DecodeQueue::run, this)
+{
+    // With pipelineDepth 0 clips decode inline instead
+    Q_ASSERT(depth > 0);
+}
+
+DecodeQueue::~DecodeQueue()
+{
+    m_queue.close();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+namespace {
+
+int64_t frameStartTime(const DecodeQueue::Frame& frame)
+{
+    if (frame.videoFrame.isValid())
+        return frame.videoFrame.startTime();
+    if (frame.audioBuffer.isValid())
+        return frame.audioBuffer.startTime();
+    return -1;
+}
+
+}
+
+std::optional<DecodeQueue::Frame> DecodeQueue::pop()
+{
+    if (Profiler::isEnabled())
+        Profiler::recordQueueDepth(Profiler::Queue::Decode, m_queue.peakSize());
+    std::optional<Frame> frame = m_queue.pop();
+    if (frame) {
+        m_startsIn.store(0, std::memory_order_relaxed);
+        if (int64_t startTime = frameStartTime(*frame); startTime >= 0)
+            m_renderedTime.store(startTime, std::memory_order_relaxed);
+        updateLead();
+    }
+    return frame;
+}
+
+void DecodeQueue::setStartsIn(const microseconds& startsIn)
+{
+    m_startsIn.store(std::max(startsIn, 0us).count(), std::memory_order_relaxed);
+    updateLead();
+}
+
+void DecodeQueue::updateLead()
+{
+    // Frames decoded past the last one rendered, plus the time until the clip starts rendering
+    const int64_t decodedTime = m_decodedTime.load(std::memory_order_relaxed);
+    const int64_t renderedTime = m_renderedTime.load(std::memory_order_relaxed);
+    const int64_t decodedAhead = decodedTime >= 0 && renderedTime >= 0 ? std::max(decodedTime - renderedTime, int64_t(0)) : 0;
+    m_lead.set(microseconds(m_startsIn.load(std::memory_order_relaxed) + decodedAhead));
+}
+
+void DecodeQueue::run()
+{
+    Tracer::setThreadName(u"MediaFX decode"_s);
+    // decode() keeps succeeding past EOF, so this runs until closed
+    while (!m_queue.isClosed()) {
+        // Over the memory limit, the queue furthest ahead of rendering only decodes the frame rendering is waiting for
+        if (m_queue.size() > 0 && m_lead.shouldThrottle()) {
+            MemoryGovernor::recordThrottle();
+            // Nothing more can be given up while waiting, so the next furthest ahead throttles
+            m_lead.set(0us);
+            if (!m_queue.waitUntilSizeBelow(1))
+                return;
+            updateLead();
+        }
+        if (!m_decoder->decode()) {
+            // Frames decoded before the failure are still delivered
+            m_queue.close();
+            return;
+        }
+        Frame frame { copyVideoFrame(m_decoder->outputVideoFrame()), copyAudioBuffer(m_decoder->outputAudioBuffer()) };
+        frame.videoAllocation = MemoryAccounting::Allocation(m_decoder->memoryAccount(), MemoryAccounting::Category::VideoFrames, videoFrameBytes(frame.videoFrame));
+        frame.audioAllocation = MemoryAccounting::Allocation(m_decoder->memoryAccount(), MemoryAccounting::Category::AudioBuffers, frame.audioBuffer.byteCount());
+        if (int64_t startTime = frameStartTime(frame); startTime >= 0) {
+            m_decodedTime.store(startTime, std::memory_order_relaxed);
+            // Until one is rendered, the first frame is the one rendering needs next
+            int64_t noneRendered = -1;
+            m_renderedTime.compare_exchange_strong(noneRendered, startTime, std::memory_order_relaxed);
+        }
+        if (!m_queue.push(std::move(frame)))
+            return;
+        updateLead();
+    }
+}
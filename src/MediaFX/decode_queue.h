@@ -0,0 +1,66 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "bounded_queue.h"
+#include "memory_accounting.h"
+#include "memory_governor.h"
+#include <QAudioBuffer>
+#include <QVideoFrame>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+class Decoder;
+using namespace std::chrono;
+
+// Decodes frames ahead of rendering on a worker thread.
+// The Decoder reuses its output buffers, so each queued frame is a private copy.
+// Frames are produced in the same order they would be by calling Decoder::decode() directly.
+// Over the memory limit, the queue furthest ahead of rendering stops decoding ahead first, see MemoryGovernor.
+class DecodeQueue {
+public:
+    struct Frame {
+        QVideoFrame videoFrame;
+        QAudioBuffer audioBuffer;
+        // Accounts for the copies against the decoder source while queued
+        MemoryAccounting::Allocation videoAllocation {};
+        MemoryAccounting::Allocation audioAllocation {};
+    };
+
+    // The decoder must outlive the DecodeQueue
+    DecodeQueue(Decoder* decoder, size_t depth);
+    DecodeQueue(DecodeQueue&&) = delete;
+    DecodeQueue(const DecodeQueue&) = delete;
+    DecodeQueue& operator=(DecodeQueue&&) = delete;
+    DecodeQueue& operator=(const DecodeQueue&) = delete;
+    ~DecodeQueue();
+
+    // Blocks until the next frame is decoded, returns nullopt if decoding failed
+    std::optional<Frame> pop();
+
+    // How long until rendering needs the first frame, while the clip is preloaded before it starts.
+    // Popping a frame resets this to 0.
+    void setStartsIn(const microseconds& startsIn);
+
+    // Private copies of the decoder output buffers
+    static QVideoFrame copyVideoFrame(const QVideoFrame& videoFrame);
+    static QAudioBuffer copyAudioBuffer(const QAudioBuffer& audioBuffer);
+    static int64_t videoFrameBytes(const QVideoFrame& videoFrame);
+
+private:
+    void run();
+    void updateLead();
+
+    Decoder* m_decoder;
+    BoundedQueue<Frame> m_queue;
+    MemoryGovernor::Lead m_lead;
+    std::atomic<int64_t> m_startsIn = 0;
+    // Start times of the last frames decoded and rendered, -1 until there is one
+    std::atomic<int64_t> m_decodedTime = -1;
+    std::atomic<int64_t> m_renderedTime = -1;
+    std::thread m_thread;
+};
@@ -3,14 +3,22 @@
 
 #include "decoder.h"
 #include "audio_stream.h"
+#include "latency_histogram.h"
+#include "memory_accounting.h"
+#include "profiler.h"
 #include "stream.h"
+#include "tracer.h"
 #include "util.h"
 #include "video_stream.h"
 #include <QChar>
+#include <QDateTime>
+#include <QFileInfo>
 #include <QString>
 #include <chrono>
 #include <errno.h>
 #include <inttypes.h>
+#include <map>
+#include <mutex>
 #include <stddef.h>
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -18,10 +26,12 @@ extern "C" {
 #include <libavfilter/buffersink.h>
 #include <libavfilter/buffersrc.h>
 #include <libavformat/avformat.h>
+#include <libavformat/avio.h>
 #include <libavutil/avutil.h>
 #include <libavutil/error.h>
 #include <libavutil/frame.h>
 #include <libavutil/log.h>
+#include <libavutil/mathematics.h>
 }
 using namespace std::chrono_literals;
 using namespace Qt::Literals::StringLiterals;
@@ -87,6 +97,12 @@ Decoder::~Decoder()
 int Decoder::open(const QString& sourceFile, const AVRational& outputFrameRate, const QAudioFormat& outputAudioFormat, const microseconds& startTime)
 {
     int ret = 0;
+    m_sourceFile = sourceFile;
+    // startTime is frame aligned, so this is the index of the first output frame
+    m_outputFrame = av_rescale(startTime.count(), outputFrameRate.num, int64_t(outputFrameRate.den) * AV_TIME_BASE);
+    m_decodeHistogram = Profiler::clipHistogram(sourceFile);
+    if (!m_memoryAccount)
+        m_memoryAccount = MemoryAccounting::createClipAccount(sourceFile);
 
     AVFormatContext* ctx = nullptr;
     if ((ret = avformat_open_input(&ctx, qUtf8Printable(sourceFile), NULL, NULL)) < 0) {
@@ -102,6 +118,7 @@ int Decoder::open(const QString& sourceFile, const AVRational& outputFrameRate,
 
     std::unique_ptr<VideoStream> videoStream(new VideoStream(outputFrameRate, startTime));
     connect(videoStream.get(), &VideoStream::errorMessage, this, &Decoder::errorMessage);
+    videoStream->setMemoryAccount(m_memoryAccount);
     if ((ret = videoStream->open(formatCtx.get(), AVMEDIA_TYPE_VIDEO, -1)) < 0) {
         videoStream.reset();
         if (ret != AVERROR_STREAM_NOT_FOUND && ret != AVERROR_DECODER_NOT_FOUND)
@@ -110,6 +127,7 @@ int Decoder::open(const QString& sourceFile, const AVRational& outputFrameRate,
 
     std::unique_ptr<AudioStream> audioStream(new AudioStream(outputAudioFormat, frameRateToFrameDuration<microseconds>(outputFrameRate), startTime));
     connect(audioStream.get(), &AudioStream::errorMessage, this, &Decoder::errorMessage);
+    audioStream->setMemoryAccount(m_memoryAccount);
     if ((ret = audioStream->open(formatCtx.get(), AVMEDIA_TYPE_AUDIO, videoStream ? videoStream->streamIndex() : -1)) < 0) {
         audioStream.reset();
         if (ret != AVERROR_STREAM_NOT_FOUND && ret != AVERROR_DECODER_NOT_FOUND)
@@ -150,19 +168,64 @@ int Decoder::open(const QString& sourceFile, const AVRational& outputFrameRate,
     return 0;
 }
 
-const microseconds Decoder::duration() const
+namespace {
+
+const microseconds formatDuration(AVFormatContext* formatContext, int videoStreamIndex)
 {
-    if (!m_formatContext)
-        return -1us;
     microseconds frameDuration = 0us;
-    if (m_videoStream) {
+    if (videoStreamIndex >= 0) {
         // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
-        AVRational frameRate = av_guess_frame_rate(m_formatContext.get(), m_formatContext->streams[m_videoStream->streamIndex()], nullptr);
+        AVRational frameRate = av_guess_frame_rate(formatContext, formatContext->streams[videoStreamIndex], nullptr);
         if (frameRate.num)
             frameDuration = frameRateToFrameDuration<microseconds>(frameRate);
     }
     // AVFormatContext->duration is pts of last frame, so we add a frame duration to get the end time
-    return std::chrono::duration<int64_t, std::ratio<1, AV_TIME_BASE>>(m_formatContext->duration) + frameDuration;
+    return std::chrono::duration<int64_t, std::ratio<1, AV_TIME_BASE>>(formatContext->duration) + frameDuration;
+}
+
+}
+
+const microseconds Decoder::duration() const
+{
+    if (!m_formatContext)
+        return -1us;
+    return formatDuration(m_formatContext.get(), m_videoStream ? m_videoStream->streamIndex() : -1);
+}
+
+const microseconds Decoder::probeDuration(const QString& sourceFile)
+{
+    // A render server probes the same sources for every job.
+    // Local files are only reprobed if they were modified.
+    struct Probe {
+        QDateTime lastModified;
+        qint64 size = 0;
+        microseconds duration;
+    };
+    static std::mutex probesMutex;
+    static std::map<QString, Probe> probes;
+    const QFileInfo fileInfo(sourceFile);
+    const bool isFile = fileInfo.isFile();
+    if (isFile) {
+        std::lock_guard lock(probesMutex);
+        auto it = probes.find(fileInfo.absoluteFilePath());
+        if (it != probes.end() && it->second.lastModified == fileInfo.lastModified() && it->second.size == fileInfo.size())
+            return it->second.duration;
+    }
+
+    AVFormatContext* ctx = nullptr;
+    if (avformat_open_input(&ctx, qUtf8Printable(sourceFile), NULL, NULL) < 0)
+        return -1us;
+    std::unique_ptr<AVFormatContext, CloseFormatContext> formatCtx(ctx);
+    if (avformat_find_stream_info(formatCtx.get(), NULL) < 0)
+        return -1us;
+    // Same stream selection as Stream::open, without opening the decoder
+    int videoStreamIndex = av_find_best_stream(formatCtx.get(), AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    const microseconds duration = formatDuration(formatCtx.get(), videoStreamIndex);
+    if (isFile) {
+        std::lock_guard lock(probesMutex);
+        probes.insert_or_assign(fileInfo.absoluteFilePath(), Probe { fileInfo.lastModified(), fileInfo.size(), duration });
+    }
+    return duration;
 }
 
 bool Decoder::pullFrameFromSink(Stream* stream, bool& gotFrame)
@@ -170,7 +233,11 @@ bool Decoder::pullFrameFromSink(Stream* stream, bool& gotFrame)
     int ret = 0;
     if (stream && !gotFrame) {
         std::unique_ptr<AVFrame, UnrefFrame> filterFrameRef;
-        ret = av_buffersink_get_frame(stream->bufferSinkContext(), stream->filterFrame());
+        {
+            Tracer::Span span("Stream::pullFrame");
+            Profiler::Scope scope(Profiler::Stage::Filter);
+            ret = av_buffersink_get_frame(stream->bufferSinkContext(), stream->filterFrame());
+        }
         if (ret == AVERROR_EOF) {
             // Signal EOF
             stream->processFrame(nullptr);
@@ -183,8 +250,10 @@ bool Decoder::pullFrameFromSink(Stream* stream, bool& gotFrame)
             return false;
         }
         filterFrameRef.reset(stream->filterFrame());
+        MemoryAccounting::Allocation allocation(stream->memoryAccount(), MemoryAccounting::Category::FilterFrames, frameBufferBytes(filterFrameRef.get()));
         if (stream->isSinkFrameTimeValid(filterFrameRef->pts)) {
             logAVFrame(stream, stream->bufferSinkContext(), AV_LOG_DEBUG, filterFrameRef.get());
+            Profiler::Scope scope(Profiler::Stage::FrameCopy);
             stream->processFrame(filterFrameRef.get());
             gotFrame = true;
         }
@@ -199,6 +268,7 @@ bool Decoder::sendPacketToDecoder(Stream* stream, AVPacket* packet)
     // https://trac.ffmpeg.org/ticket/10849
     if (packet && packet->size == 0)
         return true;
+    Profiler::Scope scope(Profiler::Stage::Decode);
     if (stream && (ret = avcodec_send_packet(stream->codecContext(), packet)) < 0) {
         emit errorMessage(u"%1 stream avcodec_send_packet failed: %2"_s.arg(stream->streamType(), av_err2qstring(ret)));
         return false;
@@ -213,7 +283,11 @@ bool Decoder::filter(Stream* stream, bool& gotFrame)
 
     while (true) {
         std::unique_ptr<AVFrame, UnrefFrame> frameRef;
-        int ret = avcodec_receive_frame(stream->codecContext(), stream->frame());
+        int ret = 0;
+        {
+            Profiler::Scope scope(Profiler::Stage::Decode);
+            ret = avcodec_receive_frame(stream->codecContext(), stream->frame());
+        }
         if (ret == AVERROR(EAGAIN)) {
             break;
         } else if (ret == AVERROR_EOF) {
@@ -236,6 +310,7 @@ bool Decoder::filter(Stream* stream, bool& gotFrame)
         // Audio would need special handling since we rely on a specific number of samples per frame.
 
         // Push frame into filtergraph.
+        Profiler::Scope scope(Profiler::Stage::Filter);
         if (stream->bufferSrcAddFrame(frameRef.get()) < 0)
             return false;
     }
@@ -250,6 +325,9 @@ bool Decoder::filter(Stream* stream, bool& gotFrame)
 bool Decoder::decode()
 {
     Q_ASSERT(m_formatContext);
+    Tracer::Context traceContext(m_sourceFile, m_outputFrame);
+    Tracer::Span span("Decoder::decode");
+    LatencyHistogram::Timer timer(m_decodeHistogram);
     int ret = 0;
     bool gotAudioFrame = !m_audioStream || m_audioStream->isEOF();
     bool gotVideoFrame = !m_videoStream || m_videoStream->isEOF();
@@ -263,12 +341,21 @@ bool Decoder::decode()
 
     while (!gotAudioFrame || !gotVideoFrame) {
         std::unique_ptr<AVPacket, UnrefPacket> packetRef;
+        MemoryAccounting::Allocation packetAllocation;
         if (!m_formatEOF) {
-            ret = av_read_frame(m_formatContext.get(), m_packet.get());
+            {
+                Profiler::Scope scope(Profiler::Stage::Demux);
+                ret = av_read_frame(m_formatContext.get(), m_packet.get());
+            }
+            if (AVIOContext* pb = m_formatContext->pb; pb && Profiler::isEnabled()) {
+                Profiler::addToCounter(Profiler::Counter::BytesRead, pb->bytes_read - m_bytesRead);
+                m_bytesRead = pb->bytes_read;
+            }
             if (ret >= 0) {
                 AVPacket* pkt = m_packet.get();
                 AVFormatContext* ctx = m_formatContext.get();
                 packetRef.reset(pkt);
+                packetAllocation = MemoryAccounting::Allocation(m_memoryAccount.get(), MemoryAccounting::Category::Packets, pkt->size);
                 av_log(static_cast<void*>(ctx), AV_LOG_TRACE, "mediafx "); // NOLINT(cppcoreguidelines-pro-type-vararg)
                 // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
                 av_pkt_dump_log2(static_cast<void*>(ctx), AV_LOG_TRACE, pkt, 0, ctx->streams[pkt->stream_index]);
@@ -312,6 +399,9 @@ bool Decoder::decode()
                 return false;
         }
     }
+    // Calls past EOF output no frame
+    if (!isAudioEOF() || !isVideoEOF())
+        m_outputFrame++;
     return true;
 }
 
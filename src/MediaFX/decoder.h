@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "memory_accounting.h"
 #include "util.h"
 #include <QAudioBuffer>
 #include <QAudioFormat>
@@ -11,6 +12,7 @@
 #include <QVideoFrame>
 #include <chrono>
 #include <memory>
+#include <stdint.h>
 extern "C" {
 #include <libavcodec/packet.h>
 #include <libavutil/frame.h>
@@ -19,6 +21,7 @@ extern "C" {
 Q_MOC_INCLUDE("audio_stream.h")
 Q_MOC_INCLUDE("video_stream.h")
 class AudioStream;
+class LatencyHistogram;
 class Stream;
 class VideoStream;
 struct AVFormatContext;
@@ -46,6 +49,8 @@ public:
     bool decode();
 
     const microseconds duration() const;
+    // Duration of sourceFile without opening codecs, or -1us on failure
+    static const microseconds probeDuration(const QString& sourceFile);
 
     bool hasAudio() const { return m_audioStream != nullptr; }
     bool isAudioEOF() const;
@@ -55,6 +60,11 @@ public:
     QVideoFrame outputVideoFrame() const;
     QAudioBuffer outputAudioBuffer() const;
 
+    // Account decoded memory against account, otherwise open() creates one for the source. Set before open()
+    void setMemoryAccount(const std::shared_ptr<MemoryAccounting::Account>& account) { m_memoryAccount = account; }
+    // nullptr before open() if not set
+    MemoryAccounting::Account* memoryAccount() const { return m_memoryAccount.get(); }
+
 signals:
     void errorMessage(const QString& message);
 
@@ -65,6 +75,12 @@ private:
     bool sendPacketToDecoder(Stream* stream, AVPacket* packet);
     bool filter(Stream* stream, bool& gotFrame);
 
+    QString m_sourceFile;
+    // Index at the output frame rate of the frame the next decode() outputs, tags its trace spans
+    int64_t m_outputFrame = 0;
+    LatencyHistogram* m_decodeHistogram = nullptr;
+    int64_t m_bytesRead = 0;
+    std::shared_ptr<MemoryAccounting::Account> m_memoryAccount;
     bool m_formatEOF = false;
     std::unique_ptr<AVFormatContext, CloseFormatContext> m_formatContext;
     std::unique_ptr<AudioStream> m_audioStream;
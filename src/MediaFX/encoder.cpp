@@ -9,35 +9,35 @@
  */
 
 #include "encoder.h"
+#include "bounded_queue.h"
 #include "formats.h"
-#include "output_stream.h"
+#include "frame_ring.h"
+#include "frame_sink.h"
+#include "memory_accounting.h"
+#include "memory_governor.h"
+#include "muxer.h"
+#include "profiler.h"
 #include "render_context.h"
-#include "util.h"
+#include "rendition.h"
+#include "rendition_writer.h"
+#include "segmented_muxer.h"
+#include "tracer.h"
 #include <QAudioBuffer>
 #include <QAudioFormat>
 #include <QByteArray>
 #include <QDebug>
+#include <QList>
 #include <QObject>
 #include <QQmlInfo>
 #include <QSize>
+#include <QString>
 #include <QtLogging>
-#include <stdint.h>
-extern "C" {
-#include <libavcodec/avcodec.h>
-#include <libavcodec/codec_id.h>
-#include <libavcodec/packet.h>
-#include <libavcodec/version.h>
-#include <libavformat/avformat.h>
-#include <libavformat/avio.h>
-#include <libavutil/channel_layout.h>
-#include <libavutil/common.h>
-#include <libavutil/dict.h>
-#include <libavutil/mathematics.h>
-#include <libavutil/rational.h>
-#include <libavutil/version.h>
-}
-
-// NOLINTBEGIN(bugprone-assignment-in-if-condition)
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+using namespace Qt::Literals::StringLiterals;
 
 Encoder::Encoder(QObject* parent)
     : QObject(parent)
@@ -46,10 +46,10 @@ Encoder::Encoder(QObject* parent)
 
 Encoder::~Encoder()
 {
-    m_audioStream.reset();
-    m_videoStream.reset();
-    if (m_formatContext)
-        avformat_free_context(m_formatContext);
+    if (m_writeQueue)
+        m_writeQueue->close();
+    if (m_writeThread.joinable())
+        m_writeThread.join();
 }
 
 void Encoder::setOutputFileName(const QString& outputFileName)
@@ -101,6 +101,66 @@ void Encoder::setSampleRate(int sampleRate)
     }
 }
 
+void Encoder::setRenditions(const QList<Rendition>& renditions)
+{
+    if (m_renditions != renditions) {
+        if (!m_renditions.isEmpty()) {
+            qmlWarning(this) << "Encoder renditions is a write-once property and cannot be changed";
+            return;
+        }
+        m_renditions = renditions;
+        emit renditionsChanged();
+    }
+}
+
+void Encoder::setSegmentFrames(int segmentFrames)
+{
+    if (m_segmentFrames != segmentFrames) {
+        if (m_segmentFrames != 0) {
+            qmlWarning(this) << "Encoder segmentFrames is a write-once property and cannot be changed";
+            return;
+        }
+        m_segmentFrames = segmentFrames;
+        emit segmentFramesChanged();
+    }
+}
+
+void Encoder::setManifestFileName(const QString& manifestFileName)
+{
+    if (m_manifestFileName != manifestFileName) {
+        if (!m_manifestFileName.isEmpty()) {
+            qmlWarning(this) << "Encoder manifestFileName is a write-once property and cannot be changed";
+            return;
+        }
+        m_manifestFileName = manifestFileName;
+        emit manifestFileNameChanged();
+    }
+}
+
+void Encoder::setPipelineDepth(int pipelineDepth)
+{
+    if (m_pipelineDepth != pipelineDepth) {
+        if (m_pipelineDepth != 0) {
+            qmlWarning(this) << "Encoder pipelineDepth is a write-once property and cannot be changed";
+            return;
+        }
+        m_pipelineDepth = pipelineDepth;
+        emit pipelineDepthChanged();
+    }
+}
+
+void Encoder::setFileIO(const QString& fileIO)
+{
+    if (m_fileIO != fileIO) {
+        if (!m_fileIO.isEmpty()) {
+            qmlWarning(this) << "Encoder fileIO is a write-once property and cannot be changed";
+            return;
+        }
+        m_fileIO = fileIO;
+        emit fileIOChanged();
+    }
+}
+
 void Encoder::initialize()
 {
     if (m_outputFileName.isEmpty() || m_frameSize.isEmpty()) {
@@ -109,73 +169,71 @@ void Encoder::initialize()
         return;
     }
 
-    int ret = 0;
-
-    // Select nut format
-    if ((ret = avformat_alloc_output_context2(&m_formatContext, nullptr, "nut", qUtf8Printable(outputFileName()))) < 0) {
-        qmlWarning(this) << "Could not allocate an output context, error:" << av_err2qstring(ret);
+    std::optional<Muxer::FileIO> fileIO = m_fileIO.isEmpty() ? Muxer::FileIO::AVIO : Muxer::parseFileIO(m_fileIO);
+    if (!fileIO) {
+        qmlWarning(this) << "Encoder fileIO must be avio, uring or uring-direct" << m_fileIO;
+        emit encodingError();
         return;
     }
 
-    // Video stream, AV_CODEC_ID_RAWVIDEO/AV_PIX_FMT_RGBA
-    std::unique_ptr<OutputStream> video(new OutputStream(m_formatContext, AV_CODEC_ID_RAWVIDEO));
-    if (!video->isValid())
-        return;
-    AVCodecContext* videoCodecContext = video->codecContext();
-    videoCodecContext->pix_fmt = VideoPixelFormat_FFMPEG;
-    videoCodecContext->width = frameSize().width();
-    videoCodecContext->height = frameSize().height();
-    AVRational timeBase(av_inv_q(frameRate()));
-    int64_t gcd = av_gcd(FFABS(timeBase.num), FFABS(timeBase.den));
-    if (gcd) {
-        timeBase.num = FFABS(timeBase.num) / gcd;
-        timeBase.den = FFABS(timeBase.den) / gcd;
-    }
-    video->stream()->time_base = videoCodecContext->time_base = timeBase;
-    if (!video->open())
-        return;
-
-    // Audio stream, AV_CODEC_ID_PCM_F32(BE|LE)/AV_SAMPLE_FMT_FLT
-    std::unique_ptr<OutputStream> audio(new OutputStream(m_formatContext, AudioCodec_FFMPEG));
-    if (!audio->isValid())
-        return;
-    AVCodecContext* audioCodecContext = audio->codecContext();
-    audioCodecContext->sample_fmt = AudioSampleFormat_FFMPEG;
-    audioCodecContext->sample_rate = sampleRate();
-#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(59, 37, 100)
-    audioCodecContext->channel_layout = AudioChannelLayout_FFMPEG;
-    audioCodecContext->channels = av_get_channel_layout_nb_channels(audioCodecContext->channel_layout);
+    std::unique_ptr<FrameSink> output;
+    if (QString sharedMemoryName = FrameRingWriter::sharedMemoryName(outputFileName()); !sharedMemoryName.isEmpty()) {
+#ifdef MEDIAFX_ENABLE_FRAME_RING
+        if (m_segmentFrames > 0) {
+            qmlWarning(this) << "Encoder cannot segment shared memory output";
+            return;
+        }
+        auto frameRing = std::make_unique<FrameRingWriter>(sharedMemoryName);
+        if (!frameRing->open(frameSize(), VideoPixelFormat_FFMPEG, frameRate(), sampleRate())) {
+            qmlWarning(this) << "Failed to open shared memory output" << outputFileName();
+            return;
+        }
+        output = std::move(frameRing);
 #else
-    if ((ret = av_channel_layout_copy(&audioCodecContext->ch_layout, &AudioChannelLayout_FFMPEG)) < 0) {
-        qmlWarning(this) << "Could not copy channel layout, error:" << av_err2qstring(ret);
+        qmlWarning(this) << "Shared memory output is not supported on this platform";
         return;
-    }
 #endif
-    audio->stream()->time_base = audioCodecContext->time_base = (AVRational) { 1, audioCodecContext->sample_rate };
-    if (!audio->open())
-        return;
-
-    m_audioStream.swap(audio);
-    m_videoStream.swap(video);
-
-    if (!(m_formatContext->flags & AVFMT_NOFILE)) {
-        if ((ret = avio_open(&m_formatContext->pb, qUtf8Printable(outputFileName()), AVIO_FLAG_WRITE)) < 0) {
-            qmlWarning(this) << "Could not open output file" << outputFileName() << ", avio_open:" << av_err2qstring(ret);
+    } else if (m_segmentFrames > 0) {
+        if (m_manifestFileName.isEmpty()) {
+            qmlWarning(this) << "Encoder manifestFileName is required when segmenting";
             return;
         }
+        auto segmentedMuxer = std::make_unique<SegmentedMuxer>(outputFileName(), manifestFileName(), segmentFrames(), *fileIO);
+        if (!segmentedMuxer->open(frameSize(), VideoPixelFormat_FFMPEG, frameRate(), sampleRate())) {
+            qmlWarning(this) << "Failed to open segmented output" << outputFileName();
+            return;
+        }
+        output = std::move(segmentedMuxer);
+    } else {
+        auto muxer = std::make_unique<Muxer>(*fileIO);
+        if (!muxer->open(outputFileName(), frameSize(), VideoPixelFormat_FFMPEG, frameRate(), sampleRate())) {
+            qmlWarning(this) << "Failed to open output" << outputFileName();
+            return;
+        }
+        output = std::move(muxer);
     }
-    AVDictionary* opt = nullptr;
-    if ((ret = av_dict_set(&opt, "fflags", "bitexact", 0)) < 0) {
-        qmlWarning(this) << "Could not set options, av_dict_set:" << av_err2qstring(ret);
-        return;
-    }
-    ret = avformat_write_header(m_formatContext, &opt);
-    av_dict_free(&opt);
-    if (ret < 0) {
-        qmlWarning(this) << "Could not open output file, avio_open:" << av_err2qstring(ret);
-        return;
+
+    std::vector<std::unique_ptr<RenditionWriter>> renditionWriters;
+    renditionWriters.reserve(m_renditions.size());
+    for (const auto& rendition : std::as_const(m_renditions)) {
+        if (rendition.frameSize().isEmpty() || !Rendition::isPixelFormatSupported(rendition.pixelFormat())) {
+            qmlWarning(this) << "Invalid rendition" << rendition;
+            return;
+        }
+        auto writer = std::make_unique<RenditionWriter>(rendition);
+        if (!writer->open(frameRate(), sampleRate())) {
+            qmlWarning(this) << "Failed to open rendition output" << rendition.outputFileName();
+            return;
+        }
+        renditionWriters.push_back(std::move(writer));
     }
 
+    m_output.swap(output);
+    m_renditionWriters.swap(renditionWriters);
+    if (m_pipelineDepth > 0) {
+        m_writeQueue = std::make_unique<BoundedQueue<Frame>>(m_pipelineDepth);
+        m_writeThread = std::thread(&Encoder::run, this);
+    }
     m_isValid = true;
 }
 
@@ -184,8 +242,9 @@ void Encoder::componentComplete()
     initialize();
 }
 
-bool Encoder::encode(const QAudioBuffer& audioBuffer, const QByteArray& videoData)
+bool Encoder::encode(const QAudioBuffer& audioBuffer, const QByteArray& videoData, const QList<QByteArray>& renditionData)
 {
+    Tracer::Span span("Encoder::encode");
     if (!m_isValid) {
         emit encodingError();
         return false;
@@ -200,44 +259,78 @@ bool Encoder::encode(const QAudioBuffer& audioBuffer, const QByteArray& videoDat
         emit encodingError();
         return false;
     }
-    AVPacket* videoPacket = m_videoStream->packet();
-    videoPacket->flags |= AV_PKT_FLAG_KEY;
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast, cppcoreguidelines-pro-type-reinterpret-cast)
-    videoPacket->data = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(videoData.constData()));
-    videoPacket->size = static_cast<int>(videoData.size());
-    if (!m_videoStream->writePacket(m_formatContext, 1)) {
+    if (static_cast<size_t>(renditionData.size()) != m_renditionWriters.size()) {
+        qmlWarning(this) << "Rendition buffers do not match renditions";
         emit encodingError();
         return false;
     }
 
-    AVPacket* audioPacket = m_audioStream->packet();
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
-    audioPacket->data = const_cast<uint8_t*>(audioBuffer.constData<uint8_t>());
-    audioPacket->size = static_cast<int>(audioBuffer.byteCount());
-    if (!m_audioStream->writePacket(m_formatContext, audioBuffer.frameCount())) {
+    Frame frame { audioBuffer, videoData, renditionData, Tracer::currentFrame() };
+    if (m_writeQueue) {
+        int64_t bytes = videoData.size();
+        for (const auto& data : renditionData)
+            bytes += data.size();
+        frame.allocation = MemoryAccounting::Allocation(&MemoryAccounting::session(), MemoryAccounting::Category::Readback, bytes);
+        // Over the memory limit, once no decoding is ahead of rendering to give up first,
+        // wait for queued frames to be written instead of queueing more
+        if (m_writeQueue->size() > 0 && MemoryGovernor::isOverLimit() && MemoryGovernor::furthestLead() <= 0us) {
+            MemoryGovernor::recordThrottle();
+            m_writeQueue->waitUntilSizeBelow(1);
+        }
+        // Blocks if the write thread is pipelineDepth frames behind
+        if (m_writeFailed || !m_writeQueue->push(std::move(frame))) {
+            emit encodingError();
+            return false;
+        }
+        if (Profiler::isEnabled())
+            Profiler::recordQueueDepth(Profiler::Queue::Encode, m_writeQueue->peakSize());
+        return true;
+    }
+    if (!write(frame)) {
         emit encodingError();
         return false;
     }
-
     return true;
 }
 
-bool Encoder::finish()
+bool Encoder::write(const Frame& frame)
 {
-    int ret = 0;
-    if ((ret = av_write_trailer(m_formatContext)) < 0) {
-        qCritical() << "Could not write trailer, av_write_trailer:" << av_err2qstring(ret);
-        emit encodingError();
-        return false;
-    }
-    if (!(m_formatContext->flags & AVFMT_NOFILE)) {
-        if ((ret = avio_closep(&m_formatContext->pb)) < 0) {
-            qCritical() << "Could not close file, avio_closep:" << av_err2qstring(ret);
-            emit encodingError();
+    Tracer::Context traceContext(frame.traceFrame);
+    Tracer::Span span("Encoder::write");
+    // Hand renditions off to their writer threads before muxing the primary output
+    for (size_t i = 0; i < m_renditionWriters.size(); i++) {
+        if (!m_renditionWriters[i]->write(frame.audioBuffer, frame.renditionData.at(static_cast<qsizetype>(i))))
             return false;
+    }
+    Profiler::Scope scope(Profiler::Stage::Mux);
+    return m_output->write(frame.audioBuffer, frame.videoData);
+}
+
+void Encoder::run()
+{
+    Tracer::setThreadName(u"MediaFX encoder"_s);
+    while (std::optional<Frame> frame = m_writeQueue->pop()) {
+        if (!write(*frame)) {
+            m_writeFailed = true;
+            // Unblock encode(), remaining frames are discarded
+            m_writeQueue->close();
+            return;
         }
     }
-    return true;
 }
 
-// NOLINTEND(bugprone-assignment-in-if-condition)
\ No newline at end of file
+bool Encoder::finish()
+{
+    if (m_writeQueue)
+        m_writeQueue->close();
+    if (m_writeThread.joinable())
+        m_writeThread.join();
+    bool success = !m_writeFailed && m_output && m_output->finish();
+    for (auto& writer : m_renditionWriters) {
+        if (!writer->finish())
+            success = false;
+    }
+    if (!success)
+        emit encodingError();
+    return success;
+}
@@ -3,18 +3,26 @@
 
 #pragma once
 
+#include "bounded_queue.h"
+#include "memory_accounting.h"
 #include "render_context.h"
+#include "rendition.h"
+#include <QAudioBuffer>
+#include <QByteArray>
+#include <QList>
 #include <QObject>
 #include <QQmlParserStatus>
 #include <QSize>
 #include <QString>
 #include <QtQmlIntegration>
+#include <atomic>
 #include <chrono>
 #include <memory>
-class OutputStream;
-class QAudioBuffer;
-class QByteArray;
-struct AVFormatContext;
+#include <stdint.h>
+#include <thread>
+#include <vector>
+class FrameSink;
+class RenditionWriter;
 using namespace std::chrono;
 
 class Encoder : public QObject, public QQmlParserStatus {
@@ -24,6 +32,11 @@ class Encoder : public QObject, public QQmlParserStatus {
     Q_PROPERTY(QSize frameSize READ frameSize WRITE setFrameSize NOTIFY frameSizeChanged FINAL REQUIRED)
     Q_PROPERTY(Rational frameRate READ frameRate WRITE setFrameRate NOTIFY frameRateChanged FINAL)
     Q_PROPERTY(int sampleRate READ sampleRate WRITE setSampleRate NOTIFY sampleRateChanged FINAL)
+    Q_PROPERTY(QList<Rendition> renditions READ renditions WRITE setRenditions NOTIFY renditionsChanged FINAL)
+    Q_PROPERTY(int segmentFrames READ segmentFrames WRITE setSegmentFrames NOTIFY segmentFramesChanged FINAL)
+    Q_PROPERTY(QString manifestFileName READ manifestFileName WRITE setManifestFileName NOTIFY manifestFileNameChanged FINAL)
+    Q_PROPERTY(int pipelineDepth READ pipelineDepth WRITE setPipelineDepth NOTIFY pipelineDepthChanged FINAL)
+    Q_PROPERTY(QString fileIO READ fileIO WRITE setFileIO NOTIFY fileIOChanged FINAL)
     QML_ELEMENT
 
 public:
@@ -46,6 +59,21 @@ public:
     int sampleRate() const { return m_sampleRate; }
     void setSampleRate(int sampleRate);
 
+    const QList<Rendition>& renditions() const { return m_renditions; }
+    void setRenditions(const QList<Rendition>& renditions);
+
+    int segmentFrames() const { return m_segmentFrames; }
+    void setSegmentFrames(int segmentFrames);
+
+    const QString& manifestFileName() const { return m_manifestFileName; }
+    void setManifestFileName(const QString& manifestFileName);
+
+    int pipelineDepth() const { return m_pipelineDepth; }
+    void setPipelineDepth(int pipelineDepth);
+
+    const QString& fileIO() const { return m_fileIO; }
+    void setFileIO(const QString& fileIO);
+
     void initialize();
 
 signals:
@@ -53,10 +81,15 @@ signals:
     void frameSizeChanged();
     void frameRateChanged();
     void sampleRateChanged();
+    void renditionsChanged();
+    void segmentFramesChanged();
+    void manifestFileNameChanged();
+    void pipelineDepthChanged();
+    void fileIOChanged();
     void encodingError();
 
 public slots:
-    bool encode(const QAudioBuffer& audioBuffer, const QByteArray& videoData);
+    bool encode(const QAudioBuffer& audioBuffer, const QByteArray& videoData, const QList<QByteArray>& renditionData = {});
     bool finish();
 
 protected:
@@ -66,13 +99,33 @@ protected:
 private:
     Q_DISABLE_COPY(Encoder);
 
+    struct Frame {
+        QAudioBuffer audioBuffer;
+        QByteArray videoData;
+        QList<QByteArray> renditionData;
+        int64_t traceFrame;
+        // Readback buffers held while queued for the write thread
+        MemoryAccounting::Allocation allocation {};
+    };
+
+    bool write(const Frame& frame);
+    void run();
+
     bool m_isValid = false;
     QSize m_frameSize;
     int m_frameByteSize = 0;
     Rational m_frameRate = DefaultFrameRate;
     int m_sampleRate = DefaultSampleRate;
     QString m_outputFileName;
-    AVFormatContext* m_formatContext = nullptr;
-    std::unique_ptr<OutputStream> m_videoStream;
-    std::unique_ptr<OutputStream> m_audioStream;
+    QList<Rendition> m_renditions;
+    int m_segmentFrames = 0;
+    QString m_manifestFileName;
+    int m_pipelineDepth = 0;
+    QString m_fileIO;
+    std::unique_ptr<FrameSink> m_output;
+    std::vector<std::unique_ptr<RenditionWriter>> m_renditionWriters;
+    // Frames are muxed on m_writeThread when pipelineDepth is set
+    std::unique_ptr<BoundedQueue<Frame>> m_writeQueue;
+    std::thread m_writeThread;
+    std::atomic<bool> m_writeFailed = false;
 };
\ No newline at end of file
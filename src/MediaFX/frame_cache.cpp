@@ -0,0 +1,153 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "frame_cache.h"
+#include "decode_queue.h"
+#include "memory_accounting.h"
+#include "memory_governor.h"
+#include <QAudioFormat>
+#include <QFileInfo>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace {
+
+struct Entry {
+    std::shared_ptr<FrameCache::Clip> clip;
+    int64_t bytes = 0;
+    uint64_t lastUsed = 0;
+};
+
+std::mutex s_mutex; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+std::map<FrameCache::Key, Entry> s_clips; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+int64_t s_size = 0; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+uint64_t s_useCount = 0; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+// s_mutex must be locked
+int64_t evictLocked(int64_t bytes)
+{
+    int64_t released = 0;
+    while (released < bytes && !s_clips.empty()) {
+        auto lru = s_clips.begin();
+        for (auto it = s_clips.begin(); it != s_clips.end(); ++it) {
+            if (it->second.lastUsed < lru->second.lastUsed)
+                lru = it;
+        }
+        // Frames of a clip still playing are released when it finishes
+        released += lru->second.bytes;
+        s_size -= lru->second.bytes;
+        s_clips.erase(lru);
+    }
+    return released;
+}
+
+}
+
+FrameCache::Recorder::Recorder(const Key& key, bool hasVideo, bool hasAudio)
+    : m_key(key)
+    , m_clip(std::make_shared<Clip>())
+{
+    m_clip->hasVideo = hasVideo;
+    m_clip->hasAudio = hasAudio;
+    MemoryAccounting::Account* account = MemoryAccounting::clipAccount(key.sourceFile);
+    m_clip->videoAllocation = MemoryAccounting::Allocation(account, MemoryAccounting::Category::VideoFrames, 0);
+    m_clip->audioAllocation = MemoryAccounting::Allocation(account, MemoryAccounting::Category::AudioBuffers, 0);
+}
+
+bool FrameCache::Recorder::add(const QVideoFrame& videoFrame, const QAudioBuffer& audioBuffer, bool copy)
+{
+    if (!m_clip)
+        return false;
+    const int64_t videoBytes = DecodeQueue::videoFrameBytes(videoFrame);
+    const int64_t audioBytes = audioBuffer.isValid() ? audioBuffer.byteCount() : 0;
+    if (m_videoBytes + videoBytes + m_audioBytes + audioBytes > capacity()) {
+        m_clip.reset();
+        return false;
+    }
+    if (copy)
+        m_clip->frames.push_back({ DecodeQueue::copyVideoFrame(videoFrame), DecodeQueue::copyAudioBuffer(audioBuffer) });
+    else
+        m_clip->frames.push_back({ videoFrame, audioBuffer });
+    m_videoBytes += videoBytes;
+    m_audioBytes += audioBytes;
+    m_clip->videoAllocation.resize(m_videoBytes);
+    m_clip->audioAllocation.resize(m_audioBytes);
+    return true;
+}
+
+void FrameCache::Recorder::finish(const microseconds& endTime)
+{
+    if (!m_clip)
+        return;
+    m_clip->endTime = endTime;
+    insert(m_key, std::move(m_clip));
+}
+
+void FrameCache::setCapacity(int64_t bytes)
+{
+    s_capacity.store(bytes, std::memory_order_relaxed);
+    // Not under s_mutex, the governor calls evictors holding its own lock
+    static std::once_flag evictorAdded;
+    if (bytes > 0)
+        std::call_once(evictorAdded, []() { MemoryGovernor::addEvictor(&FrameCache::evict); });
+    std::lock_guard lock(s_mutex);
+    if (s_size > bytes)
+        evictLocked(s_size - bytes);
+}
+
+std::optional<FrameCache::Key> FrameCache::key(const QString& sourceFile, const microseconds& startTime, const AVRational& frameRate, const QAudioFormat& audioFormat)
+{
+    const QFileInfo fileInfo(sourceFile);
+    if (!fileInfo.isFile())
+        return std::nullopt;
+    return Key { fileInfo.absoluteFilePath(), fileInfo.lastModified(), fileInfo.size(), startTime, frameRate, audioFormat.sampleRate() };
+}
+
+std::shared_ptr<const FrameCache::Clip> FrameCache::find(const Key& key, const microseconds& endTime)
+{
+    std::lock_guard lock(s_mutex);
+    auto it = s_clips.find(key);
+    if (it == s_clips.end() || it->second.clip->endTime < endTime)
+        return nullptr;
+    it->second.lastUsed = ++s_useCount;
+    return it->second.clip;
+}
+
+void FrameCache::insert(const Key& key, std::shared_ptr<Clip> clip)
+{
+    const int64_t bytes = clip->videoAllocation.bytes() + clip->audioAllocation.bytes();
+    std::lock_guard lock(s_mutex);
+    if (bytes > capacity())
+        return;
+    // Replaces a shorter recording of the same clip
+    if (auto it = s_clips.find(key); it != s_clips.end()) {
+        if (it->second.clip->endTime >= clip->endTime)
+            return;
+        s_size -= it->second.bytes;
+        s_clips.erase(it);
+    }
+    if (s_size + bytes > capacity())
+        evictLocked(s_size + bytes - capacity());
+    s_clips.insert_or_assign(key, Entry { std::move(clip), bytes, ++s_useCount });
+    s_size += bytes;
+}
+
+int64_t FrameCache::evict(int64_t bytes)
+{
+    std::lock_guard lock(s_mutex);
+    return evictLocked(bytes);
+}
+
+void FrameCache::clear()
+{
+    std::lock_guard lock(s_mutex);
+    s_clips.clear();
+    s_size = 0;
+}
+
+int64_t FrameCache::size()
+{
+    std::lock_guard lock(s_mutex);
+    return s_size;
+}
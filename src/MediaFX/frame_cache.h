@@ -0,0 +1,102 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "memory_accounting.h"
+#include <QAudioBuffer>
+#include <QDateTime>
+#include <QString>
+#include <QVideoFrame>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <stdint.h>
+#include <tuple>
+#include <vector>
+extern "C" {
+#include <libavutil/rational.h>
+}
+class QAudioFormat;
+using namespace std::chrono;
+
+// Decoded frames of whole clips kept across sessions, so clips shared between the jobs of a batch
+// or render server (e.g. a common intro and outro) are only decoded once.
+// Clips are keyed by everything that determines their frames, so a cached clip
+// covering at least the same time range can be played instead of decoding.
+// Least recently used clips are evicted to stay within the capacity,
+// and when the MemoryGovernor limit is exceeded.
+class FrameCache {
+public:
+    struct Key {
+        QString sourceFile;
+        QDateTime lastModified;
+        int64_t fileSize = 0;
+        microseconds startTime { 0 };
+        AVRational frameRate { 0, 1 };
+        int sampleRate = 0;
+
+        friend bool operator<(const Key& lhs, const Key& rhs)
+        {
+            return std::tie(lhs.sourceFile, lhs.lastModified, lhs.fileSize, lhs.startTime, lhs.frameRate.num, lhs.frameRate.den, lhs.sampleRate)
+                < std::tie(rhs.sourceFile, rhs.lastModified, rhs.fileSize, rhs.startTime, rhs.frameRate.num, rhs.frameRate.den, rhs.sampleRate);
+        }
+    };
+
+    struct Frame {
+        QVideoFrame videoFrame;
+        QAudioBuffer audioBuffer;
+    };
+
+    struct Clip {
+        bool hasVideo = false;
+        bool hasAudio = false;
+        // Frames rendered from startTime up to endTime
+        microseconds endTime { 0 };
+        std::vector<Frame> frames;
+        MemoryAccounting::Allocation videoAllocation {};
+        MemoryAccounting::Allocation audioAllocation {};
+    };
+
+    // Records the frames of a clip as it renders, to insert once it ends
+    class Recorder {
+    public:
+        Recorder(const Key& key, bool hasVideo, bool hasAudio);
+        Recorder(Recorder&&) = delete;
+        Recorder(const Recorder&) = delete;
+        Recorder& operator=(Recorder&&) = delete;
+        Recorder& operator=(const Recorder&) = delete;
+        ~Recorder() = default;
+
+        // Frames owned by the decoder are reused by it, so must be copied.
+        // Returns false once the clip will not fit in the cache, and the recording should be dropped.
+        bool add(const QVideoFrame& videoFrame, const QAudioBuffer& audioBuffer, bool copy);
+        // Inserts the clip into the cache
+        void finish(const microseconds& endTime);
+
+    private:
+        Key m_key;
+        std::shared_ptr<Clip> m_clip;
+        int64_t m_videoBytes = 0;
+        int64_t m_audioBytes = 0;
+    };
+
+    // 0 (the default) disables caching
+    static void setCapacity(int64_t bytes);
+    static int64_t capacity() { return s_capacity.load(std::memory_order_relaxed); }
+    static bool isEnabled() { return capacity() > 0; }
+
+    // nullopt if sourceFile is not a local file
+    static std::optional<Key> key(const QString& sourceFile, const microseconds& startTime, const AVRational& frameRate, const QAudioFormat& audioFormat);
+    // A cached clip with frames up to at least endTime, or nullptr
+    static std::shared_ptr<const Clip> find(const Key& key, const microseconds& endTime);
+    static void insert(const Key& key, std::shared_ptr<Clip> clip);
+    // Evicts least recently used clips, returns the bytes released
+    static int64_t evict(int64_t bytes);
+    static void clear();
+    static int64_t size();
+
+private:
+    static inline std::atomic<int64_t> s_capacity = 0;
+};
@@ -0,0 +1,419 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "frame_ring.h"
+#include <QString>
+#ifdef MEDIAFX_ENABLE_FRAME_RING
+#include "formats.h"
+#include <QAudioBuffer>
+#include <QAudioFormat>
+#include <QByteArray>
+#include <QDebug>
+#include <QtLogging>
+#include <climits>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <new>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+extern "C" {
+#include <libavutil/mathematics.h>
+}
+#endif
+using namespace Qt::Literals::StringLiterals;
+
+QString FrameRingWriter::sharedMemoryName(const QString& outputFileName)
+{
+    if (!outputFileName.startsWith(u"shm:"_s) || outputFileName.size() <= 4)
+        return QString();
+    return u"/"_s + outputFileName.mid(4);
+}
+
+#ifdef MEDIAFX_ENABLE_FRAME_RING
+
+namespace {
+
+constexpr size_t CacheLineSize = 64;
+
+constexpr uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+constexpr milliseconds OpenRetryInterval = 10ms;
+
+// NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast, cppcoreguidelines-pro-type-vararg)
+void futexWait(std::atomic<uint32_t>& word, uint32_t expected, const milliseconds& timeout)
+{
+    const timespec relativeTimeout {
+        .tv_sec = static_cast<time_t>(duration_cast<seconds>(timeout).count()),
+        .tv_nsec = static_cast<long>(duration_cast<nanoseconds>(timeout % 1s).count()),
+    };
+    // Spurious wakeups, timeouts and EAGAIN are handled by the caller's loop
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &relativeTimeout, nullptr, 0);
+}
+
+void futexWake(std::atomic<uint32_t>& word)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+// NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast, cppcoreguidelines-pro-type-vararg)
+
+void notify(std::atomic<uint32_t>& word)
+{
+    word.fetch_add(1, std::memory_order_release);
+    futexWake(word);
+}
+
+bool isProcessAlive(pid_t pid)
+{
+    // EPERM means it exists but belongs to another user
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+uint8_t* slotAddress(FrameRingHeader* header, uint64_t sequence)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast, cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return reinterpret_cast<uint8_t*>(header) + header->headerSize + (sequence % header->slotCount) * header->slotSize;
+}
+
+}
+
+FrameRingWriter::FrameRingWriter(const QString& name, int slotCount, const milliseconds& attachTimeout)
+    : m_name(name)
+    , m_slotCount(slotCount > 0 ? slotCount : DefaultSlotCount)
+    , m_attachTimeout(attachTimeout)
+{
+}
+
+FrameRingWriter::~FrameRingWriter()
+{
+    if (m_mapping)
+        munmap(m_mapping, m_mappingSize);
+    if (m_fd != -1) {
+        ::close(m_fd);
+        shm_unlink(qUtf8Printable(m_name));
+    }
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+bool FrameRingWriter::open(const QSize& frameSize, AVPixelFormat pixelFormat, const AVRational& frameRate, int sampleRate)
+{
+    const uint64_t pageSize = sysconf(_SC_PAGESIZE);
+    QAudioFormat audioFormat;
+    audioFormat.setChannelConfig(AudioChannelLayout_Qt);
+    const int channelCount = audioFormat.channelCount();
+    const uint64_t videoByteSize = static_cast<uint64_t>(frameSize.width()) * frameSize.height() * 4;
+    // Frame durations are not always a whole number of samples, allow for rounding up
+    const uint64_t audioMaxFrameCount = av_rescale_rnd(sampleRate, frameRate.den, frameRate.num, AV_ROUND_UP) + 1;
+    const uint64_t audioMaxByteSize = audioMaxFrameCount * channelCount * sizeof(float);
+
+    const uint64_t headerSize = alignUp(sizeof(FrameRingHeader), pageSize);
+    // Keep video page aligned so consumers can hand it to the kernel directly
+    const uint64_t videoOffset = alignUp(sizeof(FrameRingSlotHeader), pageSize);
+    const uint64_t audioOffset = alignUp(videoOffset + videoByteSize, CacheLineSize);
+    const uint64_t slotSize = alignUp(audioOffset + audioMaxByteSize, pageSize);
+    m_mappingSize = headerSize + slotSize * m_slotCount;
+
+    m_fd = shm_open(qUtf8Printable(m_name), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if (m_fd == -1 && errno == EEXIST) {
+        // Left behind by a crashed writer
+        shm_unlink(qUtf8Printable(m_name));
+        m_fd = shm_open(qUtf8Printable(m_name), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    }
+    if (m_fd == -1) {
+        qCritical() << "Failed to create shared memory" << m_name << strerror(errno);
+        return false;
+    }
+    if (ftruncate(m_fd, static_cast<off_t>(m_mappingSize)) == -1) {
+        qCritical() << "Failed to size shared memory" << m_name << strerror(errno);
+        return false;
+    }
+    m_mapping = mmap(nullptr, m_mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (m_mapping == MAP_FAILED) {
+        m_mapping = nullptr;
+        qCritical() << "Failed to map shared memory" << m_name << strerror(errno);
+        return false;
+    }
+
+    m_header = new (m_mapping) FrameRingHeader {};
+    m_header->version = FrameRingVersion;
+    m_header->slotCount = m_slotCount;
+    m_header->width = frameSize.width();
+    m_header->height = frameSize.height();
+    m_header->pixelFormat = pixelFormat;
+    m_header->frameRateNum = frameRate.num;
+    m_header->frameRateDen = frameRate.den;
+    m_header->sampleRate = sampleRate;
+    m_header->channelCount = channelCount;
+    m_header->headerSize = headerSize;
+    m_header->slotSize = slotSize;
+    m_header->videoOffset = videoOffset;
+    m_header->videoByteSize = videoByteSize;
+    m_header->audioOffset = audioOffset;
+    m_header->audioMaxByteSize = audioMaxByteSize;
+    m_header->writerPid.store(getpid(), std::memory_order_relaxed);
+    m_attachDeadline = steady_clock::now() + m_attachTimeout;
+    // Readers validate magic last
+    m_header->magic.store(FrameRingMagic, std::memory_order_release);
+    return true;
+}
+
+bool FrameRingWriter::write(const QAudioBuffer& audioBuffer, const QByteArray& videoData)
+{
+    if (!m_header || m_header->closed.load(std::memory_order_relaxed))
+        return false;
+    if (static_cast<uint64_t>(videoData.size()) != m_header->videoByteSize) {
+        qCritical() << "Frame ring video buffer has incorrect byte size";
+        return false;
+    }
+    if (static_cast<uint64_t>(audioBuffer.byteCount()) > m_header->audioMaxByteSize) {
+        qCritical() << "Frame ring audio buffer is too large";
+        return false;
+    }
+
+    // Wait for the reader to release the slot we are about to fill
+    if (m_sequence >= m_header->slotCount && !waitForReadSequence(m_sequence - m_header->slotCount + 1))
+        return false;
+
+    uint8_t* slot = slotAddress(m_header, m_sequence);
+    auto* slotHeader = new (slot) FrameRingSlotHeader {};
+    slotHeader->sequence = m_sequence;
+    slotHeader->audioFrameCount = audioBuffer.frameCount();
+    slotHeader->audioByteSize = audioBuffer.byteCount();
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    memcpy(slot + m_header->videoOffset, videoData.constData(), videoData.size());
+    memcpy(slot + m_header->audioOffset, audioBuffer.constData(), audioBuffer.byteCount());
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+    m_sequence++;
+    m_header->writeSequence.store(m_sequence, std::memory_order_release);
+    notify(m_header->writeSignal);
+    return true;
+}
+
+bool FrameRingWriter::finish()
+{
+    if (!m_header)
+        return false;
+    m_header->closed.store(1, std::memory_order_release);
+    notify(m_header->writeSignal);
+
+    // Keep the shared memory alive until the reader has drained it
+    return waitForReadSequence(m_sequence);
+}
+
+bool FrameRingWriter::waitForReadSequence(uint64_t sequence)
+{
+    while (true) {
+        uint32_t readSignal = m_header->readSignal.load(std::memory_order_acquire);
+        if (m_header->readSequence.load(std::memory_order_acquire) >= sequence)
+            return true;
+        if (m_header->readerDetached.load(std::memory_order_acquire)) {
+            qCritical() << "Frame ring reader detached from" << m_name;
+            return false;
+        }
+        const pid_t readerPid = m_header->readerPid.load(std::memory_order_acquire);
+        if (readerPid == 0) {
+            if (steady_clock::now() >= m_attachDeadline) {
+                qCritical() << "No frame ring reader attached to" << m_name << "within" << m_attachTimeout.count() << "ms";
+                return false;
+            }
+        } else if (!isProcessAlive(readerPid)) {
+            qCritical() << "Frame ring reader exited" << m_name;
+            return false;
+        }
+        futexWait(m_header->readSignal, readSignal, FrameRingPollInterval);
+    }
+}
+
+FrameRingReader::FrameRingReader(const QString& name)
+    : m_name(name)
+{
+}
+
+FrameRingReader::~FrameRingReader()
+{
+    if (m_header) {
+        // Lets the writer fail instead of waiting for frames to be released
+        m_header->readerDetached.store(1, std::memory_order_release);
+        notify(m_header->readSignal);
+    }
+    closeMapping();
+}
+
+void FrameRingReader::closeMapping()
+{
+    m_header = nullptr;
+    if (m_mapping)
+        munmap(m_mapping, m_mappingSize);
+    m_mapping = nullptr;
+    m_mappingSize = 0;
+    if (m_fd != -1)
+        ::close(m_fd);
+    m_fd = -1;
+}
+
+bool FrameRingReader::open(const milliseconds& timeout)
+{
+    const auto deadline = steady_clock::now() + timeout;
+    QString errorMessage;
+    while (true) {
+        OpenResult result = tryOpen(errorMessage);
+        if (result == OpenResult::Opened)
+            break;
+        closeMapping();
+        if (result == OpenResult::Failed) {
+            qCritical() << errorMessage << m_name;
+            return false;
+        }
+        if (steady_clock::now() >= deadline) {
+            qCritical() << "Timed out waiting for frame ring," << errorMessage << m_name;
+            return false;
+        }
+        std::this_thread::sleep_for(OpenRetryInterval);
+    }
+
+    auto* header = static_cast<FrameRingHeader*>(m_mapping);
+    const int32_t previousReader = header->readerPid.load(std::memory_order_acquire);
+    if (previousReader != 0 && isProcessAlive(previousReader) && !header->readerDetached.load(std::memory_order_acquire)) {
+        qCritical() << "Frame ring already has a reader" << m_name;
+        closeMapping();
+        return false;
+    }
+    header->readerDetached.store(0, std::memory_order_relaxed);
+    header->readerPid.store(getpid(), std::memory_order_release);
+    m_header = header;
+    m_sequence = m_header->readSequence.load(std::memory_order_acquire);
+    notify(m_header->readSignal);
+    return true;
+}
+
+FrameRingReader::OpenResult FrameRingReader::tryOpen(QString& errorMessage)
+{
+    m_fd = shm_open(qUtf8Printable(m_name), O_RDWR, 0);
+    if (m_fd == -1) {
+        const int error = errno;
+        errorMessage = u"failed to open shared memory %1"_s.arg(QString::fromUtf8(strerror(error)));
+        // The writer has not created it yet
+        return error == ENOENT ? OpenResult::Retry : OpenResult::Failed;
+    }
+    struct stat st = {};
+    if (fstat(m_fd, &st) == -1) {
+        errorMessage = u"failed to stat shared memory %1"_s.arg(QString::fromUtf8(strerror(errno)));
+        return OpenResult::Failed;
+    }
+    // The writer sizes it after creating it
+    if (static_cast<size_t>(st.st_size) < sizeof(FrameRingHeader)) {
+        errorMessage = u"shared memory is not sized"_s;
+        return OpenResult::Retry;
+    }
+    m_mappingSize = st.st_size;
+    m_mapping = mmap(nullptr, m_mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (m_mapping == MAP_FAILED) {
+        m_mapping = nullptr;
+        errorMessage = u"failed to map shared memory %1"_s.arg(QString::fromUtf8(strerror(errno)));
+        return OpenResult::Failed;
+    }
+    auto* header = static_cast<FrameRingHeader*>(m_mapping);
+    // The writer stores magic last once the header is initialized
+    if (header->magic.load(std::memory_order_acquire) != FrameRingMagic) {
+        errorMessage = u"frame ring is not initialized"_s;
+        return OpenResult::Retry;
+    }
+    if (header->version != FrameRingVersion) {
+        errorMessage = u"unsupported frame ring version %1"_s.arg(header->version);
+        return OpenResult::Failed;
+    }
+    // Left behind by a crashed writer, a new writer replaces it
+    if (!isProcessAlive(header->writerPid.load(std::memory_order_relaxed))) {
+        errorMessage = u"frame ring writer has exited"_s;
+        return OpenResult::Retry;
+    }
+    if (header->headerSize + header->slotSize * header->slotCount > m_mappingSize) {
+        errorMessage = u"frame ring is truncated"_s;
+        return OpenResult::Failed;
+    }
+    return OpenResult::Opened;
+}
+
+QSize FrameRingReader::frameSize() const
+{
+    return m_header ? QSize(static_cast<int>(m_header->width), static_cast<int>(m_header->height)) : QSize();
+}
+
+AVPixelFormat FrameRingReader::pixelFormat() const
+{
+    return m_header ? static_cast<AVPixelFormat>(m_header->pixelFormat) : AV_PIX_FMT_NONE;
+}
+
+AVRational FrameRingReader::frameRate() const
+{
+    return m_header ? AVRational { m_header->frameRateNum, m_header->frameRateDen } : AVRational { 0, 1 };
+}
+
+int FrameRingReader::sampleRate() const
+{
+    return m_header ? m_header->sampleRate : 0;
+}
+
+int FrameRingReader::channelCount() const
+{
+    return m_header ? m_header->channelCount : 0;
+}
+
+std::optional<FrameRingReader::Frame> FrameRingReader::acquire()
+{
+    if (!m_header)
+        return std::nullopt;
+    if (m_acquired)
+        release();
+
+    while (true) {
+        uint32_t writeSignal = m_header->writeSignal.load(std::memory_order_acquire);
+        if (m_header->writeSequence.load(std::memory_order_acquire) > m_sequence)
+            break;
+        if (m_header->closed.load(std::memory_order_acquire))
+            return std::nullopt;
+        if (!isProcessAlive(m_header->writerPid.load(std::memory_order_relaxed))) {
+            qCritical() << "Frame ring writer exited without closing" << m_name;
+            m_writerLost = true;
+            return std::nullopt;
+        }
+        futexWait(m_header->writeSignal, writeSignal, FrameRingPollInterval);
+    }
+
+    uint8_t* slot = slotAddress(m_header, m_sequence);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto* slotHeader = reinterpret_cast<const FrameRingSlotHeader*>(slot);
+    m_acquired = true;
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return Frame {
+        .sequence = slotHeader->sequence,
+        .videoData = slot + m_header->videoOffset,
+        .videoByteSize = m_header->videoByteSize,
+        .audioData = slot + m_header->audioOffset,
+        .audioByteSize = slotHeader->audioByteSize,
+        .audioFrameCount = static_cast<int>(slotHeader->audioFrameCount),
+    };
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+void FrameRingReader::release()
+{
+    if (!m_header || !m_acquired)
+        return;
+    m_acquired = false;
+    m_sequence++;
+    m_header->readSequence.store(m_sequence, std::memory_order_release);
+    notify(m_header->readSignal);
+}
+
+#endif
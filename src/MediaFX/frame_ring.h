@@ -0,0 +1,182 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "frame_sink.h"
+#include <QSize>
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <stddef.h>
+#include <stdint.h>
+extern "C" {
+#include <libavutil/pixfmt.h>
+#include <libavutil/rational.h>
+}
+class QAudioBuffer;
+class QByteArray;
+using namespace std::chrono;
+using namespace std::chrono_literals;
+
+#if defined(__linux__)
+#define MEDIAFX_ENABLE_FRAME_RING
+#endif
+
+/*
+ * Shared memory frame ring protocol.
+ *
+ * The POSIX shared memory object contains a FrameRingHeader padded to headerSize,
+ * followed by slotCount slots of slotSize bytes each. Each slot begins with a
+ * FrameRingSlotHeader, video is at videoOffset and audio at audioOffset within the slot.
+ *
+ * There is a single writer and a single reader.
+ * The writer fills slot (N % slotCount) and then publishes frame N by storing writeSequence = N + 1.
+ * The reader consumes frame N once writeSequence > N, and releases the slot by storing readSequence = N + 1.
+ * The writer never overwrites a slot that has not been released.
+ * After storing a sequence, each side increments its signal word and futex wakes the other side.
+ * The writer sets closed after the last frame, the reader stops once it has consumed every published frame.
+ *
+ * The writer stores its pid in writerPid before magic, and the reader stores its pid in readerPid once attached.
+ * Both sides wait on the futex with a timeout and check the other side's process still exists,
+ * so they must share a pid namespace. The writer fails if no reader attaches within its attach timeout,
+ * or if the reader exits or sets readerDetached. The reader stops if the writer exits without closing the ring.
+ */
+inline constexpr uint32_t FrameRingMagic = 0x5246584d; // "MXFR"
+inline constexpr uint32_t FrameRingVersion = 2;
+// How often a waiting side checks the other side is still alive
+inline constexpr milliseconds FrameRingPollInterval = 100ms;
+
+struct FrameRingHeader {
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t width;
+    uint32_t height;
+    int32_t pixelFormat; // AVPixelFormat
+    int32_t frameRateNum;
+    int32_t frameRateDen;
+    int32_t sampleRate;
+    int32_t channelCount; // interleaved float samples
+    uint64_t headerSize;
+    uint64_t slotSize;
+    uint64_t videoOffset;
+    uint64_t videoByteSize;
+    uint64_t audioOffset;
+    uint64_t audioMaxByteSize;
+
+    alignas(64) std::atomic<uint64_t> writeSequence;
+    std::atomic<uint32_t> writeSignal;
+    std::atomic<uint32_t> closed;
+    std::atomic<int32_t> writerPid;
+
+    alignas(64) std::atomic<uint64_t> readSequence;
+    std::atomic<uint32_t> readSignal;
+    std::atomic<int32_t> readerPid; // 0 until a reader attaches
+    std::atomic<uint32_t> readerDetached;
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+struct FrameRingSlotHeader {
+    uint64_t sequence;
+    uint32_t audioFrameCount; // samples per channel
+    uint32_t audioByteSize;
+};
+
+// Writes frames into a shared memory ring named by an output of the form shm:NAME
+class FrameRingWriter : public FrameSink {
+public:
+    static constexpr int DefaultSlotCount = 4;
+    static constexpr milliseconds DefaultAttachTimeout = 30s;
+
+    // Writing fails if no reader has attached within attachTimeout of open()
+    explicit FrameRingWriter(const QString& name, int slotCount = DefaultSlotCount, const milliseconds& attachTimeout = DefaultAttachTimeout);
+    FrameRingWriter(FrameRingWriter&&) = delete;
+    FrameRingWriter(const FrameRingWriter&) = delete;
+    FrameRingWriter& operator=(FrameRingWriter&&) = delete;
+    FrameRingWriter& operator=(const FrameRingWriter&) = delete;
+    ~FrameRingWriter() override;
+
+    // Returns the shared memory object name (e.g. "/NAME") for an shm:NAME output, or an empty string
+    static QString sharedMemoryName(const QString& outputFileName);
+
+    bool open(const QSize& frameSize, AVPixelFormat pixelFormat, const AVRational& frameRate, int sampleRate);
+    // Blocks while the ring is full, fails if the reader has gone away
+    bool write(const QAudioBuffer& audioBuffer, const QByteArray& videoData) override;
+    // Marks the ring closed and blocks until the reader has consumed every frame, fails if the reader has gone away
+    bool finish() override;
+
+private:
+    // Blocks until the reader has released frames up to sequence
+    bool waitForReadSequence(uint64_t sequence);
+
+    QString m_name;
+    int m_slotCount;
+    milliseconds m_attachTimeout;
+    steady_clock::time_point m_attachDeadline;
+    int m_fd = -1;
+    void* m_mapping = nullptr;
+    size_t m_mappingSize = 0;
+    FrameRingHeader* m_header = nullptr;
+    uint64_t m_sequence = 0;
+};
+
+// Reference reader for the frame ring. Frames are accessed in place in shared memory.
+class FrameRingReader {
+public:
+    struct Frame {
+        uint64_t sequence;
+        const uint8_t* videoData;
+        size_t videoByteSize;
+        const uint8_t* audioData;
+        size_t audioByteSize;
+        int audioFrameCount;
+    };
+
+    explicit FrameRingReader(const QString& name);
+    FrameRingReader(FrameRingReader&&) = delete;
+    FrameRingReader(const FrameRingReader&) = delete;
+    FrameRingReader& operator=(FrameRingReader&&) = delete;
+    FrameRingReader& operator=(const FrameRingReader&) = delete;
+    ~FrameRingReader();
+
+    static constexpr milliseconds DefaultOpenTimeout = 30s;
+
+    // Waits up to timeout for the writer to create and initialize the ring, so the reader can be started first
+    bool open(const milliseconds& timeout = DefaultOpenTimeout);
+
+    QSize frameSize() const;
+    AVPixelFormat pixelFormat() const;
+    AVRational frameRate() const;
+    int sampleRate() const;
+    int channelCount() const;
+
+    // Blocks until the next frame is available, returns nullopt once the writer has closed the ring
+    // or the writer exited without closing it, see isWriterLost().
+    // The frame data remains valid until release() is called.
+    std::optional<Frame> acquire();
+    void release();
+
+    // The writer exited without closing the ring, so the frames read are incomplete
+    bool isWriterLost() const { return m_writerLost; }
+
+private:
+    enum class OpenResult {
+        Opened,
+        Retry,
+        Failed,
+    };
+    OpenResult tryOpen(QString& errorMessage);
+    void closeMapping();
+
+    QString m_name;
+    int m_fd = -1;
+    void* m_mapping = nullptr;
+    size_t m_mappingSize = 0;
+    FrameRingHeader* m_header = nullptr;
+    uint64_t m_sequence = 0;
+    bool m_acquired = false;
+    bool m_writerLost = false;
+};
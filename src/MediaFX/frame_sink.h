@@ -0,0 +1,21 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+class QAudioBuffer;
+class QByteArray;
+
+// Destination for rendered audio/video frames written by Encoder
+class FrameSink {
+public:
+    FrameSink() = default;
+    FrameSink(FrameSink&&) = delete;
+    FrameSink(const FrameSink&) = delete;
+    FrameSink& operator=(FrameSink&&) = delete;
+    FrameSink& operator=(const FrameSink&) = delete;
+    virtual ~FrameSink() = default;
+
+    virtual bool write(const QAudioBuffer& audioBuffer, const QByteArray& videoData) = 0;
+    virtual bool finish() = 0;
+};
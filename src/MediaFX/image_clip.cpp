@@ -0,0 +1,177 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "image_clip.h"
+#include "decode_queue.h"
+#include "formats.h"
+#include "media_clip.h"
+#include "memory_accounting.h"
+#include "render_session.h"
+#include "tracer.h"
+#include <QImage>
+#include <QImageIOHandler>
+#include <QImageReader>
+#include <QQmlInfo>
+#include <QUrl>
+#include <QVideoFrameFormat>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stddef.h>
+#include <utility>
+using namespace Qt::Literals::StringLiterals;
+
+/*!
+    \qmltype ImageClip
+    //! \instantiates ImageClip
+    \inqmlmodule MediaFX
+    \inherits MediaClip
+
+    \brief Plays a still image from \l source over \l {MediaClip::startTime}{startTime} to \l {MediaClip::endTime}{endTime}.
+
+    The image is decoded once and the same video frame is rendered for the whole clip,
+    so a \l VideoRenderer uploads it to the GPU once.
+    Images have no duration, so \l {MediaClip::endTime}{endTime} is required.
+*/
+ImageClip::ImageClip(QObject* parent)
+    : MediaClip(nullptr, parent)
+{
+}
+
+/*!
+    \qmlproperty size ImageClip::sourceSize
+
+    If set, the image is downscaled when decoded to fit within this size, preserving its aspect ratio.
+    Set it to the size the image is displayed at to avoid decoding and uploading more pixels than are rendered.
+    If only one dimension is set the other is scaled proportionally. Images are never upscaled.
+*/
+void ImageClip::setSourceSize(const QSize& sourceSize)
+{
+    if (m_sourceSize != sourceSize) {
+        if (isComponentComplete()) {
+            qmlWarning(this) << "ImageClip sourceSize cannot be changed once loaded";
+            return;
+        }
+        m_sourceSize = sourceSize;
+        emit sourceSizeChanged();
+    }
+}
+
+/*!
+    \qmlproperty bool ImageClip::asynchronous
+
+    Decode the image on a worker thread, default \c false.
+    Decoding starts when the clip is loaded, for clips in a \l MediaSequence ahead of when they play,
+    and rendering waits for it to finish if the clip starts first.
+*/
+void ImageClip::setAsynchronous(bool asynchronous)
+{
+    if (m_asynchronous != asynchronous) {
+        if (isComponentComplete()) {
+            qmlWarning(this) << "ImageClip asynchronous cannot be changed once loaded";
+            return;
+        }
+        m_asynchronous = asynchronous;
+        emit asynchronousChanged();
+    }
+}
+
+QVideoFrame ImageClip::decodeImage(const QString& fileName, const QSize& sourceSize, QString& errorMessage)
+{
+    Tracer::Span span("ImageClip::decodeImage");
+    QImageReader reader(fileName);
+    reader.setAutoTransform(true);
+    const QSize imageSize = reader.size();
+    if (imageSize.isValid() && (sourceSize.width() > 0 || sourceSize.height() > 0)) {
+        // sourceSize is the displayed size, the image is scaled before it is rotated
+        const QSize displaySize = reader.transformation().testFlag(QImageIOHandler::TransformationRotate90) ? imageSize.transposed() : imageSize;
+        double scale = 1;
+        if (sourceSize.width() > 0)
+            scale = std::min(scale, static_cast<double>(sourceSize.width()) / displaySize.width());
+        if (sourceSize.height() > 0)
+            scale = std::min(scale, static_cast<double>(sourceSize.height()) / displaySize.height());
+        if (scale < 1) {
+            reader.setScaledSize(QSize(std::max(1, static_cast<int>(std::lround(imageSize.width() * scale))),
+                std::max(1, static_cast<int>(std::lround(imageSize.height() * scale)))));
+        }
+    }
+    QImage image = reader.read();
+    if (image.isNull()) {
+        errorMessage = reader.errorString();
+        return QVideoFrame();
+    }
+    image.convertTo(QImage::Format_RGBA8888);
+
+    QVideoFrameFormat format(image.size(), VideoPixelFormat_Qt);
+    format.setColorSpace(VideoColorSpace_Qt);
+    format.setColorRange(VideoColorRange_Qt);
+    QVideoFrame videoFrame(format);
+    if (!videoFrame.map(QVideoFrame::WriteOnly)) {
+        errorMessage = u"Failed to map video frame"_s;
+        return QVideoFrame();
+    }
+    const size_t lineBytes = static_cast<size_t>(image.width()) * 4; // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+    for (int y = 0; y < image.height(); ++y) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        std::memcpy(videoFrame.bits(0) + static_cast<ptrdiff_t>(y) * videoFrame.bytesPerLine(0), image.constScanLine(y), lineBytes);
+    }
+    videoFrame.unmap();
+    return videoFrame;
+}
+
+void ImageClip::componentComplete()
+{
+    // Images have no duration to default endTime to
+    if (endTime() < 0) {
+        qmlWarning(this) << "ImageClip requires endTime (source" << source() << ")";
+        if (renderSession())
+            renderSession()->fatalError();
+        return;
+    }
+    MediaClip::componentComplete();
+}
+
+bool ImageClip::openMedia()
+{
+    m_opened = true;
+    if (!m_asynchronous) {
+        DecodedImage image;
+        image.videoFrame = decodeImage(source().toLocalFile(), m_sourceSize, image.errorMessage);
+        return setDecodedImage(std::move(image));
+    }
+    m_pendingImage = std::async(std::launch::async, [fileName = source().toLocalFile(), sourceSize = m_sourceSize]() {
+        DecodedImage image;
+        image.videoFrame = decodeImage(fileName, sourceSize, image.errorMessage);
+        return image;
+    });
+    return true;
+}
+
+bool ImageClip::setDecodedImage(DecodedImage&& image)
+{
+    if (!image.videoFrame.isValid()) {
+        qmlWarning(this) << "ImageClip failed to decode" << image.errorMessage << "(source" << source() << ")";
+        return false;
+    }
+    m_videoFrame = std::move(image.videoFrame);
+    m_videoAllocation = MemoryAccounting::Allocation(memoryAccount().get(), MemoryAccounting::Category::VideoFrames, DecodeQueue::videoFrameBytes(m_videoFrame));
+    return true;
+}
+
+bool ImageClip::nextFrame(QVideoFrame& videoFrame, QAudioBuffer&)
+{
+    // Waits if the clip starts before decoding finishes
+    if (m_pendingImage.valid() && !setDecodedImage(m_pendingImage.get()))
+        return false;
+    // The same frame every time, video sinks ignore it after the first
+    videoFrame = m_videoFrame;
+    return true;
+}
+
+void ImageClip::closeMedia()
+{
+    m_opened = false;
+    m_pendingImage = {};
+    m_videoFrame = QVideoFrame();
+    m_videoAllocation = MemoryAccounting::Allocation();
+}
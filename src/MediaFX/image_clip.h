@@ -0,0 +1,71 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "media_clip.h"
+#include "memory_accounting.h"
+#include <QAudioBuffer>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QVideoFrame>
+#include <QtQmlIntegration>
+#include <future>
+
+// A still image played like a MediaClip over [startTime, endTime).
+// The image is decoded once, and the same frame is rendered for the whole clip,
+// so video sinks upload it to a texture once instead of every frame.
+class ImageClip : public MediaClip {
+    Q_OBJECT
+    Q_PROPERTY(QSize sourceSize READ sourceSize WRITE setSourceSize NOTIFY sourceSizeChanged FINAL)
+    Q_PROPERTY(bool asynchronous READ asynchronous WRITE setAsynchronous NOTIFY asynchronousChanged FINAL)
+    QML_ELEMENT
+
+signals:
+    void sourceSizeChanged();
+    void asynchronousChanged();
+
+public:
+    explicit ImageClip(QObject* parent = nullptr);
+    ImageClip(ImageClip&&) = delete;
+    ImageClip& operator=(ImageClip&&) = delete;
+    ~ImageClip() override = default;
+
+    const QSize& sourceSize() const { return m_sourceSize; }
+    void setSourceSize(const QSize& sourceSize);
+
+    bool asynchronous() const { return m_asynchronous; }
+    void setAsynchronous(bool asynchronous);
+
+    bool hasAudio() const override { return false; }
+    bool hasVideo() const override { return m_opened; }
+
+    // Decodes fileName into a frame, downscaled to fit within sourceSize preserving aspect ratio
+    // if either dimension is set. Returns an invalid frame and sets errorMessage on failure.
+    static QVideoFrame decodeImage(const QString& fileName, const QSize& sourceSize, QString& errorMessage);
+
+protected:
+    void componentComplete() override;
+    bool openMedia() override;
+    bool nextFrame(QVideoFrame& videoFrame, QAudioBuffer& audioBuffer) override;
+    void closeMedia() override;
+
+private:
+    Q_DISABLE_COPY(ImageClip);
+
+    struct DecodedImage {
+        QVideoFrame videoFrame;
+        QString errorMessage;
+    };
+
+    bool setDecodedImage(DecodedImage&& image);
+
+    QSize m_sourceSize;
+    bool m_asynchronous = false;
+    bool m_opened = false;
+    // Decoding on a worker thread if asynchronous
+    std::future<DecodedImage> m_pendingImage;
+    QVideoFrame m_videoFrame;
+    MemoryAccounting::Allocation m_videoAllocation {};
+};
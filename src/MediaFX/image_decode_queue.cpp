@@ -0,0 +1,97 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "image_decode_queue.h"
+#include "decode_queue.h"
+#include "image_clip.h"
+#include "memory_accounting.h"
+#include "memory_governor.h"
+#include "tracer.h"
+#include <QVideoFrame>
+#include <algorithm>
+#include <mutex>
+#include <utility>
+using namespace Qt::Literals::StringLiterals;
+
+ImageDecodeQueue::ImageDecodeQueue(const QStringList& fileNames, const QSize& sourceSize, MemoryAccounting::Account* account, size_t threadCount, size_t window)
+    : m_fileNames(fileNames)
+    , m_sourceSize(sourceSize)
+    , m_account(account)
+    , m_slots(threadCount > 0 ? std::max(window, threadCount) : 1)
+{
+    m_threads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+        m_threads.emplace_back(&ImageDecodeQueue::run, this);
+}
+
+ImageDecodeQueue::~ImageDecodeQueue()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopped = true;
+    }
+    m_workAvailable.notify_all();
+    for (auto& thread : m_threads) {
+        if (thread.joinable())
+            thread.join();
+    }
+}
+
+ImageDecodeQueue::Slot ImageDecodeQueue::decode(qsizetype index) const
+{
+    Slot slot { index, true };
+    slot.videoFrame = ImageClip::decodeImage(m_fileNames.at(index), m_sourceSize, slot.errorMessage);
+    slot.videoAllocation = MemoryAccounting::Allocation(m_account, MemoryAccounting::Category::VideoFrames, DecodeQueue::videoFrameBytes(slot.videoFrame));
+    return slot;
+}
+
+QVideoFrame ImageDecodeQueue::frame(qsizetype index, QString& errorMessage)
+{
+    Q_ASSERT(index >= m_baseIndex && index < size());
+    std::unique_lock lock(m_mutex);
+    Slot& slot = m_slots.at(static_cast<size_t>(index) % m_slots.size());
+    if (m_threads.empty()) {
+        if (slot.index != index)
+            slot = decode(index);
+    } else {
+        if (index > m_baseIndex) {
+            // Skip images that were never requested
+            m_baseIndex = index;
+            m_nextIndex = std::max(m_nextIndex, index);
+            m_workAvailable.notify_all();
+        }
+        m_imageDecoded.wait(lock, [&slot, index] { return slot.index == index && slot.decoded; });
+    }
+    errorMessage = slot.errorMessage;
+    return slot.videoFrame;
+}
+
+bool ImageDecodeQueue::canClaim() const
+{
+    if (m_nextIndex >= size() || m_nextIndex >= m_baseIndex + static_cast<qsizetype>(m_slots.size()))
+        return false;
+    // Over the memory limit, only decode the image rendering is waiting for
+    return m_nextIndex == m_baseIndex || !MemoryGovernor::isOverLimit();
+}
+
+void ImageDecodeQueue::run()
+{
+    Tracer::setThreadName(u"MediaFX image decode"_s);
+    std::unique_lock lock(m_mutex);
+    while (true) {
+        m_workAvailable.wait(lock, [this] { return m_stopped || canClaim(); });
+        if (m_stopped)
+            return;
+        const qsizetype index = m_nextIndex++;
+        const size_t slotIndex = static_cast<size_t>(index) % m_slots.size();
+        // Releases the image that was held in this slot, it is behind the window
+        m_slots.at(slotIndex) = Slot { index };
+        lock.unlock();
+        Slot decoded = decode(index);
+        lock.lock();
+        // The window may have moved past this image while it was decoding
+        if (m_slots.at(slotIndex).index == index)
+            m_slots.at(slotIndex) = std::move(decoded);
+        m_imageDecoded.notify_all();
+    }
+}
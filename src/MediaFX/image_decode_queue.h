@@ -0,0 +1,63 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "memory_accounting.h"
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVideoFrame>
+#include <condition_variable>
+#include <mutex>
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+// Decodes a list of image files ahead of rendering on a pool of worker threads.
+// Images are decoded in parallel but delivered in list order,
+// and only a window of images starting at the one last requested is decoded or held at once.
+class ImageDecodeQueue {
+public:
+    // With no threads, each image is decoded when it is requested
+    ImageDecodeQueue(const QStringList& fileNames, const QSize& sourceSize, MemoryAccounting::Account* account, size_t threadCount, size_t window);
+    ImageDecodeQueue(ImageDecodeQueue&&) = delete;
+    ImageDecodeQueue(const ImageDecodeQueue&) = delete;
+    ImageDecodeQueue& operator=(ImageDecodeQueue&&) = delete;
+    ImageDecodeQueue& operator=(const ImageDecodeQueue&) = delete;
+    ~ImageDecodeQueue();
+
+    qsizetype size() const { return m_fileNames.size(); }
+
+    // Blocks until image index is decoded, returns an invalid frame and sets errorMessage on failure.
+    // index must not decrease between calls, images before it are released as the window moves on.
+    QVideoFrame frame(qsizetype index, QString& errorMessage);
+
+private:
+    struct Slot {
+        qsizetype index = -1;
+        bool decoded = false;
+        QVideoFrame videoFrame;
+        QString errorMessage;
+        MemoryAccounting::Allocation videoAllocation {};
+    };
+
+    void run();
+    bool canClaim() const;
+    Slot decode(qsizetype index) const;
+
+    const QStringList m_fileNames;
+    const QSize m_sourceSize;
+    MemoryAccounting::Account* m_account;
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_imageDecoded;
+    // Ring of images indexed by image index modulo the window
+    std::vector<Slot> m_slots;
+    // Next image a worker will decode
+    qsizetype m_nextIndex = 0;
+    // Image last requested, the window starts here
+    qsizetype m_baseIndex = 0;
+    bool m_stopped = false;
+    std::vector<std::thread> m_threads;
+};
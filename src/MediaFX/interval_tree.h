@@ -0,0 +1,116 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "interval.h"
+#include <algorithm>
+#include <chrono>
+#include <stddef.h>
+#include <vector>
+using namespace std::chrono;
+
+// Index of values by Interval, for finding the values whose interval contains a time
+// or overlaps another interval in O(log n + matches).
+// Entries are kept sorted by start, the implicit balanced tree over the sorted array is augmented
+// with the maximum end of each subtree. That is rebuilt after modification, so this suits
+// indexes that are queried far more often than they are modified.
+template <class V, class T = microseconds>
+class IntervalTree {
+public:
+    void insert(const Interval<T>& interval, const V& value)
+    {
+        auto it = std::upper_bound(m_entries.begin(), m_entries.end(), interval.start(), [](const T& start, const Entry& entry) { return start < entry.interval.start(); });
+        m_entries.insert(it, Entry { interval, value });
+        m_dirty = true;
+    }
+
+    // Removes entries matching predicate(interval, value)
+    template <class P>
+    void removeIf(P predicate)
+    {
+        auto it = std::remove_if(m_entries.begin(), m_entries.end(), [&predicate](const Entry& entry) { return predicate(entry.interval, entry.value); });
+        if (it != m_entries.end()) {
+            m_entries.erase(it, m_entries.end());
+            m_dirty = true;
+        }
+    }
+
+    void clear()
+    {
+        m_entries.clear();
+        m_maxEnd.clear();
+        m_dirty = false;
+    }
+
+    size_t size() const { return m_entries.size(); }
+    bool isEmpty() const { return m_entries.empty(); }
+
+    // Calls function(interval, value) in start order for each entry whose interval overlaps query
+    template <class F>
+    void forEachOverlapping(const Interval<T>& query, F function)
+    {
+        update();
+        overlapping(0, m_entries.size(), query.start(), query.end(), function);
+    }
+
+    // Calls function(interval, value) in start order for each entry whose interval contains time
+    template <class F>
+    void forEachContaining(const T& time, F function)
+    {
+        // Interval::contains(time) is start <= time < end
+        forEachOverlapping(Interval<T>(time, time + T(1)), function);
+    }
+
+private:
+    struct Entry {
+        Interval<T> interval;
+        V value;
+    };
+
+    void update()
+    {
+        if (!m_dirty)
+            return;
+        m_dirty = false;
+        m_maxEnd.resize(m_entries.size());
+        if (!m_entries.empty())
+            updateMaxEnd(0, m_entries.size());
+    }
+
+    T updateMaxEnd(size_t lo, size_t hi)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        T maxEnd = m_entries[mid].interval.end();
+        if (lo < mid)
+            maxEnd = std::max(maxEnd, updateMaxEnd(lo, mid));
+        if (mid + 1 < hi)
+            maxEnd = std::max(maxEnd, updateMaxEnd(mid + 1, hi));
+        m_maxEnd[mid] = maxEnd;
+        return maxEnd;
+    }
+
+    template <class F>
+    void overlapping(size_t lo, size_t hi, const T& start, const T& end, F& function) const
+    {
+        if (lo >= hi)
+            return;
+        const size_t mid = lo + (hi - lo) / 2;
+        // Nothing in this subtree ends after start
+        if (m_maxEnd[mid] <= start)
+            return;
+        overlapping(lo, mid, start, end, function);
+        // This entry and everything after it starts too late
+        const Entry& entry = m_entries[mid];
+        if (entry.interval.start() >= end)
+            return;
+        if (entry.interval.end() > start)
+            function(entry.interval, entry.value);
+        overlapping(mid + 1, hi, start, end, function);
+    }
+
+    std::vector<Entry> m_entries;
+    // Maximum end of the subtree rooted at each entry
+    std::vector<T> m_maxEnd;
+    bool m_dirty = false;
+};
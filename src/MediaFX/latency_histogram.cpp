@@ -0,0 +1,67 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "latency_histogram.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <stdint.h>
+
+size_t LatencyHistogram::bucketIndex(uint64_t value)
+{
+    // Values below SubBucketCount have a bucket each,
+    // above that each power of two is split into SubBucketCount buckets
+    if (value < SubBucketCount)
+        return static_cast<size_t>(value);
+    const int shift = std::bit_width(value) - 1 - SubBucketBits;
+    return static_cast<size_t>((shift + 1) * SubBucketCount + ((value >> shift) - SubBucketCount));
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index)
+{
+    if (index < SubBucketCount)
+        return index;
+    const int shift = static_cast<int>(index / SubBucketCount) - 1;
+    const uint64_t subBucket = index % SubBucketCount + SubBucketCount;
+    return ((subBucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(nanoseconds latency)
+{
+    const int64_t value = std::max<int64_t>(latency.count(), 0);
+    m_buckets[bucketIndex(static_cast<uint64_t>(value))].fetch_add(1, std::memory_order_relaxed);
+    int64_t max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) { }
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto& bucket : m_buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Snapshot::add(const LatencyHistogram& histogram)
+{
+    for (size_t i = 0; i < BucketCount; i++) {
+        uint64_t count = histogram.m_buckets[i].load(std::memory_order_relaxed);
+        m_buckets[i] += count;
+        m_count += count;
+    }
+    m_max = std::max(m_max, nanoseconds(histogram.m_max.load(std::memory_order_relaxed)));
+}
+
+nanoseconds LatencyHistogram::Snapshot::percentile(double p) const
+{
+    if (m_count == 0)
+        return nanoseconds(0);
+    // Rank of the sample at the percentile, 1 based
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * static_cast<double>(m_count))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BucketCount; i++) {
+        seen += m_buckets[i];
+        if (seen >= rank)
+            return std::min(nanoseconds(static_cast<int64_t>(std::min<uint64_t>(bucketUpperBound(i), INT64_MAX))), m_max);
+    }
+    return m_max;
+}
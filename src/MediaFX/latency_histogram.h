@@ -0,0 +1,79 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+using namespace std::chrono;
+
+// Lock-free log-linear histogram of latencies, accurate to within 1/16 (about 6%).
+// Recording is a relaxed atomic increment, so a thread can record into its own histogram
+// while another thread reads a Snapshot.
+class LatencyHistogram {
+    static constexpr int SubBucketBits = 4;
+    static constexpr uint64_t SubBucketCount = uint64_t(1) << SubBucketBits;
+
+public:
+    static constexpr size_t BucketCount = SubBucketCount * (64 - SubBucketBits + 1);
+
+    class Snapshot {
+    public:
+        uint64_t count() const { return m_count; }
+        nanoseconds max() const { return m_max; }
+        // Upper bound of the bucket containing the pth percentile, p in [0, 100]
+        nanoseconds percentile(double p) const;
+
+        void add(const LatencyHistogram& histogram);
+
+    private:
+        std::array<uint64_t, BucketCount> m_buckets {};
+        uint64_t m_count = 0;
+        nanoseconds m_max { 0 };
+    };
+
+    // Records latency into histogram on scope exit, does nothing if histogram is null
+    class Timer {
+    public:
+        explicit Timer(LatencyHistogram* histogram)
+            : m_histogram(histogram)
+        {
+            if (m_histogram)
+                m_start = steady_clock::now();
+        }
+        Timer(Timer&&) = delete;
+        Timer(const Timer&) = delete;
+        Timer& operator=(Timer&&) = delete;
+        Timer& operator=(const Timer&) = delete;
+        ~Timer()
+        {
+            if (m_histogram)
+                m_histogram->record(steady_clock::now() - m_start);
+        }
+
+    private:
+        LatencyHistogram* m_histogram;
+        steady_clock::time_point m_start;
+    };
+
+    LatencyHistogram() = default;
+    LatencyHistogram(LatencyHistogram&&) = delete;
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(LatencyHistogram&&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+    ~LatencyHistogram() = default;
+
+    void record(nanoseconds latency);
+    void reset();
+
+    static size_t bucketIndex(uint64_t value);
+    // Largest value that falls in the bucket
+    static uint64_t bucketUpperBound(size_t index);
+
+private:
+    std::array<std::atomic<uint64_t>, BucketCount> m_buckets {};
+    std::atomic<int64_t> m_max = 0;
+};
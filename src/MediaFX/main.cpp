@@ -2,51 +2,72 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "application.h"
+#include "formats.h"
+#include "frame_cache.h"
+#include "frame_ring.h"
+#include "memory_governor.h"
+#include "muxer.h"
+#include "profiler.h"
 #include "render_context.h"
+#include "render_job.h"
+#include "render_server.h"
+#include "rendition.h"
+#include "tracer.h"
 #include "version.h"
 #include <QCommandLineOption>
+#include <QAudioBuffer>
+#include <QAudioFormat>
+#include <QByteArray>
 #include <QCommandLineParser>
 #include <QCoreApplication>
 #include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
 #include <QGuiApplication>
+#include <QIODevice>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QJsonValue>
 #include <QList>
 #include <QMessageLogContext>
 #include <QObject>
 #include <QQmlApplicationEngine>
 #include <QQmlComponent>
 #include <QQmlContext>
+#include <QQmlEngine>
 #include <QQmlError>
 #include <QSize>
 #include <QString>
 #include <QStringBuilder>
 #include <QStringList>
+#include <QTextStream>
 #include <QUrl>
 #include <Qt>
 #include <QtAssert>
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
+#include <optional>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 extern "C" {
 #include <libavutil/log.h>
 #include <libavutil/parseutils.h>
+#include <libavutil/rational.h>
 }
 #ifdef EVENTLOGGER
 #include "event_logger.h"
 #endif
 using namespace Qt::Literals::StringLiterals;
 
-int encoder(QGuiApplication& app, QCommandLineParser& parser)
+void applyLogLevel(QCommandLineParser& parser)
 {
-    parser.clearPositionalArguments();
-    parser.addPositionalArgument(u"encoder"_s, u"encoder command."_s, u"encoder [encoder_options]"_s);
-    parser.addOption({ { u"f"_s, u"fps"_s }, u"Output frames per second, can be integer or rational e.g. 30000/1001."_s, u"fps"_s, u"30"_s });
-    parser.addOption({ { u"r"_s, u"sampleRate"_s }, u"Output audio sample rate (Hz)."_s, u"sampleRate"_s, u"44100"_s });
-    parser.addOption({ { u"s"_s, u"size"_s }, u"Output video frame size, WxH."_s, u"size"_s, u"640x360"_s });
-    parser.addOption({ { u"w"_s, u"exitOnWarning"_s }, u"Exit on QML warnings."_s });
-    parser.addOption({ { u"l"_s, u"loglevel"_s }, u"FFmpeg log level."_s, u"loglevel"_s, u"warning"_s });
-    parser.addPositionalArgument(u"source"_s, u"QML source URL."_s);
-    parser.addPositionalArgument(u"output"_s, u"Output nut video path (or '-' for stdout)."_s);
-    parser.process(app);
-
     if (parser.isSet(u"loglevel"_s)) {
         struct LogLevel {
             QString name;
@@ -84,6 +105,202 @@ int encoder(QGuiApplication& app, QCommandLineParser& parser)
         }
     } else
         av_log_set_level(AV_LOG_WARNING);
+}
+
+QString shaderCacheDirectory(QCommandLineParser& parser)
+{
+    if (!parser.isSet(u"shaderCache"_s))
+        return QString();
+    QString directory = QDir(parser.value(u"shaderCache"_s)).absolutePath();
+    if (!QDir().mkpath(directory)) {
+        qCritical() << "Could not create shader cache directory" << directory;
+        parser.showHelp(1);
+    }
+    return directory;
+}
+
+// Applies --memoryLimit and validates --pipelineDepth, which is returned
+int applyPipelineOptions(QCommandLineParser& parser)
+{
+    bool pipelineDepthOk = false;
+    int pipelineDepth = parser.value(u"pipelineDepth"_s).toInt(&pipelineDepthOk);
+    if (!pipelineDepthOk || pipelineDepth < 0)
+        parser.showHelp(1);
+    if (parser.isSet(u"memoryLimit"_s)) {
+        int64_t memoryLimit = MemoryGovernor::parseSize(parser.value(u"memoryLimit"_s));
+        if (memoryLimit <= 0)
+            parser.showHelp(1);
+        MemoryGovernor::setLimit(memoryLimit);
+    }
+    return pipelineDepth;
+}
+
+// Validated --fileIO, empty when io_uring is not supported
+QString fileIOOption(QCommandLineParser& parser)
+{
+#ifdef MEDIAFX_ENABLE_IO_URING
+    QString fileIO = parser.value(u"fileIO"_s);
+    if (!Muxer::parseFileIO(fileIO))
+        parser.showHelp(1);
+    return fileIO;
+#else
+    Q_UNUSED(parser);
+    return QString();
+#endif
+}
+
+void applyFrameCache(QCommandLineParser& parser)
+{
+    int64_t frameCache = MemoryGovernor::parseSize(parser.value(u"frameCache"_s));
+    if (frameCache < 0)
+        parser.showHelp(1);
+    FrameCache::setCapacity(frameCache);
+}
+
+// Jobs of a batch manifest, either an array of job objects or an object with a "jobs" array.
+// Each job is merged over base, and relative paths in it are resolved against the manifest directory.
+std::optional<QList<RenderJob>> loadBatch(const QString& manifestFileName, const QJsonObject& base)
+{
+    QFile manifestFile(manifestFileName);
+    if (!manifestFile.open(QIODevice::ReadOnly)) {
+        qCritical() << "Could not read batch manifest" << manifestFileName << manifestFile.errorString();
+        return std::nullopt;
+    }
+    QJsonParseError parseError;
+    const QJsonDocument manifest = QJsonDocument::fromJson(manifestFile.readAll(), &parseError);
+    const QJsonArray entries = manifest.isArray() ? manifest.array() : manifest.object()[u"jobs"_s].toArray();
+    if (manifest.isNull() || entries.isEmpty()) {
+        qCritical() << "Invalid batch manifest" << manifestFileName << parseError.errorString();
+        return std::nullopt;
+    }
+    const QDir baseDirectory = QFileInfo(manifestFileName).absoluteDir();
+    QList<RenderJob> jobs;
+    // Validate every job before rendering any
+    for (qsizetype i = 0; i < entries.size(); ++i) {
+        QJsonObject json = base;
+        const QJsonObject entry = entries.at(i).toObject();
+        for (auto it = entry.begin(); it != entry.end(); ++it)
+            json.insert(it.key(), it.value());
+        QString errorMessage;
+        auto job = RenderJob::fromJson(json, errorMessage, baseDirectory);
+        if (!job) {
+            qCritical() << "Invalid batch job" << i << errorMessage;
+            return std::nullopt;
+        }
+        jobs.append(*job);
+    }
+    return jobs;
+}
+
+// encoder --batch, renders the jobs of a manifest through a RenderServer without a socket
+int batch(QGuiApplication& app, QCommandLineParser& parser)
+{
+    for (const auto& option : { u"rendition"_s, u"segmentDuration"_s, u"segmentFrames"_s, u"manifest"_s, u"report"_s }) {
+        if (parser.isSet(option)) {
+            qCritical() << option << "must be set for each job in the batch manifest";
+            parser.showHelp(1);
+        }
+    }
+    const QStringList args = parser.positionalArguments();
+    if (args.size() > 2 || args.first() != u"encoder"_s)
+        parser.showHelp(1);
+
+    const int pipelineDepth = applyPipelineOptions(parser);
+    applyFrameCache(parser);
+    const QString fileIO = fileIOOption(parser);
+
+    // Command line options are defaults for every job
+    QJsonObject base {
+        { u"fps"_s, parser.value(u"fps"_s) },
+        { u"size"_s, parser.value(u"size"_s) },
+        { u"sampleRate"_s, parser.value(u"sampleRate"_s).toInt() },
+        { u"framesPerEvent"_s, parser.value(u"framesPerEvent"_s).toInt() },
+    };
+    if (args.size() == 2)
+        base.insert(u"source"_s, QDir::current().absoluteFilePath(args.at(1)));
+    auto jobs = loadBatch(parser.value(u"batch"_s), base);
+    if (!jobs)
+        return 1;
+
+    // Not a QQmlApplicationEngine, which would quit the application when a session exits
+    QQmlEngine engine;
+    RenderContext* renderContext = engine.singletonInstance<RenderContext*>("MediaFX", "RenderContext");
+    Q_ASSERT(renderContext);
+    renderContext->setPipelineDepth(pipelineDepth);
+    // Every job writes its output the same way
+    renderContext->setFileIO(fileIO);
+    renderContext->setShaderCacheDirectory(shaderCacheDirectory(parser));
+    renderContext->setShaderWarmup(parser.isSet(u"shaderWarmup"_s));
+    if (parser.isSet(u"exitOnWarning"_s)) {
+        // Fails the job that warned
+        QObject::connect(&engine, &QQmlEngine::warnings, &engine, [&engine]() { emit engine.exit(1); });
+    }
+
+    RenderServer server(&engine);
+    if (!server.initialize())
+        return 1;
+    int result = 0;
+    QTextStream out(stdout);
+    QObject::connect(&server, &RenderServer::jobFinished, &server, [&result, &out](const QJsonObject& response) {
+        if (response[u"exitCode"_s].toInt() != 0)
+            result = 1;
+        out << QJsonDocument(response).toJson(QJsonDocument::Compact) << Qt::endl;
+    });
+    // Queued, the first job may fail before the event loop is running
+    QObject::connect(&server, &RenderServer::jobsFinished, &app, [&app, &result]() { app.exit(result); }, Qt::QueuedConnection);
+
+    const QString traceFileName = parser.value(u"trace"_s);
+    if (!traceFileName.isEmpty())
+        Tracer::start();
+    for (qsizetype i = 0; i < jobs->size(); ++i)
+        server.addJob(jobs->at(i), static_cast<qint64>(i));
+    app.exec();
+    if (!traceFileName.isEmpty() && !Tracer::finish(traceFileName))
+        result = 1;
+    return result;
+}
+
+// The bench command runs the encoder with per-stage profiling and reports where the time went
+int encoder(QGuiApplication& app, QCommandLineParser& parser, const QString& command)
+{
+    const bool bench = command == u"bench"_s;
+    parser.clearPositionalArguments();
+    parser.addPositionalArgument(command, u"%1 command."_s.arg(command), u"%1 [%1_options]"_s.arg(command));
+    parser.addOption({ { u"f"_s, u"fps"_s }, u"Output frames per second, can be integer or rational e.g. 30000/1001."_s, u"fps"_s, u"30"_s });
+    parser.addOption({ { u"r"_s, u"sampleRate"_s }, u"Output audio sample rate (Hz)."_s, u"sampleRate"_s, u"44100"_s });
+    parser.addOption({ { u"s"_s, u"size"_s }, u"Output video frame size, WxH."_s, u"size"_s, u"640x360"_s });
+    parser.addOption({ { u"w"_s, u"exitOnWarning"_s }, u"Exit on QML warnings."_s });
+    parser.addOption({ { u"l"_s, u"loglevel"_s }, u"FFmpeg log level."_s, u"loglevel"_s, u"warning"_s });
+    parser.addOption({ u"rendition"_s, u"Additional downscaled nut output, WxH[:pixelformat]:path (pixelformat rgba or bgra). Can be repeated."_s, u"rendition"_s });
+    parser.addOption({ u"segmentDuration"_s, u"Split output into segments of this many seconds, output must be a pattern e.g. out-%05d.nut."_s, u"seconds"_s });
+    parser.addOption({ u"segmentFrames"_s, u"Split output into segments of this many frames, output must be a pattern e.g. out-%05d.nut."_s, u"frames"_s });
+    parser.addOption({ u"manifest"_s, u"ffconcat manifest of completed segments, default manifest.ffconcat alongside the segments."_s, u"manifest"_s });
+    parser.addOption({ u"pipelineDepth"_s, u"Frames to decode ahead of and encode behind rendering on worker threads, 0 to run every stage on the main thread."_s, u"frames"_s, u"2"_s });
+    parser.addOption({ u"framesPerEvent"_s, u"Maximum frames to render per event loop iteration."_s, u"frames"_s, u"1"_s });
+    parser.addOption({ u"memoryLimit"_s, u"Session memory budget for decoded frames and buffers e.g. 8G, decoding ahead and queueing for encoding are throttled above it."_s, u"bytes"_s });
+    parser.addOption({ u"shaderCache"_s, u"Directory to persist the GPU pipeline cache in across runs, keyed by graphics backend and driver."_s, u"directory"_s });
+    parser.addOption({ u"shaderWarmup"_s, u"Create the pipelines for all transitions in the scene before rendering starts."_s });
+#ifdef MEDIAFX_ENABLE_IO_URING
+    parser.addOption({ u"fileIO"_s, u"File output method, avio, uring or uring-direct (io_uring with O_DIRECT)."_s, u"fileIO"_s, u"avio"_s });
+#endif
+    parser.addOption({ u"report"_s, u"Write a JSON performance report to this path when the session ends."_s, u"report"_s });
+    parser.addOption({ u"trace"_s, u"Write a Chrome trace event timeline of the frame pipeline to this path, viewable in Perfetto."_s, u"trace"_s });
+    if (!bench) {
+        parser.addOption({ u"batch"_s, u"Render the jobs of a JSON manifest one after another in this process, source is then a default for jobs and there is no output argument."_s, u"manifest"_s });
+        parser.addOption({ u"frameCache"_s, u"Memory for decoded clips reused between batch jobs e.g. 2G, 0 to disable."_s, u"bytes"_s, u"1G"_s });
+    }
+    if (bench)
+        parser.addOption({ u"json"_s, u"Also write the benchmark results as JSON to this path (or '-' for stdout)."_s, u"json"_s });
+    parser.addPositionalArgument(u"source"_s, u"QML source URL."_s);
+    if (bench)
+        parser.addPositionalArgument(u"output"_s, u"Output nut video path, default /dev/null."_s, u"[output]"_s);
+    else
+        parser.addPositionalArgument(u"output"_s, u"Output nut video path (or '-' for stdout, or shm:NAME for a shared memory ring)."_s);
+    parser.process(app);
+
+    applyLogLevel(parser);
+    if (!bench && parser.isSet(u"batch"_s))
+        return batch(app, parser);
 
     Rational frameRate { 0 };
     if (av_parse_video_rate(&frameRate, qUtf8Printable(parser.value(u"fps"_s))) < 0)
@@ -95,8 +312,28 @@ int encoder(QGuiApplication& app, QCommandLineParser& parser)
 
     int sampleRate = parser.value(u"sampleRate"_s).toInt();
 
-    const QStringList args = parser.positionalArguments();
-    if (args.size() != 3 || args.first() != u"encoder"_s)
+    const QString fileIO = fileIOOption(parser);
+
+    const int pipelineDepth = applyPipelineOptions(parser);
+    bool framesPerEventOk = false;
+    int framesPerEvent = parser.value(u"framesPerEvent"_s).toInt(&framesPerEventOk);
+    if (!framesPerEventOk || framesPerEvent < 1)
+        parser.showHelp(1);
+
+    QList<Rendition> renditions;
+    for (const auto& spec : parser.values(u"rendition"_s)) {
+        auto rendition = Rendition::fromString(spec);
+        if (!rendition) {
+            qCritical() << "Invalid rendition" << spec;
+            parser.showHelp(1);
+        }
+        renditions.append(*rendition);
+    }
+
+    QStringList args = parser.positionalArguments();
+    if (bench && args.size() == 2)
+        args.append(u"/dev/null"_s);
+    if (args.size() != 3 || args.first() != command)
         parser.showHelp(1);
 
     QUrl url(QUrl::fromLocalFile(args.at(1)));
@@ -104,6 +341,32 @@ int encoder(QGuiApplication& app, QCommandLineParser& parser)
     if (output == u"-"_s)
         output = u"pipe:"_s;
 
+    int segmentFrames = 0;
+    if (parser.isSet(u"segmentFrames"_s)) {
+        bool ok = false;
+        segmentFrames = parser.value(u"segmentFrames"_s).toInt(&ok);
+        if (!ok || segmentFrames <= 0)
+            parser.showHelp(1);
+    } else if (parser.isSet(u"segmentDuration"_s)) {
+        bool ok = false;
+        double segmentDuration = parser.value(u"segmentDuration"_s).toDouble(&ok);
+        if (!ok || segmentDuration <= 0)
+            parser.showHelp(1);
+        // Segments are cut on frame boundaries
+        segmentFrames = std::max(1, static_cast<int>(std::lround(segmentDuration * av_q2d(frameRate))));
+    }
+    QString manifest;
+    if (segmentFrames > 0) {
+        if (output == u"pipe:"_s) {
+            qCritical() << "Segmented output cannot be written to stdout";
+            parser.showHelp(1);
+        }
+        if (parser.isSet(u"manifest"_s))
+            manifest = parser.value(u"manifest"_s);
+        else
+            manifest = QFileInfo(output).dir().filePath(u"manifest.ffconcat"_s);
+    }
+
     QQmlApplicationEngine engine;
     RenderContext* renderContext = engine.singletonInstance<RenderContext*>("MediaFX", "RenderContext");
     Q_ASSERT(renderContext);
@@ -112,6 +375,15 @@ int encoder(QGuiApplication& app, QCommandLineParser& parser)
     renderContext->setFrameSize(frameSize);
     renderContext->setFrameRate(frameRate);
     renderContext->setSampleRate(sampleRate);
+    renderContext->setRenditions(renditions);
+    renderContext->setSegmentFrames(segmentFrames);
+    renderContext->setManifestFileName(manifest);
+    renderContext->setPipelineDepth(pipelineDepth);
+    renderContext->setFileIO(fileIO);
+    renderContext->setFramesPerEvent(framesPerEvent);
+    renderContext->setReportFileName(parser.value(u"report"_s));
+    renderContext->setShaderCacheDirectory(shaderCacheDirectory(parser));
+    renderContext->setShaderWarmup(parser.isSet(u"shaderWarmup"_s));
 
     auto fatalExit = [&engine]() {
         emit engine.exit(1);
@@ -120,8 +392,126 @@ int encoder(QGuiApplication& app, QCommandLineParser& parser)
         QObject::connect(&engine, &QQmlApplicationEngine::warnings, &engine, fatalExit, Qt::QueuedConnection);
     }
     QObject::connect(&engine, &QQmlApplicationEngine::objectCreationFailed, &engine, fatalExit, Qt::QueuedConnection);
+    const QString traceFileName = parser.value(u"trace"_s);
+    if (!traceFileName.isEmpty())
+        Tracer::start();
+    Profiler::setEnabled(bench);
+    QElapsedTimer timer;
+    timer.start();
     engine.load(QUrl(u"qrc:/qt/qml/MediaFX/app-encoder.qml"_s));
+    int result = app.exec();
+    const nanoseconds elapsed(timer.nsecsElapsed());
+    Profiler::setEnabled(false);
+    if (!traceFileName.isEmpty() && !Tracer::finish(traceFileName))
+        result = 1;
+    if (!bench)
+        return result;
 
+    // Every frame is muxed exactly once
+    const uint64_t frameCount = Profiler::totals(Profiler::Stage::Mux).count;
+    // Keep the report out of the video stream when it is written to stdout
+    QTextStream(output == u"pipe:"_s ? stderr : stdout) << Profiler::formatTable(frameCount, elapsed);
+    if (parser.isSet(u"json"_s)) {
+        QByteArray json = QJsonDocument(Profiler::toJson(frameCount, elapsed)).toJson();
+        QFile jsonFile;
+        QString jsonFileName = parser.value(u"json"_s);
+        bool opened = false;
+        if (jsonFileName == u"-"_s)
+            opened = jsonFile.open(stdout, QIODevice::WriteOnly);
+        else {
+            jsonFile.setFileName(jsonFileName);
+            opened = jsonFile.open(QIODevice::WriteOnly | QIODevice::Truncate);
+        }
+        if (!opened || jsonFile.write(json) != json.size()) {
+            qCritical() << "Could not write benchmark JSON to" << jsonFileName;
+            return 1;
+        }
+    }
+    return result;
+}
+
+#ifdef MEDIAFX_ENABLE_FRAME_RING
+// Reference consumer for shm: output, muxes frames from the ring into a nut file
+int ringreader(QGuiApplication& app, QCommandLineParser& parser)
+{
+    parser.clearPositionalArguments();
+    parser.addPositionalArgument(u"ringreader"_s, u"ringreader command."_s, u"ringreader"_s);
+    parser.addPositionalArgument(u"ring"_s, u"Shared memory ring, shm:NAME."_s);
+    parser.addPositionalArgument(u"output"_s, u"Output nut video path (or '-' for stdout)."_s);
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 3 || args.first() != u"ringreader"_s)
+        parser.showHelp(1);
+    QString name = FrameRingWriter::sharedMemoryName(args.at(1));
+    if (name.isEmpty())
+        parser.showHelp(1);
+    QString output(args.at(2));
+    if (output == u"-"_s)
+        output = u"pipe:"_s;
+
+    FrameRingReader reader(name);
+    if (!reader.open())
+        return 1;
+    Muxer muxer;
+    if (!muxer.open(output, reader.frameSize(), reader.pixelFormat(), reader.frameRate(), reader.sampleRate()))
+        return 1;
+
+    QAudioFormat audioFormat;
+    audioFormat.setSampleFormat(AudioSampleFormat_Qt);
+    audioFormat.setChannelConfig(AudioChannelLayout_Qt);
+    audioFormat.setSampleRate(reader.sampleRate());
+    while (auto frame = reader.acquire()) {
+        // Muxer only reads the video data, so wrap the ring memory without copying
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        QByteArray videoData = QByteArray::fromRawData(reinterpret_cast<const char*>(frame->videoData), static_cast<qsizetype>(frame->videoByteSize));
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        QAudioBuffer audioBuffer(QByteArray::fromRawData(reinterpret_cast<const char*>(frame->audioData), static_cast<qsizetype>(frame->audioByteSize)), audioFormat);
+        if (!muxer.write(audioBuffer, videoData))
+            return 1;
+        reader.release();
+    }
+    if (reader.isWriterLost())
+        return 1;
+    return muxer.finish() ? 0 : 1;
+}
+#endif
+
+// Runs encoder jobs received on a local socket in one process, see RenderServer
+int serve(QGuiApplication& app, QCommandLineParser& parser)
+{
+    parser.clearPositionalArguments();
+    parser.addPositionalArgument(u"serve"_s, u"serve command."_s, u"serve [serve_options]"_s);
+    parser.addOption({ { u"l"_s, u"loglevel"_s }, u"FFmpeg log level."_s, u"loglevel"_s, u"warning"_s });
+    parser.addOption({ u"pipelineDepth"_s, u"Frames to decode ahead of and encode behind rendering on worker threads, 0 to run every stage on the main thread."_s, u"frames"_s, u"2"_s });
+    parser.addOption({ u"memoryLimit"_s, u"Memory budget for decoded frames and buffers of each job e.g. 8G, decoding ahead and queueing for encoding are throttled above it."_s, u"bytes"_s });
+    parser.addOption({ u"shaderCache"_s, u"Directory to persist the GPU pipeline cache in across runs, keyed by graphics backend and driver."_s, u"directory"_s });
+    parser.addOption({ u"shaderWarmup"_s, u"Create the pipelines for all transitions in each job before rendering starts."_s });
+    parser.addOption({ u"frameCache"_s, u"Memory for decoded clips reused between jobs e.g. 2G, 0 to disable."_s, u"bytes"_s, u"1G"_s });
+    parser.addPositionalArgument(u"socket"_s, u"Path of the Unix domain socket to accept JSON render jobs on."_s);
+    parser.process(app);
+
+    applyLogLevel(parser);
+
+    const int pipelineDepth = applyPipelineOptions(parser);
+    applyFrameCache(parser);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 2 || args.first() != u"serve"_s)
+        parser.showHelp(1);
+
+    // Not a QQmlApplicationEngine, which would quit the application when a session exits
+    QQmlEngine engine;
+    RenderContext* renderContext = engine.singletonInstance<RenderContext*>("MediaFX", "RenderContext");
+    Q_ASSERT(renderContext);
+    // These apply to the RenderWindow shared by every job
+    renderContext->setPipelineDepth(pipelineDepth);
+    renderContext->setShaderCacheDirectory(shaderCacheDirectory(parser));
+    renderContext->setShaderWarmup(parser.isSet(u"shaderWarmup"_s));
+
+    RenderServer server(&engine);
+    if (!server.initialize() || !server.listen(args.at(1)))
+        return 1;
     return app.exec();
 }
 
@@ -169,7 +559,7 @@ int main(int argc, char* argv[])
 {
 #ifdef TARGET_OS_MAC
     // Need to hack this before we create QGuiApplication
-    if (argc > 1 && strcmp("encoder", argv[1]) == 0)
+    if (argc > 1 && (strcmp("encoder", argv[1]) == 0 || strcmp("bench", argv[1]) == 0 || strcmp("serve", argv[1]) == 0))
         putenv(
             const_cast<char*>("QT_MAC_DISABLE_FOREGROUND_APPLICATION_TRANSFORM=1"));
 #endif
@@ -191,17 +581,23 @@ int main(int argc, char* argv[])
     parser.setSingleDashWordOptionMode(QCommandLineParser::ParseAsLongOptions);
     parser.addHelpOption();
     parser.addVersionOption();
-    parser.addPositionalArgument(u"command"_s, u"The command to execute"_s, u"<encoder | viewer>"_s);
+    parser.addPositionalArgument(u"command"_s, u"The command to execute"_s, u"<encoder | bench | serve | viewer | ringreader>"_s);
     parser.parse(QCoreApplication::arguments());
 
     const QStringList commandArgs = parser.positionalArguments();
     if (commandArgs.size() < 1)
         parser.showHelp(1);
     QString command = commandArgs.first();
-    if (command == u"encoder"_s) {
-        return encoder(app, parser);
+    if (command == u"encoder"_s || command == u"bench"_s) {
+        return encoder(app, parser, command);
+    } else if (command == u"serve"_s) {
+        return serve(app, parser);
     } else if (command == u"viewer"_s) {
         return viewer(app, parser);
+#ifdef MEDIAFX_ENABLE_FRAME_RING
+    } else if (command == u"ringreader"_s) {
+        return ringreader(app, parser);
+#endif
     } else {
         parser.showHelp(1);
     }
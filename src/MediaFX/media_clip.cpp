@@ -3,18 +3,26 @@
 
 #include "media_clip.h"
 #include "audio_renderer.h"
+#include "decode_queue.h"
 #include "decoder.h"
+#include "frame_cache.h"
 #include "interval.h"
+#include "memory_accounting.h"
 #include "render_context.h"
 #include "render_session.h"
 #include "util.h"
+#include <QAudioBuffer>
+#include <QJsonObject>
 #include <QObject>
 #include <QQmlEngine>
 #include <QQmlInfo>
 #include <QUrl>
+#include <QVideoFrame>
 #include <QVideoSink>
 #include <chrono>
 #include <compare>
+#include <memory>
+#include <optional>
 #include <ratio>
 using namespace std::chrono;
 using namespace std::chrono_literals;
@@ -27,12 +35,24 @@ using namespace std::chrono_literals;
     \brief Plays audio and video frames from a \l source.
 */
 MediaClip::MediaClip(QObject* parent)
+    : MediaClip(std::make_unique<Decoder>(), parent)
+{
+}
+
+MediaClip::MediaClip(std::unique_ptr<Decoder> decoder, QObject* parent)
     : QObject(parent)
-    , m_decoder(std::make_unique<Decoder>())
+    , m_decoder(std::move(decoder))
 {
 }
 
-MediaClip::~MediaClip() = default;
+MediaClip::~MediaClip()
+{
+    if (m_renderSession) {
+        if (m_active)
+            m_renderSession->setMediaClipActive(this, false);
+        m_renderSession->unscheduleMediaClip(this);
+    }
+}
 
 /*!
     \qmlproperty url MediaClip::source
@@ -127,29 +147,70 @@ void MediaClip::render()
     if (!isActive())
         return;
 
-    if (!m_decoder->decode()) {
+    QVideoFrame videoFrame;
+    QAudioBuffer audioBuffer;
+    if (!nextFrame(videoFrame, audioBuffer)) {
         m_renderSession->fatalError();
         return;
     }
 
     for (auto videoSink : m_videoSinks) {
-        videoSink->setVideoFrame(m_decoder->outputVideoFrame());
+        videoSink->setVideoFrame(videoFrame);
     }
     if (m_audioRenderer && hasAudio())
-        m_audioRenderer->addAudioBuffer(m_decoder->outputAudioBuffer());
+        m_audioRenderer->addAudioBuffer(audioBuffer);
 
     m_frameCount++;
     m_currentFrameTime = m_currentFrameTime.nextInterval(
         m_startTimeAdjusted + duration_cast<microseconds>(m_frameCount * frameRateToFrameDuration(m_renderSession->frameRate())));
     if (m_currentFrameTime.start() >= m_endTimeAdjusted) {
         emit clipEnded();
-        m_decoder.reset();
+        closeMedia();
         updateActive();
         return;
     }
     emit currentFrameTimeChanged();
 }
 
+bool MediaClip::nextFrame(QVideoFrame& videoFrame, QAudioBuffer& audioBuffer)
+{
+    if (m_cachedClip) {
+        // A longer cached clip has more frames than we play
+        const FrameCache::Frame& frame = m_cachedClip->frames.at(qMin(static_cast<size_t>(m_frameCount - 1), m_cachedClip->frames.size() - 1));
+        videoFrame = frame.videoFrame;
+        audioBuffer = frame.audioBuffer;
+    } else if (m_renderSession->pipelineDepth() > 0) {
+        // Decode ahead on a worker thread while the current frame renders
+        startDecodeQueue();
+        std::optional<DecodeQueue::Frame> frame = m_decodeQueue->pop();
+        if (!frame)
+            return false;
+        videoFrame = frame->videoFrame;
+        audioBuffer = frame->audioBuffer;
+        if (m_frameRecorder && !m_frameRecorder->add(videoFrame, audioBuffer, false))
+            m_frameRecorder.reset();
+    } else {
+        if (!m_decoder->decode())
+            return false;
+        videoFrame = m_decoder->outputVideoFrame();
+        audioBuffer = m_decoder->outputAudioBuffer();
+        if (m_frameRecorder && !m_frameRecorder->add(videoFrame, audioBuffer, true))
+            m_frameRecorder.reset();
+    }
+    return true;
+}
+
+void MediaClip::closeMedia()
+{
+    if (m_frameRecorder) {
+        m_frameRecorder->finish(m_endTimeAdjusted);
+        m_frameRecorder.reset();
+    }
+    m_cachedClip.reset();
+    m_decodeQueue.reset();
+    m_decoder.reset();
+}
+
 /*!
     \qmlproperty bool MediaClip::active
 
@@ -159,14 +220,17 @@ void MediaClip::setActive(bool active)
 {
     if (m_active != active) {
         m_active = active;
+        if (m_renderSession)
+            m_renderSession->setMediaClipActive(this, active);
         emit activeChanged();
     }
 }
 
 void MediaClip::updateActive()
 {
-    // We are active if we are rendering video, or we have no video track but do have audio
-    setActive(m_decoder && ((hasVideo() && !m_videoSinks.isEmpty()) || (!hasVideo() && hasAudio())));
+    // We are active if we are rendering video, or we have no video track but do have audio.
+    // Deferred clips are inactive until loaded.
+    setActive(!m_loadDeferred && ((hasVideo() && !m_videoSinks.isEmpty()) || (!hasVideo() && hasAudio())));
 }
 
 void MediaClip::addVideoSink(QVideoSink* videoSink)
@@ -184,20 +248,62 @@ void MediaClip::removeVideoSink(const QVideoSink* videoSink)
     }
 }
 
+QVideoSink* MediaClip::attachVideoItem()
+{
+    if (!m_sharedVideoSink)
+        m_sharedVideoSink = new QVideoSink(this); // NOLINT(cppcoreguidelines-owning-memory)
+    if (m_videoItemCount++ == 0)
+        addVideoSink(m_sharedVideoSink);
+    return m_sharedVideoSink;
+}
+
+void MediaClip::detachVideoItem()
+{
+    if (m_videoItemCount > 0 && --m_videoItemCount == 0)
+        removeVideoSink(m_sharedVideoSink);
+}
+
+/*!
+    \qmlmethod object MediaClip::memoryUsage
+
+    Live and peak bytes held decoding this clip, in total and by category.
+    The session report totals them for all clips with the same \l source.
+    Frames played from or kept in the frame cache are only counted for the source,
+    and codec and filtergraph state is not counted.
+    \sa RenderSession::memoryUsage
+*/
+QJsonObject MediaClip::memoryUsage() const
+{
+    return m_memoryAccount ? m_memoryAccount->toJson() : MemoryAccounting::Account().toJson();
+}
+
+const std::shared_ptr<MemoryAccounting::Account>& MediaClip::memoryAccount()
+{
+    if (!m_memoryAccount)
+        m_memoryAccount = MemoryAccounting::createClipAccount(source().toLocalFile());
+    return m_memoryAccount;
+}
+
 void MediaClip::onDecoderErrorMessage(const QString& message)
 {
     qmlWarning(this) << message << "(source" << source() << ")";
 }
 
+void MediaClip::startDecodeQueue()
+{
+    if (!m_decodeQueue)
+        m_decodeQueue = std::make_unique<DecodeQueue>(m_decoder.get(), m_renderSession->pipelineDepth());
+}
+
 void MediaClip::loadMedia()
 {
+    m_mediaLoaded = true;
     if (!source().isValid()) {
         qmlWarning(this) << "MediaClip requires source Url";
         m_renderSession->fatalError();
         return;
     }
-    connect(m_decoder.get(), &Decoder::errorMessage, this, &MediaClip::onDecoderErrorMessage);
-    if (m_decoder->open(source().toLocalFile(), m_renderSession->frameRate(), m_renderSession->outputAudioFormat(), m_startTimeAdjusted) < 0) {
+    if (!openMedia()) {
         m_renderSession->fatalError();
         return;
     }
@@ -205,13 +311,59 @@ void MediaClip::loadMedia()
     updateActive();
 }
 
+bool MediaClip::openMedia()
+{
+    // The end time is needed to know whether a cached clip has enough frames
+    std::optional<FrameCache::Key> frameCacheKey;
+    if (FrameCache::isEnabled() && m_endTimeAdjusted >= 0us)
+        frameCacheKey = FrameCache::key(source().toLocalFile(), m_startTimeAdjusted, m_renderSession->frameRate(), m_renderSession->outputAudioFormat());
+    if (frameCacheKey) {
+        m_cachedClip = FrameCache::find(*frameCacheKey, m_endTimeAdjusted);
+        if (m_cachedClip) {
+            m_decoder.reset();
+            return true;
+        }
+    }
+    connect(m_decoder.get(), &Decoder::errorMessage, this, &MediaClip::onDecoderErrorMessage);
+    m_decoder->setMemoryAccount(memoryAccount());
+    if (m_decoder->open(source().toLocalFile(), m_renderSession->frameRate(), m_renderSession->outputAudioFormat(), m_startTimeAdjusted) < 0)
+        return false;
+    if (frameCacheKey)
+        m_frameRecorder = std::make_unique<FrameCache::Recorder>(*frameCacheKey, hasVideo(), hasAudio());
+    return true;
+}
+
+void MediaClip::load()
+{
+    if (!m_loadDeferred)
+        return;
+    m_loadDeferred = false;
+    if (m_mediaLoaded)
+        updateActive();
+    else
+        loadMedia();
+}
+
+void MediaClip::preload(const microseconds& startsIn)
+{
+    if (!m_loadDeferred)
+        return;
+    if (!m_mediaLoaded) {
+        loadMedia();
+        // Start decoding the first frames
+        if (m_renderSession->pipelineDepth() > 0 && m_decoder && (hasVideo() || hasAudio()))
+            startDecodeQueue();
+    }
+    // Decoding further ahead of rendering is throttled first
+    if (m_decodeQueue)
+        m_decodeQueue->setStartsIn(startsIn);
+}
+
 void MediaClip::classBegin()
 {
     m_renderSession = RenderSession::findSession(this);
     if (m_renderSession) {
-        connect(
-            m_renderSession, &RenderSession::renderMediaClips,
-            this, &MediaClip::render);
+        m_renderOrder = m_renderSession->nextMediaClipOrder();
     } else {
         qmlWarning(this) << "MediaClip could not find renderSession in context";
         emit qmlEngine(this)->exit(1);
@@ -223,9 +375,27 @@ void MediaClip::componentComplete()
     m_componentComplete = true;
     if (startTime() < 0)
         setStartTime(0);
-    loadMedia();
-    if (endTime() < 0) {
-        setEndTime(m_decoder->duration());
+    if (m_loadDeferred) {
+        if (endTime() < 0) {
+            microseconds duration = Decoder::probeDuration(source().toLocalFile());
+            if (duration < 0us) {
+                qmlWarning(this) << "MediaClip failed to probe duration (source" << source() << ")";
+                m_renderSession->fatalError();
+                return;
+            }
+            setEndTime(duration);
+        }
+    } else {
+        // Probing is cheap compared to decoding a clip that may be cached
+        if (endTime() < 0 && FrameCache::isEnabled()) {
+            microseconds duration = Decoder::probeDuration(source().toLocalFile());
+            if (duration >= 0us)
+                setEndTime(duration);
+        }
+        loadMedia();
+        if (endTime() < 0) {
+            setEndTime(m_decoder->duration());
+        }
     }
     m_currentFrameTime = Interval(m_startTimeAdjusted, m_startTimeAdjusted + frameRateToFrameDuration<microseconds>(m_renderSession->frameRate()));
     emit currentFrameTimeChanged();
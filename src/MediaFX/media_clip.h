@@ -5,18 +5,27 @@
 
 #include "audio_renderer.h"
 #include "decoder.h"
+#include "frame_cache.h"
 #include "interval.h"
+#include "memory_accounting.h"
+#include <QAudioBuffer>
+#include <QJsonObject>
 #include <QList>
 #include <QObject>
 #include <QPointer>
 #include <QQmlParserStatus>
 #include <QString>
 #include <QUrl>
+#include <QVideoFrame>
 #include <QVideoSink> // IWYU pragma: keep
 #include <QtCore>
 #include <QtQmlIntegration>
 #include <chrono>
 #include <memory>
+#include <optional>
+#include <stdint.h>
+class DecodeQueue;
+class VideoFrameTexture;
 class RenderSession;
 using namespace std::chrono;
 using namespace std::chrono_literals;
@@ -70,22 +79,60 @@ public:
     void setActive(bool active);
     bool isActive() const { return m_active; };
 
-    bool hasAudio() const { return m_decoder && m_decoder->hasAudio(); }
-    bool hasVideo() const { return m_decoder && m_decoder->hasVideo(); }
+    virtual bool hasAudio() const { return m_cachedClip ? m_cachedClip->hasAudio : m_decoder && m_decoder->hasAudio(); }
+    virtual bool hasVideo() const { return m_cachedClip ? m_cachedClip->hasVideo : m_decoder && m_decoder->hasVideo(); }
 
     Q_INVOKABLE void addVideoSink(QVideoSink* videoSink);
     Q_INVOKABLE void removeVideoSink(const QVideoSink* videoSink);
 
+    // VideoItems rendering this clip share one sink, and one texture each frame is uploaded to once
+    QVideoSink* attachVideoItem();
+    void detachVideoItem();
+    // Only used on the render thread while the GUI thread is blocked synchronizing
+    std::weak_ptr<VideoFrameTexture>& sharedVideoTexture() { return m_sharedVideoTexture; }
+
+    Q_INVOKABLE QJsonObject memoryUsage() const;
+
     void render();
 
     void updateActive();
 
+    // Defer opening the decoder from componentComplete() until load(),
+    // a default endTime is probed from the source instead.
+    void setLoadDeferred(bool loadDeferred) { m_loadDeferred = loadDeferred; }
+    bool isLoadDeferred() const { return m_loadDeferred; }
+    void load();
+    // Opens the decoder of a deferred clip ahead of load(), without activating it.
+    // startsIn is how long until the session renders the clip.
+    void preload(const microseconds& startsIn);
+
+    // Order clips are rendered in by RenderSession
+    int64_t renderOrder() const { return m_renderOrder; }
+
 protected:
+    // For subclasses that produce frames without a Decoder
+    MediaClip(std::unique_ptr<Decoder> decoder, QObject* parent);
+
     void classBegin() override;
     void componentComplete() override;
 
     void loadMedia();
+    // Opens the source, returns false on a fatal error
+    virtual bool openMedia();
+    // Produces the frame to render next, returns false on a fatal error
+    virtual bool nextFrame(QVideoFrame& videoFrame, QAudioBuffer& audioBuffer);
+    // Releases the source once the clip has ended
+    virtual void closeMedia();
+    void startDecodeQueue();
     bool isComponentComplete() { return m_componentComplete; };
+    RenderSession* renderSession() const { return m_renderSession; }
+    // startTime and endTime rounded to output frame boundaries
+    const microseconds& startTimeAdjusted() const { return m_startTimeAdjusted; }
+    const microseconds& endTimeAdjusted() const { return m_endTimeAdjusted; }
+    // Source time interval of the frame being rendered
+    const Interval<microseconds>& currentFrameInterval() const { return m_currentFrameTime; }
+    // This clip's Account, created for its source when first used
+    const std::shared_ptr<MemoryAccounting::Account>& memoryAccount();
 
 private slots:
     void onDecoderErrorMessage(const QString& message);
@@ -96,6 +143,9 @@ private:
     void setEndTime(const microseconds& us);
 
     bool m_componentComplete = false;
+    bool m_loadDeferred = false;
+    bool m_mediaLoaded = false;
+    int64_t m_renderOrder = -1;
     bool m_active = false;
     QPointer<RenderSession> m_renderSession;
     QUrl m_source;
@@ -107,7 +157,17 @@ private:
     int m_frameCount = 1;
     Interval<microseconds> m_currentFrameTime { -1us, -1us };
 
+    // Declared before anything holding allocations against it so it is destroyed last
+    std::shared_ptr<MemoryAccounting::Account> m_memoryAccount;
     std::unique_ptr<Decoder> m_decoder;
+    // Declared after m_decoder so it is destroyed first
+    std::unique_ptr<DecodeQueue> m_decodeQueue;
+    // Frames played from the FrameCache instead of decoding, or recorded into it while decoding
+    std::shared_ptr<const FrameCache::Clip> m_cachedClip;
+    std::unique_ptr<FrameCache::Recorder> m_frameRecorder;
     QList<QPointer<QVideoSink>> m_videoSinks;
+    QVideoSink* m_sharedVideoSink = nullptr;
+    int m_videoItemCount = 0;
+    std::weak_ptr<VideoFrameTexture> m_sharedVideoTexture;
     QPointer<AudioRenderer> m_audioRenderer;
 };
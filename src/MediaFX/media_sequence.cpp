@@ -0,0 +1,317 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "media_sequence.h"
+#include "interval.h"
+#include "media_clip.h"
+#include "render_session.h"
+#include <QObject>
+#include <QQmlComponent>
+#include <QQmlContext>
+#include <QQmlEngine>
+#include <QQmlInfo>
+#include <QQmlListReference>
+#include <QQuickItem>
+#include <QVariant>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+using namespace std::chrono;
+using namespace std::chrono_literals;
+
+/*!
+    \qmltype MediaSequence
+    //! \instantiates MediaSequence
+    \inqmlmodule MediaFX
+    \inherits Item
+    \brief Plays a sequence of \l MediaSequenceClip components in order, with \l MediaTransition transitions between them.
+
+    The timeline of clips and transitions is computed once when the sequence is complete.
+    All clips are created up front, but each clip only opens its decoder shortly before
+    it is scheduled to play, and is destroyed once it ends.
+
+    \quotefile sequence.qml
+
+    \sa MediaTransition
+*/
+MediaSequence::MediaSequence(QQuickItem* parent)
+    : QQuickItem(parent)
+{
+}
+
+MediaSequence::~MediaSequence() = default;
+
+/*!
+    \qmlproperty list<Component> MediaSequence::mediaClips
+    \qmldefault
+
+    The sequence of \l MediaSequenceClip components to play in order.
+*/
+
+/*!
+    \qmlproperty MediaTransition MediaSequence::currentTransition
+
+    The currently active MediaTransition, or \c null.
+*/
+void MediaSequence::setCurrentTransition(QQuickItem* transition)
+{
+    if (m_currentTransition != transition) {
+        m_currentTransition = transition;
+        emit currentTransitionChanged();
+    }
+}
+
+/*!
+    \qmlproperty enumeration MediaSequence::fillMode
+    \sa {VideoOutput::fillMode}
+*/
+void MediaSequence::setFillMode(int fillMode)
+{
+    if (m_fillMode != fillMode) {
+        m_fillMode = fillMode;
+        for (auto container : { &m_mainContainer, &m_auxContainer }) {
+            if (container->renderer)
+                container->renderer->setProperty("fillMode", m_fillMode);
+        }
+        emit fillModeChanged();
+    }
+}
+
+/*!
+    \qmlproperty int MediaSequence::orientation
+    \sa {VideoOutput::orientation}
+*/
+void MediaSequence::setOrientation(int orientation)
+{
+    if (m_orientation != orientation) {
+        m_orientation = orientation;
+        for (auto container : { &m_mainContainer, &m_auxContainer }) {
+            if (container->renderer)
+                container->renderer->setProperty("orientation", m_orientation);
+        }
+        emit orientationChanged();
+    }
+}
+
+QList<QQuickItem*> MediaSequence::pendingTransitions() const
+{
+    QList<QQuickItem*> transitions;
+    for (size_t i = m_currentIndex; i < m_timeline.size(); i++) {
+        const TimelineEntry& entry = m_timeline.at(i);
+        if (entry.endTransition && entry.transitionStart > 0us && !entry.endTransition->parentItem())
+            transitions.append(entry.endTransition);
+    }
+    return transitions;
+}
+
+/*!
+    \qmlsignal MediaSequence::mediaSequenceEnded()
+
+    This signal is emitted when the last clip in the sequence has finished playback.
+*/
+
+void MediaSequence::classBegin()
+{
+    QQuickItem::classBegin();
+    m_renderSession = RenderSession::findSession(this);
+    if (!m_renderSession) {
+        qmlWarning(this) << "MediaSequence could not find renderSession in context";
+        emit qmlEngine(this)->exit(1);
+    }
+}
+
+void MediaSequence::componentComplete()
+{
+    QQuickItem::componentComplete();
+    if (!m_renderSession)
+        return;
+
+    m_transitionContainer = new QQuickItem(this); // NOLINT(cppcoreguidelines-owning-memory)
+    m_transitionContainer->setVisible(false);
+    m_transitionContainer->setSize(size());
+    if (!createVideoContainer(m_mainContainer) || !createVideoContainer(m_auxContainer)) {
+        m_renderSession->fatalError();
+        return;
+    }
+    m_auxContainer.item->setVisible(false);
+
+    if (!buildTimeline()) {
+        m_renderSession->fatalError();
+        return;
+    }
+    activateClip(0);
+}
+
+bool MediaSequence::buildTimeline()
+{
+    if (m_mediaClips.isEmpty()) {
+        qmlWarning(this) << "MediaSequence requires mediaClips";
+        return false;
+    }
+    m_timeline.reserve(m_mediaClips.size());
+    // Session time the next clip starts
+    microseconds sessionTime = milliseconds(m_renderSession->currentRenderTime().start());
+    for (QQmlComponent* component : std::as_const(m_mediaClips)) {
+        QObject* object = component->beginCreate(component->creationContext());
+        auto clip = qobject_cast<MediaClip*>(object);
+        if (clip) {
+            clip->setParent(this);
+            // Decoders are opened as the clips are scheduled and activated
+            clip->setLoadDeferred(true);
+        }
+        component->completeCreate();
+        if (!clip) {
+            delete object; // NOLINT(cppcoreguidelines-owning-memory)
+            qmlWarning(this) << "MediaSequence mediaClips must be MediaSequenceClip components" << component->errorString();
+            return false;
+        }
+
+        TimelineEntry& entry = m_timeline.emplace_back();
+        entry.clip = clip;
+        entry.endTransition = clip->property("endTransition").value<QQuickItem*>();
+        entry.transformer = clip->property("transformer").value<QObject*>();
+        entry.end = milliseconds(clip->endTime());
+        if (entry.endTransition && m_timeline.size() < static_cast<size_t>(m_mediaClips.size())) {
+            const milliseconds transitionDuration(std::min(static_cast<qint64>(entry.endTransition->property("duration").toInt()), clip->duration()));
+            entry.transitionStart = entry.end - transitionDuration;
+        }
+
+        // Let the session open the decoder before the clip is needed
+        const microseconds clipStart = milliseconds(clip->startTime());
+        m_renderSession->scheduleMediaClip(clip, Interval(sessionTime, sessionTime + std::max(entry.end - clipStart, 0us)));
+        sessionTime += (entry.transitionStart > 0us ? entry.transitionStart : entry.end) - clipStart;
+    }
+    return true;
+}
+
+bool MediaSequence::createVideoContainer(VideoContainer& container)
+{
+    container.item = new QQuickItem(this); // NOLINT(cppcoreguidelines-owning-memory)
+    container.item->setClip(true);
+
+    QQmlComponent component(qmlEngine(this), "MediaFX", "VideoRenderer");
+    QObject* object = component.beginCreate(qmlContext(this));
+    container.renderer = qobject_cast<QQuickItem*>(object);
+    if (!container.renderer) {
+        delete object; // NOLINT(cppcoreguidelines-owning-memory)
+        qmlWarning(this) << "MediaSequence failed to create VideoRenderer" << component.errorString();
+        return false;
+    }
+    container.renderer->setParent(container.item);
+    container.renderer->setParentItem(container.item);
+    container.renderer->setProperty("fillMode", m_fillMode);
+    container.renderer->setProperty("orientation", m_orientation);
+    component.completeCreate();
+    updateContainerGeometry(container);
+    return true;
+}
+
+void MediaSequence::setContainerEntry(VideoContainer& container, const TimelineEntry* entry)
+{
+    container.entry = entry;
+    container.renderer->setProperty("mediaClip", QVariant::fromValue(entry ? entry->clip.data() : nullptr));
+    QQmlListReference transforms(container.renderer, "transform");
+    transforms.clear();
+    if (entry && entry->transformer) {
+        if (auto transform = entry->transformer->property("transform").value<QObject*>())
+            transforms.append(transform);
+    }
+    updateContainerGeometry(container);
+}
+
+void MediaSequence::updateContainerGeometry(VideoContainer& container)
+{
+    if (!container.renderer)
+        return;
+    container.item->setSize(size());
+    container.renderer->setSize(size());
+    if (container.entry && container.entry->transformer) {
+        container.entry->transformer->setProperty("width", width());
+        container.entry->transformer->setProperty("height", height());
+    }
+}
+
+void MediaSequence::geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry)
+{
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    if (!m_transitionContainer)
+        return;
+    m_transitionContainer->setSize(size());
+    if (m_currentTransition)
+        m_currentTransition->setSize(size());
+    updateContainerGeometry(m_mainContainer);
+    updateContainerGeometry(m_auxContainer);
+}
+
+void MediaSequence::activateClip(size_t index)
+{
+    m_currentIndex = index;
+    m_transitioning = false;
+    const TimelineEntry& entry = m_timeline.at(index);
+    // Already loaded if the previous clip transitioned to this one
+    entry.clip->load();
+    connect(entry.clip, &MediaClip::clipEnded, this, &MediaSequence::onClipEnded);
+    if (entry.transitionStart > 0us)
+        connect(entry.clip, &MediaClip::currentFrameTimeChanged, this, &MediaSequence::onCurrentFrameTimeChanged);
+
+    setContainerEntry(m_mainContainer, &entry);
+    setContainerEntry(m_auxContainer, nullptr);
+    m_mainContainer.item->setVisible(true);
+    m_transitionContainer->setVisible(false);
+}
+
+void MediaSequence::beginTransition()
+{
+    m_transitioning = true;
+    const TimelineEntry& entry = m_timeline.at(m_currentIndex);
+    const TimelineEntry& nextEntry = m_timeline.at(m_currentIndex + 1);
+    nextEntry.clip->load();
+
+    // Hide the containers before the transition samples them
+    m_mainContainer.item->setVisible(false);
+    m_transitionContainer->setVisible(true);
+    entry.endTransition->setParentItem(m_transitionContainer);
+    entry.endTransition->setSize(size());
+    entry.endTransition->setProperty("source", QVariant::fromValue(m_mainContainer.item));
+    entry.endTransition->setProperty("dest", QVariant::fromValue(m_auxContainer.item));
+    setCurrentTransition(entry.endTransition);
+
+    setContainerEntry(m_auxContainer, &nextEntry);
+}
+
+void MediaSequence::onCurrentFrameTimeChanged()
+{
+    const TimelineEntry& entry = m_timeline.at(m_currentIndex);
+    const milliseconds frameStart(entry.clip->currentFrameTime().start());
+    if (frameStart < entry.transitionStart)
+        return;
+    if (!m_transitioning)
+        beginTransition();
+    const duration<double> elapsed = frameStart - entry.transitionStart;
+    const duration<double> window = entry.end - entry.transitionStart;
+    entry.endTransition->setProperty("time", elapsed / window);
+}
+
+void MediaSequence::onClipEnded()
+{
+    if (m_currentIndex + 1 >= m_timeline.size()) {
+        emit mediaSequenceEnded();
+        return;
+    }
+    // The clip ended while rendering clips, switch once this frame has rendered
+    connect(m_renderSession, &RenderSession::currentRenderTimeChanged, this, &MediaSequence::advanceClip, Qt::SingleShotConnection);
+}
+
+void MediaSequence::advanceClip()
+{
+    const TimelineEntry& entry = m_timeline.at(m_currentIndex);
+    entry.clip->disconnect(this);
+    if (entry.endTransition) {
+        entry.endTransition->setParentItem(nullptr);
+        setCurrentTransition(nullptr);
+    }
+    // Release the video sinks before destroying the clip (and its endTransition)
+    setContainerEntry(m_mainContainer, nullptr);
+    entry.clip->deleteLater();
+    activateClip(m_currentIndex + 1);
+}
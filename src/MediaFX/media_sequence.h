@@ -0,0 +1,108 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QQmlComponent>
+#include <QQmlListProperty>
+#include <QQuickItem>
+#include <QRectF>
+#include <QtQmlIntegration>
+#include <chrono>
+#include <stddef.h>
+#include <vector>
+class MediaClip;
+class RenderSession;
+using namespace std::chrono;
+
+class MediaSequence : public QQuickItem {
+    Q_OBJECT
+    Q_PROPERTY(QQmlListProperty<QQmlComponent> mediaClips READ mediaClips FINAL REQUIRED)
+    Q_PROPERTY(QQuickItem* currentTransition READ currentTransition NOTIFY currentTransitionChanged FINAL)
+    Q_PROPERTY(int fillMode READ fillMode WRITE setFillMode NOTIFY fillModeChanged FINAL)
+    Q_PROPERTY(int orientation READ orientation WRITE setOrientation NOTIFY orientationChanged FINAL)
+    Q_CLASSINFO("DefaultProperty", "mediaClips")
+    QML_ELEMENT
+
+public:
+    using QQuickItem::QQuickItem;
+
+    MediaSequence(QQuickItem* parent = nullptr);
+    MediaSequence(MediaSequence&&) = delete;
+    MediaSequence& operator=(MediaSequence&&) = delete;
+    ~MediaSequence() override;
+
+    QQmlListProperty<QQmlComponent> mediaClips() { return QQmlListProperty<QQmlComponent>(this, &m_mediaClips); }
+
+    QQuickItem* currentTransition() const { return m_currentTransition; }
+
+    int fillMode() const { return m_fillMode; }
+    void setFillMode(int fillMode);
+
+    int orientation() const { return m_orientation; }
+    void setOrientation(int orientation);
+
+    // Transitions still to be played that are not in the scene yet
+    QList<QQuickItem*> pendingTransitions() const;
+
+signals:
+    void currentTransitionChanged();
+    void fillModeChanged();
+    void orientationChanged();
+    void mediaSequenceEnded();
+
+protected:
+    void classBegin() override;
+    void componentComplete() override;
+    void geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry) override;
+
+private slots:
+    void onCurrentFrameTimeChanged();
+    void onClipEnded();
+
+private:
+    Q_DISABLE_COPY(MediaSequence);
+
+    // A clip and the window at its end (in clip time) where it transitions to the next clip
+    struct TimelineEntry {
+        QPointer<MediaClip> clip;
+        QPointer<QQuickItem> endTransition;
+        QPointer<QObject> transformer;
+        // -1us if there is no transition to the next clip
+        microseconds transitionStart { -1us };
+        microseconds end { 0us };
+    };
+
+    // Clipping container item for a VideoRenderer
+    struct VideoContainer {
+        QQuickItem* item = nullptr;
+        QQuickItem* renderer = nullptr;
+        const TimelineEntry* entry = nullptr;
+    };
+
+    bool buildTimeline();
+    bool createVideoContainer(VideoContainer& container);
+    void setContainerEntry(VideoContainer& container, const TimelineEntry* entry);
+    void updateContainerGeometry(VideoContainer& container);
+    void setCurrentTransition(QQuickItem* transition);
+    void activateClip(size_t index);
+    void beginTransition();
+    void advanceClip();
+
+    QList<QQmlComponent*> m_mediaClips;
+    QPointer<RenderSession> m_renderSession;
+    // Immutable once built in componentComplete()
+    std::vector<TimelineEntry> m_timeline;
+    size_t m_currentIndex = 0;
+    bool m_transitioning = false;
+    QPointer<QQuickItem> m_currentTransition;
+    // VideoOutput.PreserveAspectFit
+    int m_fillMode = Qt::KeepAspectRatio;
+    int m_orientation = 0;
+    QQuickItem* m_transitionContainer = nullptr;
+    VideoContainer m_mainContainer;
+    VideoContainer m_auxContainer;
+};
@@ -0,0 +1,115 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "memory_accounting.h"
+#include <QJsonObject>
+#include <QString>
+#include <memory>
+#include <mutex>
+using namespace Qt::Literals::StringLiterals;
+
+namespace {
+
+std::mutex s_accountsMutex; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+std::map<QString, std::unique_ptr<MemoryAccounting::Account>> s_clipAccounts; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+void updatePeak(std::atomic<int64_t>& peak, int64_t value)
+{
+    int64_t current = peak.load(std::memory_order_relaxed);
+    while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) { }
+}
+
+}
+
+void MemoryAccounting::Account::add(Category category, int64_t bytes)
+{
+    const auto index = static_cast<size_t>(category);
+    updatePeak(m_peak.at(index), m_live.at(index).fetch_add(bytes, std::memory_order_relaxed) + bytes);
+    updatePeak(m_peakTotal, m_liveTotal.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+    if (m_parent)
+        m_parent->add(category, bytes);
+}
+
+void MemoryAccounting::Account::resetPeak()
+{
+    for (size_t i = 0; i < CategoryCount; i++)
+        m_peak.at(i).store(m_live.at(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+    m_peakTotal.store(m_liveTotal.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+QJsonObject MemoryAccounting::Account::toJson() const
+{
+    QJsonObject json {
+        { u"liveBytes"_s, static_cast<qint64>(liveBytes()) },
+        { u"peakBytes"_s, static_cast<qint64>(peakBytes()) },
+    };
+    for (size_t i = 0; i < CategoryCount; i++) {
+        auto category = static_cast<Category>(i);
+        json.insert(QString::fromLatin1(categoryName(category)), QJsonObject {
+                                                                     { u"liveBytes"_s, static_cast<qint64>(liveBytes(category)) },
+                                                                     { u"peakBytes"_s, static_cast<qint64>(peakBytes(category)) },
+                                                                 });
+    }
+    return json;
+}
+
+MemoryAccounting::Account& MemoryAccounting::session()
+{
+    static Account session;
+    return session;
+}
+
+MemoryAccounting::Account* MemoryAccounting::clipAccount(const QString& source)
+{
+    std::lock_guard lock(s_accountsMutex);
+    auto& account = s_clipAccounts[source];
+    if (!account)
+        account = std::make_unique<Account>(&session());
+    return account.get();
+}
+
+std::shared_ptr<MemoryAccounting::Account> MemoryAccounting::createClipAccount(const QString& source)
+{
+    return std::make_shared<Account>(clipAccount(source));
+}
+
+void MemoryAccounting::resetPeaks()
+{
+    session().resetPeak();
+    std::lock_guard lock(s_accountsMutex);
+    for (auto& [source, account] : s_clipAccounts)
+        account->resetPeak();
+}
+
+const char* MemoryAccounting::categoryName(Category category)
+{
+    switch (category) {
+    case Category::VideoFrames:
+        return "videoFrames";
+    case Category::AudioBuffers:
+        return "audioBuffers";
+    case Category::Packets:
+        return "packets";
+    case Category::CodecFrames:
+        return "codecFrames";
+    case Category::FilterFrames:
+        return "filterFrames";
+    case Category::Readback:
+        return "readback";
+    }
+    return "";
+}
+
+QJsonObject MemoryAccounting::toJson()
+{
+    QJsonObject clips;
+    {
+        std::lock_guard lock(s_accountsMutex);
+        for (const auto& [source, account] : s_clipAccounts)
+            clips.insert(source, account->toJson());
+    }
+    return QJsonObject {
+        { u"session"_s, session().toJson() },
+        { u"clips"_s, clips },
+    };
+}
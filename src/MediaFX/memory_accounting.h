@@ -0,0 +1,129 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+// Live and peak bytes held by the frame pipeline, by category.
+// Each clip has an Account that adds to the Account for its source, which adds to the session Account.
+// Only buffers mediafx holds references to are counted. Codec and filtergraph contexts, the format context,
+// and memory pooled internally by libavcodec and libavfilter after it is released are not.
+class MemoryAccounting {
+public:
+    enum class Category {
+        // QVideoFrames decoded for a clip, including frames queued by DecodeQueue
+        VideoFrames,
+        // QAudioBuffers decoded for a clip, including buffers queued by DecodeQueue
+        AudioBuffers,
+        // Demuxed AVPackets
+        Packets,
+        // AVFrame buffers allocated by the codec, held as references or queued in the filtergraph
+        CodecFrames,
+        // AVFrames output by the filtergraph
+        FilterFrames,
+        // Rendered frames read back from the GPU, including frames queued for encoding
+        Readback,
+    };
+    static constexpr size_t CategoryCount = static_cast<size_t>(Category::Readback) + 1;
+
+    class Account {
+    public:
+        explicit Account(Account* parent = nullptr)
+            : m_parent(parent)
+        {
+        }
+        Account(Account&&) = delete;
+        Account(const Account&) = delete;
+        Account& operator=(Account&&) = delete;
+        Account& operator=(const Account&) = delete;
+        ~Account() = default;
+
+        // bytes is negative to release
+        void add(Category category, int64_t bytes);
+
+        int64_t liveBytes(Category category) const { return m_live.at(static_cast<size_t>(category)).load(std::memory_order_relaxed); }
+        int64_t peakBytes(Category category) const { return m_peak.at(static_cast<size_t>(category)).load(std::memory_order_relaxed); }
+        int64_t liveBytes() const { return m_liveTotal.load(std::memory_order_relaxed); }
+        // Peak of the total, not the sum of category peaks
+        int64_t peakBytes() const { return m_peakTotal.load(std::memory_order_relaxed); }
+        // Restart the peaks from the live bytes
+        void resetPeak();
+
+        QJsonObject toJson() const;
+
+    private:
+        Account* m_parent;
+        std::array<std::atomic<int64_t>, CategoryCount> m_live {};
+        std::array<std::atomic<int64_t>, CategoryCount> m_peak {};
+        std::atomic<int64_t> m_liveTotal = 0;
+        std::atomic<int64_t> m_peakTotal = 0;
+    };
+
+    // Holds bytes against an Account until resized or destroyed, does nothing if the account is null
+    class Allocation {
+    public:
+        Allocation() = default;
+        Allocation(Account* account, Category category, int64_t bytes)
+            : m_account(account)
+            , m_category(category)
+        {
+            resize(bytes);
+        }
+        Allocation(Allocation&& other) noexcept
+            : m_account(other.m_account)
+            , m_category(other.m_category)
+            , m_bytes(other.m_bytes)
+        {
+            other.m_bytes = 0;
+        }
+        Allocation& operator=(Allocation&& other) noexcept
+        {
+            if (this != &other) {
+                resize(0);
+                m_account = other.m_account;
+                m_category = other.m_category;
+                m_bytes = other.m_bytes;
+                other.m_bytes = 0;
+            }
+            return *this;
+        }
+        Allocation(const Allocation&) = delete;
+        Allocation& operator=(const Allocation&) = delete;
+        ~Allocation() { resize(0); }
+
+        void resize(int64_t bytes)
+        {
+            if (m_account && bytes != m_bytes)
+                m_account->add(m_category, bytes - m_bytes);
+            m_bytes = bytes;
+        }
+        int64_t bytes() const { return m_bytes; }
+
+    private:
+        Account* m_account = nullptr;
+        Category m_category = Category::VideoFrames;
+        int64_t m_bytes = 0;
+    };
+
+    static Account& session();
+    // Account for a clip source, shared by clips with the same source.
+    // Accounts are never freed so peaks of finished clips are still reported.
+    static Account* clipAccount(const QString& source);
+    // New Account for one clip, a child of the clipAccount() for its source.
+    // Shared with buffers that may outlive the clip, e.g. codec frames still referenced after it is destroyed.
+    static std::shared_ptr<Account> createClipAccount(const QString& source);
+    // Restart session and clip peaks from the live bytes, e.g. between render server jobs
+    static void resetPeaks();
+
+    static const char* categoryName(Category category);
+    // Session and per clip source accounts
+    static QJsonObject toJson();
+};
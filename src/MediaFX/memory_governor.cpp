@@ -0,0 +1,111 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "memory_governor.h"
+#include "memory_accounting.h"
+#include <QChar>
+#include <QString>
+#include <QStringView>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::mutex s_evictorsMutex; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+std::map<int, MemoryGovernor::Evictor> s_evictors; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+int s_nextEvictorId = 0; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+std::mutex s_leadsMutex; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+std::vector<const MemoryGovernor::Lead*> s_leads; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+}
+
+bool MemoryGovernor::isOverLimit()
+{
+    const int64_t limit = MemoryGovernor::limit();
+    if (limit <= 0 || MemoryAccounting::session().liveBytes() <= limit)
+        return false;
+
+    // Evict in registration order until back under the limit
+    std::lock_guard lock(s_evictorsMutex);
+    for (const auto& [id, evictor] : s_evictors) {
+        const int64_t excess = MemoryAccounting::session().liveBytes() - limit;
+        if (excess <= 0)
+            return false;
+        evictor(excess);
+    }
+    return MemoryAccounting::session().liveBytes() > limit;
+}
+
+MemoryGovernor::Lead::Lead()
+{
+    std::lock_guard lock(s_leadsMutex);
+    s_leads.push_back(this);
+}
+
+MemoryGovernor::Lead::~Lead()
+{
+    std::lock_guard lock(s_leadsMutex);
+    std::erase(s_leads, this);
+}
+
+bool MemoryGovernor::Lead::shouldThrottle() const
+{
+    return isOverLimit() && get() >= furthestLead();
+}
+
+microseconds MemoryGovernor::furthestLead()
+{
+    std::lock_guard lock(s_leadsMutex);
+    microseconds furthest = 0us;
+    for (const Lead* lead : s_leads)
+        furthest = std::max(furthest, lead->get());
+    return furthest;
+}
+
+int MemoryGovernor::addEvictor(Evictor evictor)
+{
+    std::lock_guard lock(s_evictorsMutex);
+    const int id = s_nextEvictorId++;
+    s_evictors.emplace(id, std::move(evictor));
+    return id;
+}
+
+void MemoryGovernor::removeEvictor(int id)
+{
+    std::lock_guard lock(s_evictorsMutex);
+    s_evictors.erase(id);
+}
+
+int64_t MemoryGovernor::parseSize(const QString& size)
+{
+    QStringView number(size);
+    double multiplier = 1;
+    if (!number.isEmpty()) {
+        switch (number.back().toUpper().unicode()) {
+        case 'T':
+            multiplier *= 1024;
+            [[fallthrough]];
+        case 'G':
+            multiplier *= 1024;
+            [[fallthrough]];
+        case 'M':
+            multiplier *= 1024;
+            [[fallthrough]];
+        case 'K':
+            multiplier *= 1024;
+            number.chop(1);
+            break;
+        default:
+            break;
+        }
+    }
+    bool ok = false;
+    const double value = number.toDouble(&ok);
+    if (!ok || value < 0 || !std::isfinite(value))
+        return -1;
+    return static_cast<int64_t>(std::llround(value * multiplier));
+}
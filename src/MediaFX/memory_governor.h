@@ -0,0 +1,73 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdint.h>
+using namespace std::chrono;
+
+// Session wide cap on the bytes accounted by MemoryAccounting.
+// Allocations are never refused. When the session is over the limit, caches are asked to evict
+// and work buffered around rendering waits for rendering to catch up instead of buffering more.
+// DecodeQueues decoding ahead are ranked by how far ahead of the session render time they are,
+// and the furthest ahead waits first. Encoder frames queued behind rendering only wait once
+// no decoding is ahead any more, since that stalls rendering.
+// With pipelineDepth 0 nothing is buffered, so over the limit only caches can be evicted.
+// The limit cannot bound what MemoryAccounting does not count: buffers pooled inside libavcodec
+// and libavfilter, codec reference frames and other internal state, and GPU memory.
+class MemoryGovernor {
+public:
+    // How far ahead of the session render time the work of a DecodeQueue is, registered while it exists
+    class Lead {
+    public:
+        Lead();
+        Lead(Lead&&) = delete;
+        Lead(const Lead&) = delete;
+        Lead& operator=(Lead&&) = delete;
+        Lead& operator=(const Lead&) = delete;
+        ~Lead();
+
+        void set(const microseconds& lead) { m_lead.store(lead.count(), std::memory_order_relaxed); }
+        microseconds get() const { return microseconds(m_lead.load(std::memory_order_relaxed)); }
+
+        // True if the session is over the limit and no other Lead is further ahead
+        bool shouldThrottle() const;
+
+    private:
+        std::atomic<int64_t> m_lead = 0;
+    };
+
+    // Called with the number of bytes to release, returns the bytes actually released.
+    // Evictors are called from any thread that checks the limit, so must be thread safe.
+    using Evictor = std::function<int64_t(int64_t bytes)>;
+
+    // 0 for no limit
+    static void setLimit(int64_t bytes) { s_limit.store(bytes, std::memory_order_relaxed); }
+    static int64_t limit() { return s_limit.load(std::memory_order_relaxed); }
+
+    // Evicts caches if the session is over the limit, returns true if it is still over
+    static bool isOverLimit();
+
+    // Work waits when isOverLimit(), counted for reporting
+    static void recordThrottle() { s_throttleCount.fetch_add(1, std::memory_order_relaxed); }
+    static int64_t throttleCount() { return s_throttleCount.load(std::memory_order_relaxed); }
+
+    // The largest registered Lead, 0 if there are none
+    static microseconds furthestLead();
+
+    // Returns an id for removeEvictor()
+    static int addEvictor(Evictor evictor);
+    static void removeEvictor(int id);
+
+    // Parses a byte count with an optional K, M, G or T (1024 based) suffix, e.g. 8G or 1.5G.
+    // Returns -1 if invalid.
+    static int64_t parseSize(const QString& size);
+
+private:
+    static inline std::atomic<int64_t> s_limit = 0;
+    static inline std::atomic<int64_t> s_throttleCount = 0;
+};
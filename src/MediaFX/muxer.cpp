@@ -0,0 +1,212 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * mux raw audio (float) and video (RGBA) streams into NUT format
+ * We bypass encoding and just stuff our raw data into AVPacket.data for
+ * the muxer since it is already in the correct format.
+ * http://git.ffmpeg.org/gitweb/nut.git
+ * https://ffmpeg.org/nut.html
+ */
+
+#include "muxer.h"
+#include "formats.h"
+#include "avio_output.h"
+#include "output_stream.h"
+#include "pipe_output.h"
+#include "profiler.h"
+#include "uring_output.h"
+#include "util.h"
+#include <QAudioBuffer>
+#include <QByteArray>
+#include <QDebug>
+#include <QSize>
+#include <QString>
+#include <QtLogging>
+#include <optional>
+#include <stdint.h>
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavcodec/codec_id.h>
+#include <libavcodec/packet.h>
+#include <libavcodec/version.h>
+#include <libavformat/avformat.h>
+#include <libavformat/avio.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/common.h>
+#include <libavutil/dict.h>
+#include <libavutil/mathematics.h>
+#include <libavutil/rational.h>
+#include <libavutil/version.h>
+}
+using namespace Qt::Literals::StringLiterals;
+
+// NOLINTBEGIN(bugprone-assignment-in-if-condition)
+
+std::optional<Muxer::FileIO> Muxer::parseFileIO(const QString& name)
+{
+    if (name == u"avio"_s)
+        return FileIO::AVIO;
+    if (name == u"uring"_s)
+        return FileIO::Uring;
+    if (name == u"uring-direct"_s)
+        return FileIO::UringDirect;
+    return std::nullopt;
+}
+
+Muxer::~Muxer()
+{
+    m_audioStream.reset();
+    m_videoStream.reset();
+    if (m_formatContext) {
+        if (m_customOutput)
+            m_formatContext->pb = nullptr;
+        else if (!(m_formatContext->flags & AVFMT_NOFILE))
+            avio_closep(&m_formatContext->pb);
+        avformat_free_context(m_formatContext);
+    }
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+bool Muxer::open(const QString& outputFileName, const QSize& frameSize, AVPixelFormat pixelFormat, const AVRational& frameRate, int sampleRate)
+{
+    int ret = 0;
+    m_outputFileName = outputFileName;
+
+    // Select nut format
+    if ((ret = avformat_alloc_output_context2(&m_formatContext, nullptr, "nut", qUtf8Printable(outputFileName))) < 0) {
+        qCritical() << "Could not allocate an output context, error:" << av_err2qstring(ret);
+        return false;
+    }
+
+    // Video stream, AV_CODEC_ID_RAWVIDEO
+    std::unique_ptr<OutputStream> video(new OutputStream(m_formatContext, AV_CODEC_ID_RAWVIDEO));
+    if (!video->isValid())
+        return false;
+    AVCodecContext* videoCodecContext = video->codecContext();
+    videoCodecContext->pix_fmt = pixelFormat;
+    videoCodecContext->width = frameSize.width();
+    videoCodecContext->height = frameSize.height();
+    AVRational timeBase(av_inv_q(frameRate));
+    int64_t gcd = av_gcd(FFABS(timeBase.num), FFABS(timeBase.den));
+    if (gcd) {
+        timeBase.num = FFABS(timeBase.num) / gcd;
+        timeBase.den = FFABS(timeBase.den) / gcd;
+    }
+    video->stream()->time_base = videoCodecContext->time_base = timeBase;
+    if (!video->open())
+        return false;
+
+    // Audio stream, AV_CODEC_ID_PCM_F32(BE|LE)/AV_SAMPLE_FMT_FLT
+    std::unique_ptr<OutputStream> audio(new OutputStream(m_formatContext, AudioCodec_FFMPEG));
+    if (!audio->isValid())
+        return false;
+    AVCodecContext* audioCodecContext = audio->codecContext();
+    audioCodecContext->sample_fmt = AudioSampleFormat_FFMPEG;
+    audioCodecContext->sample_rate = sampleRate;
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(59, 37, 100)
+    audioCodecContext->channel_layout = AudioChannelLayout_FFMPEG;
+    audioCodecContext->channels = av_get_channel_layout_nb_channels(audioCodecContext->channel_layout);
+#else
+    if ((ret = av_channel_layout_copy(&audioCodecContext->ch_layout, &AudioChannelLayout_FFMPEG)) < 0) {
+        qCritical() << "Could not copy channel layout, error:" << av_err2qstring(ret);
+        return false;
+    }
+#endif
+    audio->stream()->time_base = audioCodecContext->time_base = (AVRational) { 1, audioCodecContext->sample_rate };
+    if (!audio->open())
+        return false;
+
+    m_audioStream.swap(audio);
+    m_videoStream.swap(video);
+
+    if (!(m_formatContext->flags & AVFMT_NOFILE)) {
+        // Use zero-copy output when writing to a pipe
+        if (!(m_customOutput = PipeOutput::create(outputFileName)) && m_fileIO != FileIO::AVIO)
+            m_customOutput = UringOutput::create(outputFileName, m_fileIO == FileIO::UringDirect);
+        if (m_customOutput) {
+            m_formatContext->pb = m_customOutput->context();
+        } else if ((ret = avio_open(&m_formatContext->pb, qUtf8Printable(outputFileName), AVIO_FLAG_WRITE)) < 0) {
+            qCritical() << "Could not open output file" << outputFileName << ", avio_open:" << av_err2qstring(ret);
+            return false;
+        }
+    }
+    AVDictionary* opt = nullptr;
+    if ((ret = av_dict_set(&opt, "fflags", "bitexact", 0)) < 0) {
+        qCritical() << "Could not set options, av_dict_set:" << av_err2qstring(ret);
+        return false;
+    }
+    ret = avformat_write_header(m_formatContext, &opt);
+    av_dict_free(&opt);
+    if (ret < 0) {
+        qCritical() << "Could not write header, avformat_write_header:" << av_err2qstring(ret);
+        return false;
+    }
+
+    m_isOpen = true;
+    return true;
+}
+
+bool Muxer::write(const QAudioBuffer& audioBuffer, const QByteArray& videoData)
+{
+    if (!m_isOpen)
+        return false;
+
+    if (m_customOutput)
+        m_customOutput->retain(videoData);
+    AVPacket* videoPacket = m_videoStream->packet();
+    videoPacket->flags |= AV_PKT_FLAG_KEY;
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast, cppcoreguidelines-pro-type-reinterpret-cast)
+    videoPacket->data = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(videoData.constData()));
+    videoPacket->size = static_cast<int>(videoData.size());
+    if (!m_videoStream->writePacket(m_formatContext, 1))
+        return false;
+
+    AVPacket* audioPacket = m_audioStream->packet();
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    audioPacket->data = const_cast<uint8_t*>(audioBuffer.constData<uint8_t>());
+    audioPacket->size = static_cast<int>(audioBuffer.byteCount());
+    if (!m_audioStream->writePacket(m_formatContext, audioBuffer.frameCount()))
+        return false;
+
+    countBytesWritten();
+    return true;
+}
+
+void Muxer::countBytesWritten()
+{
+    if (!Profiler::isEnabled() || !m_formatContext->pb)
+        return;
+    int64_t position = avio_tell(m_formatContext->pb);
+    Profiler::addToCounter(Profiler::Counter::BytesWritten, position - m_bytesWritten);
+    m_bytesWritten = position;
+}
+
+bool Muxer::finish()
+{
+    if (!m_isOpen)
+        return false;
+    m_isOpen = false;
+
+    int ret = 0;
+    if ((ret = av_write_trailer(m_formatContext)) < 0) {
+        qCritical() << "Could not write trailer, av_write_trailer:" << av_err2qstring(ret);
+        return false;
+    }
+    countBytesWritten();
+    if (m_customOutput) {
+        bool finished = m_customOutput->finish();
+        m_formatContext->pb = nullptr;
+        if (!finished) {
+            qCritical() << "Could not finish output" << m_outputFileName;
+            return false;
+        }
+    } else if (!(m_formatContext->flags & AVFMT_NOFILE)) {
+        if ((ret = avio_closep(&m_formatContext->pb)) < 0) {
+            qCritical() << "Could not close file, avio_closep:" << av_err2qstring(ret);
+            return false;
+        }
+    }
+    return true;
+}
+
+// NOLINTEND(bugprone-assignment-in-if-condition)
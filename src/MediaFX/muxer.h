@@ -0,0 +1,63 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "frame_sink.h"
+#include <QSize>
+#include <QString>
+#include <memory>
+#include <optional>
+#include <stdint.h>
+extern "C" {
+#include <libavutil/pixfmt.h>
+#include <libavutil/rational.h>
+}
+class AVIOOutput;
+class OutputStream;
+class QAudioBuffer;
+class QByteArray;
+struct AVFormatContext;
+
+// Writes raw audio and video frames into a single NUT file
+class Muxer : public FrameSink {
+public:
+    // How output to local files is written
+    enum class FileIO {
+        AVIO,
+        Uring,
+        UringDirect,
+    };
+    // Parses avio, uring or uring-direct
+    static std::optional<FileIO> parseFileIO(const QString& name);
+
+    explicit Muxer(FileIO fileIO = FileIO::AVIO)
+        : m_fileIO(fileIO)
+    {
+    }
+    Muxer(Muxer&&) = delete;
+    Muxer(const Muxer&) = delete;
+    Muxer& operator=(Muxer&&) = delete;
+    Muxer& operator=(const Muxer&) = delete;
+    ~Muxer() override;
+
+    bool open(const QString& outputFileName, const QSize& frameSize, AVPixelFormat pixelFormat, const AVRational& frameRate, int sampleRate);
+    bool write(const QAudioBuffer& audioBuffer, const QByteArray& videoData) override;
+    bool finish() override;
+
+    FileIO fileIO() const { return m_fileIO; }
+    bool isOpen() const { return m_isOpen; }
+    const QString& outputFileName() const { return m_outputFileName; }
+
+private:
+    void countBytesWritten();
+
+    FileIO m_fileIO;
+    bool m_isOpen = false;
+    QString m_outputFileName;
+    int64_t m_bytesWritten = 0;
+    AVFormatContext* m_formatContext = nullptr;
+    std::unique_ptr<OutputStream> m_videoStream;
+    std::unique_ptr<OutputStream> m_audioStream;
+    std::unique_ptr<AVIOOutput> m_customOutput;
+};
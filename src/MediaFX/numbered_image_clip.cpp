@@ -0,0 +1,206 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "numbered_image_clip.h"
+#include "image_decode_queue.h"
+#include "media_clip.h"
+#include "memory_accounting.h"
+#include "render_context.h"
+#include "render_session.h"
+#include "util.h"
+#include <QChar>
+#include <QDir>
+#include <QFileInfo>
+#include <QQmlInfo>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+#include <QThread>
+#include <QUrl>
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+extern "C" {
+#include <libavutil/avutil.h>
+#include <libavutil/mathematics.h>
+#include <libavutil/rational.h>
+}
+using namespace Qt::Literals::StringLiterals;
+
+/*!
+    \qmltype NumberedImageClip
+    //! \instantiates NumberedImageClip
+    \inqmlmodule MediaFX
+    \inherits MediaClip
+
+    \brief Plays a sequence of numbered image files, one image per frame at \l frameRate.
+
+    \l {MediaClip::source}{source} is the first image of the sequence, e.g. \c shot.1001.exr.
+    The frame number is the last run of digits in the file name, and the sequence continues
+    with each consecutively numbered file that exists, zero padded to the same width.
+    Any image format Qt has a plugin for can be read.
+
+    Images are decoded ahead of rendering in parallel on worker threads,
+    or on the render thread if \l {RenderSession::pipelineDepth}{pipelineDepth} is 0.
+    \l {MediaClip::endTime}{endTime} defaults to the end of the sequence.
+*/
+NumberedImageClip::NumberedImageClip(QObject* parent)
+    : MediaClip(nullptr, parent)
+{
+}
+
+/*!
+    \qmlproperty rational NumberedImageClip::frameRate
+
+    The number of images per second as a rational, e.g. \c {({ num: 24000, den: 1001 })}.
+    Defaults to 0, which plays the images at the \l RenderSession frame rate.
+    Images are repeated or skipped to play them at a different rate than the session.
+*/
+void NumberedImageClip::setFrameRate(const Rational& frameRate)
+{
+    if (m_frameRate != frameRate) {
+        if (isComponentComplete()) {
+            qmlWarning(this) << "NumberedImageClip frameRate cannot be changed once loaded";
+            return;
+        }
+        m_frameRate = frameRate;
+        emit frameRateChanged();
+    }
+}
+
+/*!
+    \qmlproperty size NumberedImageClip::sourceSize
+
+    If set, images are downscaled when decoded to fit within this size, preserving their aspect ratio.
+    \sa {ImageClip::sourceSize}
+*/
+void NumberedImageClip::setSourceSize(const QSize& sourceSize)
+{
+    if (m_sourceSize != sourceSize) {
+        if (isComponentComplete()) {
+            qmlWarning(this) << "NumberedImageClip sourceSize cannot be changed once loaded";
+            return;
+        }
+        m_sourceSize = sourceSize;
+        emit sourceSizeChanged();
+    }
+}
+
+/*!
+    \qmlproperty int NumberedImageClip::imageCount
+
+    The number of images found in the sequence.
+*/
+
+QStringList NumberedImageClip::sequenceFiles(const QString& firstFileName, QString& errorMessage)
+{
+    const QFileInfo firstFile(firstFileName);
+    if (!firstFile.isFile()) {
+        errorMessage = u"Image %1 not found"_s.arg(firstFileName);
+        return {};
+    }
+    const QString extension = firstFile.suffix().isEmpty() ? QString() : u"."_s + firstFile.suffix();
+    const QString baseName = firstFile.fileName().chopped(extension.size());
+    static const QRegularExpression numberPattern(u"(\\d+)(\\D*)$"_s);
+    const QRegularExpressionMatch match = numberPattern.match(baseName);
+    if (!match.hasMatch()) {
+        errorMessage = u"Image %1 is not numbered"_s.arg(firstFileName);
+        return {};
+    }
+    const QString prefix = firstFile.dir().filePath(baseName.left(match.capturedStart(1)));
+    const QString suffix = match.captured(2) + extension;
+    const int width = static_cast<int>(match.capturedLength(1));
+    qlonglong number = match.captured(1).toLongLong();
+
+    QStringList fileNames { firstFile.filePath() };
+    while (true) {
+        const QString fileName = prefix + u"%1"_s.arg(++number, width, 10, QChar(u'0')) + suffix;
+        if (!QFileInfo(fileName).isFile())
+            break;
+        fileNames.append(fileName);
+    }
+    return fileNames;
+}
+
+AVRational NumberedImageClip::imageFrameRate() const
+{
+    return m_frameRate.num > 0 && m_frameRate.den > 0 ? m_frameRate : renderSession()->frameRate();
+}
+
+qsizetype NumberedImageClip::imageIndexAt(const microseconds& time, const AVRational& imageFrameRate, qsizetype imageCount)
+{
+    // Frame times are truncated to microseconds, so allow for the image starting up to 1us after
+    const int64_t position = av_rescale_rnd(time.count() + 1, imageFrameRate.num, static_cast<int64_t>(imageFrameRate.den) * AV_TIME_BASE, AV_ROUND_DOWN);
+    return std::clamp(static_cast<qsizetype>(position), qsizetype(0), imageCount - 1);
+}
+
+void NumberedImageClip::componentComplete()
+{
+    QString errorMessage;
+    m_fileNames = sequenceFiles(source().toLocalFile(), errorMessage);
+    if (m_fileNames.isEmpty()) {
+        qmlWarning(this) << "NumberedImageClip" << errorMessage << "(source" << source() << ")";
+        if (renderSession())
+            renderSession()->fatalError();
+        return;
+    }
+    emit imageCountChanged();
+    if (endTime() < 0) {
+        const AVRational frameRate = imageFrameRate();
+        setEndTime(av_rescale_rnd(m_fileNames.size(), static_cast<int64_t>(frameRate.den) * 1000, frameRate.num, AV_ROUND_DOWN)); // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+    }
+    MediaClip::componentComplete();
+}
+
+bool NumberedImageClip::openMedia()
+{
+    // Decode only the images that will be played, in the order they are played
+    const auto frameDuration = frameRateToFrameDuration(renderSession()->frameRate());
+    QStringList fileNames;
+    m_imageIndexes.clear();
+    for (int64_t frame = 0;; ++frame) {
+        const microseconds time = startTimeAdjusted() + duration_cast<microseconds>(frame * frameDuration);
+        if (frame > 0 && time >= endTimeAdjusted())
+            break;
+        const qsizetype imageIndex = imageIndexAt(time);
+        if (m_imageIndexes.empty() || m_imageIndexes.back() != imageIndex) {
+            m_imageIndexes.push_back(imageIndex);
+            fileNames.append(m_fileNames.at(imageIndex));
+        }
+    }
+    m_position = -1;
+
+    // Each clip decodes as many images in parallel as the session pipelines frames,
+    // so sessions with many clips don't start a thread per core for each
+    const auto pipelineDepth = static_cast<size_t>(std::max(0, renderSession()->pipelineDepth()));
+    const size_t threadCount = std::min(pipelineDepth, static_cast<size_t>(std::max(1, QThread::idealThreadCount())));
+    m_decodeQueue = std::make_unique<ImageDecodeQueue>(fileNames, m_sourceSize,
+        memoryAccount().get(), threadCount, std::max(pipelineDepth, threadCount * 2));
+    return true;
+}
+
+bool NumberedImageClip::nextFrame(QVideoFrame& videoFrame, QAudioBuffer&)
+{
+    const qsizetype imageIndex = imageIndexAt(currentFrameInterval().start());
+    qsizetype position = std::max(m_position, qsizetype(0));
+    while (position + 1 < m_decodeQueue->size() && m_imageIndexes.at(static_cast<size_t>(position + 1)) <= imageIndex)
+        ++position;
+    if (position != m_position) {
+        QString errorMessage;
+        m_videoFrame = m_decodeQueue->frame(position, errorMessage);
+        if (!m_videoFrame.isValid()) {
+            qmlWarning(this) << "NumberedImageClip failed to decode" << errorMessage << "(source" << source() << ")";
+            return false;
+        }
+        m_position = position;
+    }
+    // Repeated images are the same frame, video sinks ignore it after the first
+    videoFrame = m_videoFrame;
+    return true;
+}
+
+void NumberedImageClip::closeMedia()
+{
+    m_videoFrame = QVideoFrame();
+    m_decodeQueue.reset();
+    m_imageIndexes.clear();
+}
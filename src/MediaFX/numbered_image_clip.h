@@ -0,0 +1,80 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "image_decode_queue.h"
+#include "media_clip.h"
+#include "render_context.h"
+#include <QAudioBuffer>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVideoFrame>
+#include <QtQmlIntegration>
+#include <chrono>
+#include <memory>
+#include <vector>
+using namespace std::chrono;
+
+// A sequence of numbered image files played like a MediaClip, one image per frame at frameRate.
+// Images are decoded ahead in parallel by an ImageDecodeQueue,
+// and an image shown for several output frames is rendered as the same frame so it is uploaded once.
+class NumberedImageClip : public MediaClip {
+    Q_OBJECT
+    Q_PROPERTY(Rational frameRate READ frameRate WRITE setFrameRate NOTIFY frameRateChanged FINAL)
+    Q_PROPERTY(QSize sourceSize READ sourceSize WRITE setSourceSize NOTIFY sourceSizeChanged FINAL)
+    Q_PROPERTY(int imageCount READ imageCount NOTIFY imageCountChanged FINAL)
+    QML_ELEMENT
+
+signals:
+    void frameRateChanged();
+    void sourceSizeChanged();
+    void imageCountChanged();
+
+public:
+    explicit NumberedImageClip(QObject* parent = nullptr);
+    NumberedImageClip(NumberedImageClip&&) = delete;
+    NumberedImageClip& operator=(NumberedImageClip&&) = delete;
+    ~NumberedImageClip() override = default;
+
+    const Rational& frameRate() const { return m_frameRate; }
+    void setFrameRate(const Rational& frameRate);
+
+    const QSize& sourceSize() const { return m_sourceSize; }
+    void setSourceSize(const QSize& sourceSize);
+
+    int imageCount() const { return static_cast<int>(m_fileNames.size()); }
+
+    bool hasAudio() const override { return false; }
+    bool hasVideo() const override { return m_decodeQueue != nullptr; }
+
+    // Files numbered consecutively from firstFileName, whose number is the last run of digits in its name
+    // ignoring the extension. Numbers are zero padded to the width of the first.
+    // Returns an empty list and sets errorMessage on failure.
+    static QStringList sequenceFiles(const QString& firstFileName, QString& errorMessage);
+    // Index of the image of imageCount images playing at imageFrameRate shown at time
+    static qsizetype imageIndexAt(const microseconds& time, const AVRational& imageFrameRate, qsizetype imageCount);
+
+protected:
+    void componentComplete() override;
+    bool openMedia() override;
+    bool nextFrame(QVideoFrame& videoFrame, QAudioBuffer& audioBuffer) override;
+    void closeMedia() override;
+
+private:
+    Q_DISABLE_COPY(NumberedImageClip);
+
+    AVRational imageFrameRate() const;
+    qsizetype imageIndexAt(const microseconds& time) const { return imageIndexAt(time, imageFrameRate(), m_fileNames.size()); }
+
+    Rational m_frameRate { { 0, 1 } };
+    QSize m_sourceSize;
+    QStringList m_fileNames;
+    // Image index of each image decoded, in the order they are played
+    std::vector<qsizetype> m_imageIndexes;
+    qsizetype m_position = -1;
+    QVideoFrame m_videoFrame;
+    std::unique_ptr<ImageDecodeQueue> m_decodeQueue;
+};
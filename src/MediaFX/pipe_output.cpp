@@ -0,0 +1,231 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "pipe_output.h"
+
+#ifdef MEDIAFX_ENABLE_PIPE_OUTPUT
+
+#include <QByteArray>
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QFile>
+#include <QIODevice>
+#include <QString>
+#include <QtLogging>
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+extern "C" {
+#include <libavformat/avio.h>
+}
+using namespace std::chrono;
+using namespace Qt::Literals::StringLiterals;
+
+namespace {
+
+constexpr int AVIOBufferSize = 64 * 1024;
+constexpr milliseconds FinishTimeout = 30s;
+constexpr milliseconds MaxFinishBackoff = 50ms;
+
+int maxPipeSize()
+{
+    QFile file(u"/proc/sys/fs/pipe-max-size"_s);
+    if (!file.open(QIODevice::ReadOnly))
+        return 0;
+    return file.readAll().trimmed().toInt();
+}
+
+}
+
+std::unique_ptr<PipeOutput> PipeOutput::create(const QString& outputFileName)
+{
+    if (qEnvironmentVariableIsSet("MEDIAFX_BUFFERED_PIPE"))
+        return nullptr;
+    if (!outputFileName.startsWith(u"pipe:"_s))
+        return nullptr;
+    int fd = STDOUT_FILENO;
+    if (outputFileName.size() > 5) {
+        bool ok = false;
+        fd = outputFileName.mid(5).toInt(&ok);
+        if (!ok)
+            return nullptr;
+    }
+    struct stat st = {};
+    if (fstat(fd, &st) == -1 || !S_ISFIFO(st.st_mode))
+        return nullptr;
+
+    std::unique_ptr<PipeOutput> output(new PipeOutput(fd));
+    if (!output->open())
+        return nullptr;
+    return output;
+}
+
+PipeOutput::PipeOutput(int fd)
+    : m_fd(fd)
+    , m_pageSize(sysconf(_SC_PAGESIZE))
+{
+}
+
+PipeOutput::~PipeOutput() = default;
+
+bool PipeOutput::open()
+{
+    // Unprivileged processes are limited to pipe-max-size
+    int requestedSize = DefaultPipeSize;
+    if (int maxSize = maxPipeSize(); maxSize > 0)
+        requestedSize = std::min(requestedSize, maxSize);
+    m_pipeSize = fcntl(m_fd, F_SETPIPE_SZ, requestedSize);
+    if (m_pipeSize == -1)
+        m_pipeSize = fcntl(m_fd, F_GETPIPE_SZ);
+
+    // Large writes bypass the AVIOContext buffer, so packet data arrives here unmodified
+    return allocateContext(AVIOBufferSize, true, &PipeOutput::writePacket);
+}
+
+void PipeOutput::retain(const QByteArray& data)
+{
+    m_pending = data;
+}
+
+int PipeOutput::writePacket(void* opaque, AVIOWriteBuffer buf, int bufSize)
+{
+    auto* self = static_cast<PipeOutput*>(opaque);
+    if (self->m_failed)
+        return AVERROR(EPIPE);
+
+    const auto* pendingBegin = reinterpret_cast<const uint8_t*>(self->m_pending.constData()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    const uint8_t* pendingEnd = pendingBegin + self->m_pending.size(); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    const uint8_t* end = buf + bufSize; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    if (self->m_pending.isEmpty() || buf < pendingBegin || end > pendingEnd) {
+        if (!self->writeAll(buf, bufSize))
+            return AVERROR(EIO);
+        return bufSize;
+    }
+
+    // Splice the page aligned interior of the retained buffer, write the unaligned head and tail
+    const auto pageMask = ~static_cast<uintptr_t>(self->m_pageSize - 1);
+    const auto* alignedBegin = reinterpret_cast<const uint8_t*>((reinterpret_cast<uintptr_t>(buf) + self->m_pageSize - 1) & pageMask); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast, performance-no-int-to-ptr)
+    const auto* alignedEnd = reinterpret_cast<const uint8_t*>(reinterpret_cast<uintptr_t>(end) & pageMask); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast, performance-no-int-to-ptr)
+    if (alignedEnd <= alignedBegin) {
+        if (!self->writeAll(buf, bufSize))
+            return AVERROR(EIO);
+        return bufSize;
+    }
+    if (!self->writeAll(buf, alignedBegin - buf)
+        || !self->spliceAll(alignedBegin, alignedEnd - alignedBegin)) {
+        return AVERROR(EIO);
+    }
+    self->m_retained.push_back({ self->m_pending, self->m_bytesWritten });
+    self->m_pending.clear();
+    if (!self->writeAll(alignedEnd, end - alignedEnd))
+        return AVERROR(EIO);
+
+    self->releaseConsumed();
+    return bufSize;
+}
+
+bool PipeOutput::writeAll(const uint8_t* buf, size_t size)
+{
+    while (size > 0) {
+        ssize_t written = ::write(m_fd, buf, size);
+        if (written == -1) {
+            if (errno == EINTR)
+                continue;
+            qCritical() << "Failed to write pipe" << strerror(errno);
+            m_failed = true;
+            return false;
+        }
+        buf += written; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        size -= written;
+        m_bytesWritten += written;
+    }
+    return true;
+}
+
+bool PipeOutput::spliceAll(const uint8_t* buf, size_t size)
+{
+    while (size > 0) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+        struct iovec iov = { .iov_base = const_cast<uint8_t*>(buf), .iov_len = size };
+        ssize_t spliced = vmsplice(m_fd, &iov, 1, 0);
+        if (spliced == -1) {
+            if (errno == EINTR)
+                continue;
+            // Not spliceable, fall back to copying
+            if (errno == EINVAL || errno == ENOSYS)
+                return writeAll(buf, size);
+            qCritical() << "Failed to splice pipe" << strerror(errno);
+            m_failed = true;
+            return false;
+        }
+        buf += spliced; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        size -= spliced;
+        m_bytesWritten += spliced;
+    }
+    return true;
+}
+
+bool PipeOutput::releaseConsumed()
+{
+    int unread = 0;
+    if (ioctl(m_fd, FIONREAD, &unread) == -1)
+        return false;
+    const uint64_t consumed = m_bytesWritten - unread;
+    while (!m_retained.empty() && m_retained.front().endOffset <= consumed)
+        m_retained.pop_front();
+    return true;
+}
+
+bool PipeOutput::finish()
+{
+    avio_flush(context());
+    m_pending.clear();
+    // The reader must consume spliced pages before their buffers can be freed and reused.
+    // A pipe does not signal when it has drained, so block while it is full until the reader makes room,
+    // otherwise back off while the reader consumes the rest. Give up if it stops reading.
+    QDeadlineTimer deadline(FinishTimeout);
+    milliseconds backoff = 1ms;
+    while (!m_failed && releaseConsumed() && !m_retained.empty()) {
+        if (deadline.hasExpired()) {
+            qCritical() << "Timed out waiting for the pipe reader to consume the output";
+            m_failed = true;
+            break;
+        }
+        // Returns once the pipe is not full, or with POLLERR if the reader goes away
+        struct pollfd pfd = { .fd = m_fd, .events = POLLOUT, .revents = 0 };
+        if (int ready = poll(&pfd, 1, static_cast<int>(deadline.remainingTime())); ready != 1)
+            continue;
+        if (pfd.revents & POLLERR)
+            break;
+        std::this_thread::sleep_for(std::min(backoff, duration_cast<milliseconds>(deadline.remainingTimeAsDuration())));
+        backoff = std::min(backoff * 2, MaxFinishBackoff);
+    }
+    m_retained.clear();
+    return !m_failed && context()->error == 0;
+}
+
+#else
+
+std::unique_ptr<PipeOutput> PipeOutput::create(const QString&)
+{
+    return nullptr;
+}
+
+PipeOutput::~PipeOutput() = default;
+
+void PipeOutput::retain(const QByteArray&) { }
+
+bool PipeOutput::finish()
+{
+    return false;
+}
+
+#endif
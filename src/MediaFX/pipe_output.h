@@ -0,0 +1,64 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "avio_output.h"
+#include <QByteArray>
+#include <QString>
+#include <deque>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__linux__)
+#define MEDIAFX_ENABLE_PIPE_OUTPUT
+#endif
+
+// AVIOContext writing to a pipe.
+// The pipe buffer is enlarged with F_SETPIPE_SZ, and frame buffers registered with retain()
+// are handed to the kernel with vmsplice instead of being copied.
+// Spliced pages are referenced by the pipe until the reader consumes them,
+// so retained buffers are kept alive until the pipe has drained past them.
+class PipeOutput : public AVIOOutput {
+public:
+    static constexpr int DefaultPipeSize = 16 * 1024 * 1024;
+
+    // Returns nullptr if outputFileName is not a pipe: URL or the fd is not a pipe
+    static std::unique_ptr<PipeOutput> create(const QString& outputFileName);
+
+    PipeOutput(PipeOutput&&) = delete;
+    PipeOutput(const PipeOutput&) = delete;
+    PipeOutput& operator=(PipeOutput&&) = delete;
+    PipeOutput& operator=(const PipeOutput&) = delete;
+    ~PipeOutput() override;
+
+    int pipeSize() const { return m_pipeSize; }
+
+    // The frame may be spliced
+    void retain(const QByteArray& data) override;
+    // Flush and wait for the reader to consume any spliced pages, failing if it stops reading for 30s
+    bool finish() override;
+
+private:
+    explicit PipeOutput(int fd);
+
+    bool open();
+    static int writePacket(void* opaque, AVIOWriteBuffer buf, int bufSize);
+    bool writeAll(const uint8_t* buf, size_t size);
+    bool spliceAll(const uint8_t* buf, size_t size);
+    bool releaseConsumed();
+
+    struct RetainedBuffer {
+        QByteArray data;
+        uint64_t endOffset; // total bytes written when the last spliced byte entered the pipe
+    };
+
+    int m_fd;
+    int m_pipeSize = 0;
+    size_t m_pageSize = 0;
+    QByteArray m_pending;
+    std::deque<RetainedBuffer> m_retained;
+    uint64_t m_bytesWritten = 0;
+    bool m_failed = false;
+};
@@ -0,0 +1,221 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "profiler.h"
+#include <QJsonObject>
+#include <QString>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <time.h>
+#include <utility>
+#include <vector>
+using namespace Qt::Literals::StringLiterals;
+
+namespace {
+
+// Each thread records into its own histograms, so recording never contends
+struct ThreadHistograms {
+    std::array<LatencyHistogram, Profiler::StageCount> stages;
+};
+
+std::mutex s_histogramsMutex; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+// Outlive their threads so they are still included in the results
+std::vector<std::unique_ptr<ThreadHistograms>> s_threadHistograms; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+std::map<QString, std::unique_ptr<LatencyHistogram>> s_clipHistograms; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+thread_local ThreadHistograms* t_histograms = nullptr; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+ThreadHistograms& threadHistograms()
+{
+    if (!t_histograms) {
+        auto histograms = std::make_unique<ThreadHistograms>();
+        t_histograms = histograms.get();
+        std::lock_guard lock(s_histogramsMutex);
+        s_threadHistograms.push_back(std::move(histograms));
+    }
+    return *t_histograms;
+}
+
+}
+
+void Profiler::record(Stage stage, nanoseconds wall, nanoseconds cpu)
+{
+    Counters& counters = s_counters.at(static_cast<size_t>(stage));
+    counters.count.fetch_add(1, std::memory_order_relaxed);
+    counters.wall.fetch_add(wall.count(), std::memory_order_relaxed);
+    counters.cpu.fetch_add(cpu.count(), std::memory_order_relaxed);
+    threadHistograms().stages.at(static_cast<size_t>(stage)).record(wall);
+}
+
+LatencyHistogram::Snapshot Profiler::stageHistogram(Stage stage)
+{
+    LatencyHistogram::Snapshot snapshot;
+    std::lock_guard lock(s_histogramsMutex);
+    for (const auto& histograms : s_threadHistograms)
+        snapshot.add(histograms->stages.at(static_cast<size_t>(stage)));
+    return snapshot;
+}
+
+LatencyHistogram* Profiler::clipHistogram(const QString& source)
+{
+    if (!isEnabled())
+        return nullptr;
+    std::lock_guard lock(s_histogramsMutex);
+    auto& histogram = s_clipHistograms[source];
+    if (!histogram)
+        histogram = std::make_unique<LatencyHistogram>();
+    return histogram.get();
+}
+
+std::map<QString, LatencyHistogram::Snapshot> Profiler::clipHistograms()
+{
+    std::map<QString, LatencyHistogram::Snapshot> snapshots;
+    std::lock_guard lock(s_histogramsMutex);
+    for (const auto& [source, histogram] : s_clipHistograms)
+        snapshots[source].add(*histogram);
+    return snapshots;
+}
+
+void Profiler::recordQueueDepth(Queue queue, size_t depth)
+{
+    auto& peak = s_peakQueueDepths.at(static_cast<size_t>(queue));
+    size_t current = peak.load(std::memory_order_relaxed);
+    while (depth > current && !peak.compare_exchange_weak(current, depth, std::memory_order_relaxed)) { }
+}
+
+size_t Profiler::peakQueueDepth(Queue queue)
+{
+    return s_peakQueueDepths.at(static_cast<size_t>(queue)).load(std::memory_order_relaxed);
+}
+
+Profiler::StageTotals Profiler::totals(Stage stage)
+{
+    const Counters& counters = s_counters.at(static_cast<size_t>(stage));
+    return StageTotals {
+        counters.count.load(std::memory_order_relaxed),
+        nanoseconds(counters.wall.load(std::memory_order_relaxed)),
+        nanoseconds(counters.cpu.load(std::memory_order_relaxed)),
+    };
+}
+
+void Profiler::reset()
+{
+    for (auto& counters : s_counters) {
+        counters.count = 0;
+        counters.wall = 0;
+        counters.cpu = 0;
+    }
+    for (auto& peak : s_peakQueueDepths)
+        peak = 0;
+    for (auto& value : s_counterValues)
+        value = 0;
+    std::lock_guard lock(s_histogramsMutex);
+    for (auto& histograms : s_threadHistograms) {
+        for (auto& histogram : histograms->stages)
+            histogram.reset();
+    }
+    // Decoders may still hold these
+    for (auto& [source, histogram] : s_clipHistograms)
+        histogram->reset();
+}
+
+const char* Profiler::stageName(Stage stage)
+{
+    switch (stage) {
+    case Stage::Demux:
+        return "demux";
+    case Stage::Decode:
+        return "decode";
+    case Stage::Filter:
+        return "filter";
+    case Stage::FrameCopy:
+        return "frameCopy";
+    case Stage::Polish:
+        return "polish";
+    case Stage::Sync:
+        return "sync";
+    case Stage::Render:
+        return "render";
+    case Stage::Readback:
+        return "readback";
+    case Stage::Mix:
+        return "mix";
+    case Stage::Mux:
+        return "mux";
+    }
+    return "";
+}
+
+const char* Profiler::queueName(Queue queue)
+{
+    switch (queue) {
+    case Queue::Decode:
+        return "decode";
+    case Queue::Encode:
+        return "encode";
+    case Queue::Rendition:
+        return "rendition";
+    }
+    return "";
+}
+
+nanoseconds Profiler::threadCpuTime()
+{
+    struct timespec ts = {};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return nanoseconds(0);
+    return seconds(ts.tv_sec) + nanoseconds(ts.tv_nsec);
+}
+
+QString Profiler::formatTable(uint64_t frameCount, nanoseconds elapsed)
+{
+    const double elapsedSeconds = duration<double>(elapsed).count();
+    QString table = u"%1 frames in %2s, %3 fps\n\n"_s
+                        .arg(frameCount)
+                        .arg(elapsedSeconds, 0, 'f', 3)
+                        .arg(elapsedSeconds > 0 ? static_cast<double>(frameCount) / elapsedSeconds : 0.0, 0, 'f', 1);
+    table += u"%1 %2 %3 %4 %5 %6\n"_s
+                 .arg(u"stage"_s, -10)
+                 .arg(u"count"_s, 8)
+                 .arg(u"wall ms"_s, 12)
+                 .arg(u"cpu ms"_s, 12)
+                 .arg(u"wall us/frame"_s, 14)
+                 .arg(u"% wall"_s, 7);
+    for (size_t i = 0; i < StageCount; i++) {
+        auto stage = static_cast<Stage>(i);
+        StageTotals stageTotals = totals(stage);
+        const double wallMs = duration<double, std::milli>(stageTotals.wall).count();
+        const double cpuMs = duration<double, std::milli>(stageTotals.cpu).count();
+        const double perFrameUs = frameCount ? duration<double, std::micro>(stageTotals.wall).count() / static_cast<double>(frameCount) : 0.0;
+        const double percent = elapsed.count() ? 100.0 * static_cast<double>(stageTotals.wall.count()) / static_cast<double>(elapsed.count()) : 0.0;
+        table += u"%1 %2 %3 %4 %5 %6\n"_s
+                     .arg(QString::fromLatin1(stageName(stage)), -10)
+                     .arg(stageTotals.count, 8)
+                     .arg(wallMs, 12, 'f', 2)
+                     .arg(cpuMs, 12, 'f', 2)
+                     .arg(perFrameUs, 14, 'f', 1)
+                     .arg(percent, 7, 'f', 1);
+    }
+    return table;
+}
+
+QJsonObject Profiler::toJson(uint64_t frameCount, nanoseconds elapsed)
+{
+    const double elapsedSeconds = duration<double>(elapsed).count();
+    QJsonObject stages;
+    for (size_t i = 0; i < StageCount; i++) {
+        auto stage = static_cast<Stage>(i);
+        StageTotals stageTotals = totals(stage);
+        stages.insert(QString::fromLatin1(stageName(stage)), QJsonObject {
+                                                                  { u"count"_s, static_cast<qint64>(stageTotals.count) },
+                                                                  { u"wallNs"_s, static_cast<qint64>(stageTotals.wall.count()) },
+                                                                  { u"cpuNs"_s, static_cast<qint64>(stageTotals.cpu.count()) },
+                                                              });
+    }
+    return QJsonObject {
+        { u"frames"_s, static_cast<qint64>(frameCount) },
+        { u"seconds"_s, elapsedSeconds },
+        { u"fps"_s, elapsedSeconds > 0 ? static_cast<double>(frameCount) / elapsedSeconds : 0.0 },
+        { u"stages"_s, stages },
+    };
+}
@@ -0,0 +1,124 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "latency_histogram.h"
+#include <QJsonObject>
+#include <QString>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <stddef.h>
+#include <stdint.h>
+using namespace std::chrono;
+
+// Accumulates wall and thread CPU time spent in each stage of the frame pipeline,
+// along with a latency histogram per stage for each thread.
+// Disabled by default, a disabled Profiler::Scope only tests a flag.
+class Profiler {
+public:
+    enum class Stage {
+        Demux,
+        Decode,
+        Filter,
+        FrameCopy,
+        Polish,
+        Sync,
+        Render,
+        Readback,
+        Mix,
+        Mux,
+    };
+    static constexpr size_t StageCount = static_cast<size_t>(Stage::Mux) + 1;
+
+    enum class Queue {
+        Decode,
+        Encode,
+        Rendition,
+    };
+    static constexpr size_t QueueCount = static_cast<size_t>(Queue::Rendition) + 1;
+
+    enum class Counter {
+        BytesRead,
+        BytesWritten,
+        // Frames whose unchanged scene was not rendered again
+        SkippedFrames,
+    };
+    static constexpr size_t CounterCount = static_cast<size_t>(Counter::SkippedFrames) + 1;
+
+    struct StageTotals {
+        uint64_t count = 0;
+        nanoseconds wall { 0 };
+        nanoseconds cpu { 0 };
+    };
+
+    // Times the enclosing scope
+    class Scope {
+    public:
+        explicit Scope(Stage stage)
+            : m_stage(stage)
+            , m_enabled(Profiler::isEnabled())
+        {
+            if (m_enabled) {
+                m_wallStart = steady_clock::now();
+                m_cpuStart = threadCpuTime();
+            }
+        }
+        Scope(Scope&&) = delete;
+        Scope(const Scope&) = delete;
+        Scope& operator=(Scope&&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        ~Scope()
+        {
+            if (m_enabled)
+                Profiler::record(m_stage, steady_clock::now() - m_wallStart, threadCpuTime() - m_cpuStart);
+        }
+
+    private:
+        Stage m_stage;
+        bool m_enabled;
+        steady_clock::time_point m_wallStart;
+        nanoseconds m_cpuStart { 0 };
+    };
+
+    static void setEnabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    static void record(Stage stage, nanoseconds wall, nanoseconds cpu);
+    static StageTotals totals(Stage stage);
+    // Merged from every thread that recorded the stage
+    static LatencyHistogram::Snapshot stageHistogram(Stage stage);
+    static void reset();
+
+    // Histogram of Decoder::decode() latency for a clip source, shared by clips with the same source.
+    // Returns nullptr when disabled.
+    static LatencyHistogram* clipHistogram(const QString& source);
+    static std::map<QString, LatencyHistogram::Snapshot> clipHistograms();
+
+    static void recordQueueDepth(Queue queue, size_t depth);
+    static size_t peakQueueDepth(Queue queue);
+    static void addToCounter(Counter counter, int64_t value) { s_counterValues.at(static_cast<size_t>(counter)).fetch_add(value, std::memory_order_relaxed); }
+    static int64_t counter(Counter counter) { return s_counterValues.at(static_cast<size_t>(counter)).load(std::memory_order_relaxed); }
+
+    static const char* stageName(Stage stage);
+    static const char* queueName(Queue queue);
+    static nanoseconds threadCpuTime();
+
+    // Summary of all stages for frameCount frames rendered in elapsed wall time
+    static QString formatTable(uint64_t frameCount, nanoseconds elapsed);
+    static QJsonObject toJson(uint64_t frameCount, nanoseconds elapsed);
+
+private:
+    struct Counters {
+        std::atomic<uint64_t> count = 0;
+        std::atomic<int64_t> wall = 0;
+        std::atomic<int64_t> cpu = 0;
+    };
+
+    static inline std::atomic<bool> s_enabled = false;
+    static inline std::array<Counters, StageCount> s_counters;
+    static inline std::array<std::atomic<size_t>, QueueCount> s_peakQueueDepths {};
+    static inline std::array<std::atomic<int64_t>, CounterCount> s_counterValues {};
+};
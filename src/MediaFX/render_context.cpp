@@ -34,4 +34,55 @@ void RenderContext::setFrameRate(const Rational& frameRate)
 
 void RenderContext::setSampleRate(int sampleRate)
 {
-}
\ No newline at end of file
+    m_sampleRate = sampleRate;
+}
+
+void RenderContext::setRenditions(const QList<Rendition>& renditions)
+{
+    m_renditions = renditions;
+}
+
+void RenderContext::setSegmentFrames(int segmentFrames)
+{
+    m_segmentFrames = segmentFrames;
+}
+
+void RenderContext::setManifestFileName(const QString& manifestFileName)
+{
+    m_manifestFileName = manifestFileName;
+}
+
+void RenderContext::setPipelineDepth(int pipelineDepth)
+{
+    m_pipelineDepth = pipelineDepth;
+}
+
+void RenderContext::setFileIO(const QString& fileIO)
+{
+    m_fileIO = fileIO;
+}
+
+void RenderContext::setFramesPerEvent(int framesPerEvent)
+{
+    m_framesPerEvent = framesPerEvent;
+}
+
+void RenderContext::setReportFileName(const QString& reportFileName)
+{
+    m_reportFileName = reportFileName;
+}
+
+void RenderContext::setShaderCacheDirectory(const QString& shaderCacheDirectory)
+{
+    m_shaderCacheDirectory = shaderCacheDirectory;
+}
+
+void RenderContext::setShaderWarmup(bool shaderWarmup)
+{
+    m_shaderWarmup = shaderWarmup;
+}
+
+void RenderContext::setInitialProperties(const QVariantMap& initialProperties)
+{
+    m_initialProperties = initialProperties;
+}
@@ -3,10 +3,13 @@
 
 #pragma once
 
+#include "rendition.h"
+#include <QList>
 #include <QObject>
 #include <QSize>
 #include <QString>
 #include <QUrl>
+#include <QVariantMap>
 #include <QtQmlIntegration>
 extern "C" {
 #include <libavutil/rational.h>
@@ -14,6 +17,10 @@ extern "C" {
 
 struct Rational : public AVRational {
     Q_GADGET
+    QML_VALUE_TYPE(rational)
+    QML_STRUCTURED_VALUE
+    Q_PROPERTY(int num MEMBER num FINAL)
+    Q_PROPERTY(int den MEMBER den FINAL)
 public:
     friend constexpr bool operator==(const Rational& lhs, const Rational& rhs) noexcept
     {
@@ -35,6 +42,16 @@ class RenderContext : public QObject {
     Q_PROPERTY(int sampleRate READ sampleRate CONSTANT)
     Q_PROPERTY(QSize frameSize READ frameSize CONSTANT)
     Q_PROPERTY(Rational frameRate READ frameRate CONSTANT)
+    Q_PROPERTY(QList<Rendition> renditions READ renditions CONSTANT)
+    Q_PROPERTY(int segmentFrames READ segmentFrames CONSTANT)
+    Q_PROPERTY(QString manifestFileName READ manifestFileName CONSTANT)
+    Q_PROPERTY(int pipelineDepth READ pipelineDepth CONSTANT)
+    Q_PROPERTY(QString fileIO READ fileIO CONSTANT)
+    Q_PROPERTY(int framesPerEvent READ framesPerEvent CONSTANT)
+    Q_PROPERTY(QString reportFileName READ reportFileName CONSTANT)
+    Q_PROPERTY(QString shaderCacheDirectory READ shaderCacheDirectory CONSTANT)
+    Q_PROPERTY(bool shaderWarmup READ shaderWarmup CONSTANT)
+    Q_PROPERTY(QVariantMap initialProperties READ initialProperties CONSTANT)
     QML_ELEMENT
     QML_SINGLETON
 public:
@@ -54,6 +71,26 @@ public:
     void setFrameRate(const Rational& frameRate);
     constexpr int sampleRate() const noexcept { return m_sampleRate; }
     void setSampleRate(int sampleRate);
+    const QList<Rendition>& renditions() const noexcept { return m_renditions; }
+    void setRenditions(const QList<Rendition>& renditions);
+    constexpr int segmentFrames() const noexcept { return m_segmentFrames; }
+    void setSegmentFrames(int segmentFrames);
+    constexpr const QString& manifestFileName() const { return m_manifestFileName; }
+    void setManifestFileName(const QString& manifestFileName);
+    constexpr int pipelineDepth() const noexcept { return m_pipelineDepth; }
+    void setPipelineDepth(int pipelineDepth);
+    constexpr const QString& fileIO() const { return m_fileIO; }
+    void setFileIO(const QString& fileIO);
+    constexpr int framesPerEvent() const noexcept { return m_framesPerEvent; }
+    void setFramesPerEvent(int framesPerEvent);
+    constexpr const QString& reportFileName() const { return m_reportFileName; }
+    void setReportFileName(const QString& reportFileName);
+    constexpr const QString& shaderCacheDirectory() const { return m_shaderCacheDirectory; }
+    void setShaderCacheDirectory(const QString& shaderCacheDirectory);
+    constexpr bool shaderWarmup() const noexcept { return m_shaderWarmup; }
+    void setShaderWarmup(bool shaderWarmup);
+    const QVariantMap& initialProperties() const noexcept { return m_initialProperties; }
+    void setInitialProperties(const QVariantMap& initialProperties);
 
 private:
     Q_DISABLE_COPY(RenderContext);
@@ -62,4 +99,14 @@ private:
     int m_sampleRate;
     QUrl m_sourceUrl;
     QString m_outputFileName;
+    QList<Rendition> m_renditions;
+    int m_segmentFrames = 0;
+    QString m_manifestFileName;
+    int m_pipelineDepth = 0;
+    QString m_fileIO;
+    int m_framesPerEvent = 1;
+    QString m_reportFileName;
+    QString m_shaderCacheDirectory;
+    bool m_shaderWarmup = false;
+    QVariantMap m_initialProperties;
 };
@@ -2,15 +2,178 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "render_control.h"
+#include "memory_accounting.h"
+#include "profiler.h"
+#include "rendition.h"
+#include "tracer.h"
 #include <QByteArray>
 #include <QCoreApplication>
+#include <QCryptographicHash>
 #include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QIODevice>
+#include <QList>
 #include <QMessageLogContext>
+#include <QQuickGraphicsConfiguration>
 #include <QQuickRenderTarget>
 #include <QQuickWindow>
+#include <QSaveFile>
 #include <QSize>
+#include <QSemaphore>
+#include <QString>
+#include <QThread>
 #include <QtCore>
+#include <array>
 #include <rhi/qrhi.h>
+#include <rhi/qshader.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+using namespace Qt::Literals::StringLiterals;
+
+namespace {
+
+QShader loadShader(const QString& name)
+{
+    QFile file(name);
+    if (!file.open(QIODevice::ReadOnly))
+        return QShader();
+    return QShader::fromSerialized(file.readAll());
+}
+
+}
+
+RenderControl::RenderControl(QObject* parent)
+    : QQuickRenderControl(parent)
+{
+    // Emitted for item updates, polish requests, animation ticks and new video frames
+    connect(this, &QQuickRenderControl::sceneChanged, this, &RenderControl::markDirty);
+    connect(this, &QQuickRenderControl::renderRequested, this, &RenderControl::markDirty);
+}
+
+RenderControl::~RenderControl()
+{
+    if (renderThread) {
+        finishVideoFrame();
+        // Scene graph and RHI resources were created on the render thread and must be released there
+        QMetaObject::invokeMethod(
+            renderThreadContext.get(), [this]() {
+                savePipelineCache();
+                releaseResources();
+                invalidate();
+            },
+            Qt::BlockingQueuedConnection);
+        renderThread->quit();
+        renderThread->wait();
+    } else {
+        savePipelineCache();
+    }
+}
+
+void RenderControl::startRenderThread()
+{
+    renderThread = std::make_unique<QThread>();
+    renderThread->setObjectName(u"MediaFX render"_s);
+    renderThreadContext = std::make_unique<QObject>();
+    renderThreadContext->moveToThread(renderThread.get());
+    prepareThread(renderThread.get());
+    renderThread->start();
+}
+
+bool RenderControl::initializeRendering()
+{
+    if (!pipelineCacheDirectory.isEmpty() && window()) {
+        // Qt Quick only creates the QRhi with EnablePipelineCacheDataSave when given a save file,
+        // the cache itself is loaded and saved here once the driver is known
+        QQuickGraphicsConfiguration config = window()->graphicsConfiguration();
+        config.setAutomaticPipelineCache(false);
+        config.setPipelineCacheSaveFile(QDir(pipelineCacheDirectory).filePath(u"qtquick.pipelinecache"_s));
+        window()->setGraphicsConfiguration(config);
+    }
+    bool initialized = false;
+    auto initializeRhi = [this, &initialized]() {
+        initialized = initialize();
+        if (initialized)
+            loadPipelineCache();
+    };
+    if (renderThread)
+        QMetaObject::invokeMethod(renderThreadContext.get(), initializeRhi, Qt::BlockingQueuedConnection);
+    else
+        initializeRhi();
+    if (initialized && !pipelineCacheFileName.isEmpty() && window()) {
+        // Keep Qt Quick from writing its own copy when the scene graph is invalidated.
+        // The window is only configured here on its own thread, never from the render thread.
+        QQuickGraphicsConfiguration config = window()->graphicsConfiguration();
+        config.setPipelineCacheSaveFile(QString());
+        window()->setGraphicsConfiguration(config);
+    }
+    return initialized;
+}
+
+void RenderControl::setPipelineCacheDirectory(const QString& directory)
+{
+    pipelineCacheDirectory = directory;
+}
+
+void RenderControl::loadPipelineCache()
+{
+    QRhi* rhi = this->rhi();
+    if (pipelineCacheDirectory.isEmpty() || !rhi)
+        return;
+    // Pipelines built by one driver are useless to another, so each gets its own file
+    const QRhiDriverInfo driverInfo = rhi->driverInfo();
+    QCryptographicHash driverHash(QCryptographicHash::Sha1);
+    driverHash.addData(driverInfo.deviceName);
+    driverHash.addData(QByteArray::number(driverInfo.deviceId));
+    driverHash.addData(QByteArray::number(driverInfo.vendorId));
+    driverHash.addData(QT_VERSION_STR);
+    pipelineCacheFileName = QDir(pipelineCacheDirectory).filePath(u"%1-%2.pipelinecache"_s.arg(QString::fromLatin1(rhi->backendName()).toLower(), QString::fromLatin1(driverHash.result().toHex().left(16))));
+
+    QFile file(pipelineCacheFileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    loadedPipelineCache = file.readAll();
+    s_loadedPipelineCacheSize.store(loadedPipelineCache.size(), std::memory_order_relaxed);
+    // QRhi also validates the data and ignores it if the driver version changed
+    rhi->setPipelineCacheData(loadedPipelineCache);
+}
+
+void RenderControl::savePipelineCache()
+{
+    QRhi* rhi = this->rhi();
+    if (pipelineCacheFileName.isEmpty() || !rhi)
+        return;
+    const QByteArray data = rhi->pipelineCacheData();
+    if (data.isEmpty() || data == loadedPipelineCache)
+        return;
+    // Sessions sharing the directory each replace the file atomically
+    QSaveFile file(pipelineCacheFileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+        qWarning() << "Failed to save pipeline cache" << pipelineCacheFileName;
+}
+
+void RenderControl::releaseResources()
+{
+    renditionTargets.clear();
+    renditionSampler.reset();
+    renditionVertexBuffer.reset();
+    textureRenderTarget.reset();
+    renderPassDescriptor.reset();
+    stencilBuffer.reset();
+#ifdef MSAA
+    colorBuffer.reset();
+#endif
+    texture.reset();
+}
+
+void RenderControl::setRenditions(const QList<Rendition>& newRenditions)
+{
+    renditions = newRenditions;
+    // Force all render targets to be recreated
+    texture.reset();
+    markDirty();
+}
 
 bool RenderControl::reconfigure()
 {
@@ -40,7 +203,11 @@ bool RenderControl::reconfigure()
         return false;
     }
 
-    texture.reset(rhi->newTexture(QRhiTexture::RGBA8, size, 1, QRhiTexture::RenderTarget | QRhiTexture::UsedAsTransferSource));
+    QRhiTexture::Flags textureFlags = QRhiTexture::RenderTarget | QRhiTexture::UsedAsTransferSource;
+    // Renditions are downscaled from the mipmap chain
+    if (!renditions.isEmpty())
+        textureFlags |= QRhiTexture::MipMapped | QRhiTexture::UsedWithGenerateMips;
+    texture.reset(rhi->newTexture(QRhiTexture::RGBA8, size, 1, textureFlags));
     if (!texture->create()) {
         qCritical() << "Failed to create texture";
         return false;
@@ -84,30 +251,241 @@ bool RenderControl::reconfigure()
     // redirect Qt Quick rendering into our texture
     window()->setRenderTarget(renderTarget);
 
+    return reconfigureRenditions();
+}
+
+bool RenderControl::reconfigureRenditions()
+{
+    renditionTargets.clear();
+    renditionFrames.clear();
+    if (renditions.isEmpty())
+        return true;
+
+    QRhi* rhi = this->rhi();
+
+    QShader vertexShader = loadShader(u":/shaders/mediafx/rendition.vert.qsb"_s);
+    QShader fragmentShader = loadShader(u":/shaders/mediafx/rendition.frag.qsb"_s);
+    QShader swizzleFragmentShader = loadShader(u":/shaders/mediafx/rendition_bgra.frag.qsb"_s);
+    if (!vertexShader.isValid() || !fragmentShader.isValid() || !swizzleFragmentShader.isValid()) {
+        qCritical() << "Failed to load rendition shaders";
+        return false;
+    }
+
+    if (!renditionSampler) {
+        renditionSampler.reset(rhi->newSampler(QRhiSampler::Linear, QRhiSampler::Linear, QRhiSampler::Linear, QRhiSampler::ClampToEdge, QRhiSampler::ClampToEdge));
+        if (!renditionSampler->create()) {
+            qCritical() << "Failed to create rendition sampler";
+            return false;
+        }
+    }
+    if (!renditionVertexBuffer) {
+        renditionVertexBuffer.reset(rhi->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::VertexBuffer, sizeof(float) * 16));
+        if (!renditionVertexBuffer->create()) {
+            qCritical() << "Failed to create rendition vertex buffer";
+            return false;
+        }
+        renditionVertexBufferUploaded = false;
+    }
+
+    QRhiVertexInputLayout inputLayout;
+    inputLayout.setBindings({ { 4 * sizeof(float) } });
+    inputLayout.setAttributes({
+        { 0, 0, QRhiVertexInputAttribute::Float2, 0 },
+        { 0, 1, QRhiVertexInputAttribute::Float2, 2 * sizeof(float) },
+    });
+
+    renditionTargets.reserve(renditions.size());
+    for (const auto& rendition : std::as_const(renditions)) {
+        RenditionTarget target;
+        target.rendition = rendition;
+
+        target.texture.reset(rhi->newTexture(QRhiTexture::RGBA8, rendition.frameSize(), 1, QRhiTexture::RenderTarget | QRhiTexture::UsedAsTransferSource));
+        if (!target.texture->create()) {
+            qCritical() << "Failed to create rendition texture" << rendition;
+            return false;
+        }
+
+        target.renderTarget.reset(rhi->newTextureRenderTarget({ QRhiColorAttachment(target.texture.get()) }));
+        target.renderPassDescriptor.reset(target.renderTarget->newCompatibleRenderPassDescriptor());
+        target.renderTarget->setRenderPassDescriptor(target.renderPassDescriptor.get());
+        if (!target.renderTarget->create()) {
+            qCritical() << "Failed to create rendition render target" << rendition;
+            return false;
+        }
+
+        target.shaderResourceBindings.reset(rhi->newShaderResourceBindings());
+        target.shaderResourceBindings->setBindings({
+            QRhiShaderResourceBinding::sampledTexture(1, QRhiShaderResourceBinding::FragmentStage, texture.get(), renditionSampler.get()),
+        });
+        if (!target.shaderResourceBindings->create()) {
+            qCritical() << "Failed to create rendition shader resource bindings" << rendition;
+            return false;
+        }
+
+        target.pipeline.reset(rhi->newGraphicsPipeline());
+        target.pipeline->setTopology(QRhiGraphicsPipeline::TriangleStrip);
+        target.pipeline->setShaderStages({
+            { QRhiShaderStage::Vertex, vertexShader },
+            { QRhiShaderStage::Fragment, rendition.isSwizzled() ? swizzleFragmentShader : fragmentShader },
+        });
+        target.pipeline->setVertexInputLayout(inputLayout);
+        target.pipeline->setShaderResourceBindings(target.shaderResourceBindings.get());
+        target.pipeline->setRenderPassDescriptor(target.renderPassDescriptor.get());
+        if (!target.pipeline->create()) {
+            qCritical() << "Failed to create rendition pipeline" << rendition;
+            return false;
+        }
+
+        renditionTargets.push_back(std::move(target));
+    }
+
     return true;
 }
 
 QByteArray RenderControl::renderVideoFrame()
 {
-    if (!reconfigure())
+    Tracer::Span span("RenderControl::renderVideoFrame");
+    polishVideoFrame();
+    if (!syncVideoFrame())
         return QByteArray();
+    return finishVideoFrame();
+}
 
-    QCoreApplication::processEvents();
+void RenderControl::polishVideoFrame(bool processEvents)
+{
+    Tracer::Span span("RenderControl::polishVideoFrame");
+    if (processEvents)
+        QCoreApplication::processEvents();
+    else
+        QCoreApplication::sendPostedEvents();
+
+    // Nothing changed since the last frame, reuse it without touching the GPU
+    frameSkipped = !sceneDirty && hasFrame;
+    if (frameSkipped) {
+        Profiler::addToCounter(Profiler::Counter::SkippedFrames, 1);
+        return;
+    }
+    // Cleared before rendering so changes made while rendering dirty the next frame
+    sceneDirty = false;
+
+    Profiler::Scope scope(Profiler::Stage::Polish);
     polishItems();
+}
+
+bool RenderControl::syncVideoFrame()
+{
+    Tracer::Span span("RenderControl::syncVideoFrame");
+    Q_ASSERT(!frameInFlight);
+    if (frameSkipped)
+        return true;
+    hasFrame = true;
+
+    if (!renderThread) {
+        frameFailed = !syncScene();
+        if (!frameFailed)
+            renderScene();
+        return !frameFailed;
+    }
+
+    frameInFlight = true;
+    QMetaObject::invokeMethod(renderThreadContext.get(), [this, traceFrame = Tracer::currentFrame()]() {
+        Tracer::Context traceContext(traceFrame);
+        frameFailed = !syncScene();
+        syncDone.release();
+        if (!frameFailed)
+            renderScene();
+        frameDone.release();
+    });
+    // The GUI thread is only blocked while the scene graph is synced
+    syncDone.acquire();
+    return !frameFailed;
+}
+
+QByteArray RenderControl::finishVideoFrame()
+{
+    if (frameInFlight) {
+        Tracer::Span span("RenderControl::finishVideoFrame");
+        frameDone.acquire();
+        frameInFlight = false;
+    }
+    if (frameFailed)
+        return QByteArray();
+    return lastFrame;
+}
+
+bool RenderControl::syncScene()
+{
+    Tracer::Span span("RenderControl::syncScene");
+    Profiler::Scope scope(Profiler::Stage::Sync);
+    if (!reconfigure())
+        return false;
     beginFrame();
     sync();
-    render();
+    return true;
+}
+
+void RenderControl::renderScene()
+{
+    Tracer::Span span("RenderControl::renderScene");
+    {
+        Profiler::Scope scope(Profiler::Stage::Render);
+        render();
+    }
+    // Includes waiting for the GPU to finish the frame in endFrame()
+    Profiler::Scope scope(Profiler::Stage::Readback);
 
     QRhi* rhi = this->rhi();
+    QRhiCommandBuffer* commandBuffer = this->commandBuffer();
 
     QRhiReadbackResult readResult;
     QRhiResourceUpdateBatch* readbackBatch = rhi->nextResourceUpdateBatch();
     readbackBatch->readBackTexture(texture.get(), &readResult);
-    this->commandBuffer()->resourceUpdate(readbackBatch);
+    if (!renditionTargets.empty()) {
+        if (!renditionVertexBufferUploaded) {
+            // Full screen quad, x,y,u,v. Rendition rows must read back in the same top-down order as the source texture.
+            float y0 = (rhi->isYUpInFramebuffer() == rhi->isYUpInNDC()) ? -1.0f : 1.0f;
+            std::array<float, 16> vertices = {
+                -1.0f, y0, 0.0f, 0.0f,
+                1.0f, y0, 1.0f, 0.0f,
+                -1.0f, -y0, 0.0f, 1.0f,
+                1.0f, -y0, 1.0f, 1.0f,
+            };
+            readbackBatch->uploadStaticBuffer(renditionVertexBuffer.get(), vertices.data());
+            renditionVertexBufferUploaded = true;
+        }
+        readbackBatch->generateMips(texture.get());
+    }
+    commandBuffer->resourceUpdate(readbackBatch);
+
+    // Downscale each rendition from the rendered texture
+    std::vector<QRhiReadbackResult> renditionResults(renditionTargets.size());
+    for (size_t i = 0; i < renditionTargets.size(); i++) {
+        const auto& target = renditionTargets[i];
+        const QSize& size = target.rendition.frameSize();
+        commandBuffer->beginPass(target.renderTarget.get(), Qt::black, { 1.0f, 0 });
+        commandBuffer->setGraphicsPipeline(target.pipeline.get());
+        commandBuffer->setViewport({ 0, 0, float(size.width()), float(size.height()) });
+        commandBuffer->setShaderResources();
+        const QRhiCommandBuffer::VertexInput vertexInput(renditionVertexBuffer.get(), 0);
+        commandBuffer->setVertexInput(0, 1, &vertexInput);
+        commandBuffer->draw(4);
+        QRhiResourceUpdateBatch* renditionBatch = rhi->nextResourceUpdateBatch();
+        renditionBatch->readBackTexture(target.texture.get(), &renditionResults[i]);
+        commandBuffer->endPass(renditionBatch);
+    }
 
     // offscreen frames in QRhi are synchronous, meaning the readback has been finished after endFrame()
     endFrame();
 
+    renditionFrames.clear();
+    renditionFrames.reserve(static_cast<qsizetype>(renditionResults.size()));
+    int64_t readbackBytes = readResult.data.size();
+    for (const auto& result : renditionResults) {
+        renditionFrames.append(result.data);
+        readbackBytes += result.data.size();
+    }
+
     Q_ASSERT(readResult.format == QRhiTexture::RGBA8);
-    return readResult.data;
+    lastFrame = readResult.data;
+    readbackAllocation = MemoryAccounting::Allocation(&MemoryAccounting::session(), MemoryAccounting::Category::Readback, readbackBytes);
 }
\ No newline at end of file
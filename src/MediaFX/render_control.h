@@ -3,27 +3,78 @@
 
 #pragma once
 
+#include "memory_accounting.h"
+#include "rendition.h"
 #include <QByteArray>
+#include <QList>
 #include <QObject>
 #include <QQuickRenderControl>
+#include <QSemaphore>
+#include <QString>
+#include <atomic>
 #include <memory>
 #include <rhi/qrhi.h>
+#include <vector>
+class QThread;
 
 class RenderControl : public QQuickRenderControl {
     Q_OBJECT
 public:
-    RenderControl(QObject* parent = nullptr)
-        : QQuickRenderControl(parent) {};
+    RenderControl(QObject* parent = nullptr);
     RenderControl(RenderControl&&) = delete;
     RenderControl& operator=(RenderControl&&) = delete;
-    ~RenderControl() override = default;
+    ~RenderControl() override;
 
+    // Render on a dedicated thread, must be called before initializeRendering().
+    // Only syncing the scene graph blocks the calling thread.
+    void startRenderThread();
+    bool isThreaded() const { return renderThread != nullptr; }
+    // initialize() on the render thread if threaded
+    bool initializeRendering();
+
+    // Polish, sync and render a frame and wait for it
     QByteArray renderVideoFrame();
 
+    // The steps of renderVideoFrame().
+    // When threaded the previous frame may still be rendering during polishVideoFrame(),
+    // but must be finished before syncVideoFrame(). syncVideoFrame() returns once the scene is
+    // synced and the frame continues rendering on the render thread until finishVideoFrame().
+    // processEvents runs the event loop, otherwise only posted events are delivered
+    void polishVideoFrame(bool processEvents = true);
+    bool syncVideoFrame();
+    QByteArray finishVideoFrame();
+
+    // Downscaled frames from the last finished frame, one per rendition
+    const QList<QByteArray>& renditionVideoFrames() const { return renditionFrames; }
+
+    void setRenditions(const QList<Rendition>& newRenditions);
+
+    // Load the QRhi pipeline cache from a file in this directory once initialized and save it back when destroyed,
+    // the file is keyed by backend and driver. Must be called before initializeRendering().
+    void setPipelineCacheDirectory(const QString& directory);
+    // Size of the pipeline cache loaded by the process, 0 if it started without one
+    static qsizetype loadedPipelineCacheSize() { return s_loadedPipelineCacheSize.load(std::memory_order_relaxed); }
+
 private:
     Q_DISABLE_COPY(RenderControl);
 
+    struct RenditionTarget {
+        Rendition rendition;
+        std::unique_ptr<QRhiTexture> texture;
+        std::unique_ptr<QRhiTextureRenderTarget> renderTarget;
+        std::unique_ptr<QRhiRenderPassDescriptor> renderPassDescriptor;
+        std::unique_ptr<QRhiShaderResourceBindings> shaderResourceBindings;
+        std::unique_ptr<QRhiGraphicsPipeline> pipeline;
+    };
+
+    void loadPipelineCache();
+    void savePipelineCache();
     bool reconfigure();
+    bool reconfigureRenditions();
+    void markDirty() { sceneDirty = true; }
+    bool syncScene();
+    void renderScene();
+    void releaseResources();
 
     std::unique_ptr<QRhiTexture> texture;
     std::unique_ptr<QRhiRenderBuffer> stencilBuffer;
@@ -32,4 +83,32 @@ private:
 #endif
     std::unique_ptr<QRhiTextureRenderTarget> textureRenderTarget;
     std::unique_ptr<QRhiRenderPassDescriptor> renderPassDescriptor;
+
+    // Set when the scene needs to be synced or rendered, otherwise the last frame is reused
+    bool sceneDirty = true;
+    bool hasFrame = false;
+    bool frameSkipped = false;
+    bool frameFailed = false;
+    QByteArray lastFrame;
+    // lastFrame and renditionFrames
+    MemoryAccounting::Allocation readbackAllocation;
+
+    std::unique_ptr<QThread> renderThread;
+    // Lives on renderThread, used to invoke work there
+    std::unique_ptr<QObject> renderThreadContext;
+    QSemaphore syncDone;
+    QSemaphore frameDone;
+    bool frameInFlight = false;
+
+    QString pipelineCacheDirectory;
+    QString pipelineCacheFileName;
+    QByteArray loadedPipelineCache;
+    static inline std::atomic<qsizetype> s_loadedPipelineCacheSize = 0;
+
+    QList<Rendition> renditions;
+    std::vector<RenditionTarget> renditionTargets;
+    std::unique_ptr<QRhiSampler> renditionSampler;
+    std::unique_ptr<QRhiBuffer> renditionVertexBuffer;
+    bool renditionVertexBufferUploaded = false;
+    QList<QByteArray> renditionFrames;
 };
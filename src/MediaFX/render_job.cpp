@@ -0,0 +1,139 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "render_job.h"
+#include "render_context.h"
+#include "rendition.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QString>
+#include <QUrl>
+#include <QVariant>
+#include <algorithm>
+#include <cmath>
+extern "C" {
+#include <libavutil/parseutils.h>
+#include <libavutil/rational.h>
+}
+using namespace Qt::Literals::StringLiterals;
+
+namespace {
+
+// Numbers and strings are both accepted, e.g. "fps": 30 or "fps": "30000/1001"
+QString stringValue(const QJsonValue& value)
+{
+    return value.toVariant().toString();
+}
+
+}
+
+std::optional<RenderJob> RenderJob::fromJson(const QJsonObject& json, QString& errorMessage, const QDir& baseDirectory)
+{
+    RenderJob job;
+    const auto absolutePath = [&baseDirectory](const QString& path) { return baseDirectory.absoluteFilePath(path); };
+
+    const QString source = stringValue(json[u"source"_s]);
+    if (source.isEmpty()) {
+        errorMessage = u"source is required"_s;
+        return std::nullopt;
+    }
+    job.sourceUrl = QUrl::fromLocalFile(absolutePath(source));
+
+    const QString output = stringValue(json[u"output"_s]);
+    if (output.isEmpty() || output == u"-"_s) {
+        errorMessage = u"output is required and can not be stdout"_s;
+        return std::nullopt;
+    }
+    job.outputFileName = output.startsWith(u"shm:"_s) ? output : absolutePath(output);
+
+    if (json.contains(u"fps"_s)) {
+        if (av_parse_video_rate(&job.frameRate, qUtf8Printable(stringValue(json[u"fps"_s]))) < 0) {
+            errorMessage = u"invalid fps"_s;
+            return std::nullopt;
+        }
+    }
+    if (json.contains(u"size"_s)) {
+        int width = 0, height = 0;
+        if (av_parse_video_size(&width, &height, qUtf8Printable(stringValue(json[u"size"_s]))) < 0) {
+            errorMessage = u"invalid size"_s;
+            return std::nullopt;
+        }
+        job.frameSize = QSize(width, height);
+    }
+    if (json.contains(u"sampleRate"_s)) {
+        job.sampleRate = json[u"sampleRate"_s].toInt();
+        if (job.sampleRate <= 0) {
+            errorMessage = u"invalid sampleRate"_s;
+            return std::nullopt;
+        }
+    }
+    if (json.contains(u"framesPerEvent"_s)) {
+        job.framesPerEvent = json[u"framesPerEvent"_s].toInt();
+        if (job.framesPerEvent < 1) {
+            errorMessage = u"invalid framesPerEvent"_s;
+            return std::nullopt;
+        }
+    }
+
+    for (const auto& spec : json[u"rendition"_s].toArray()) {
+        auto rendition = Rendition::fromString(spec.toString());
+        if (!rendition || rendition->outputFileName() == u"pipe:"_s) {
+            errorMessage = u"invalid rendition %1"_s.arg(spec.toString());
+            return std::nullopt;
+        }
+        job.renditions.append(Rendition(rendition->frameSize(), rendition->pixelFormat(), absolutePath(rendition->outputFileName())));
+    }
+
+    if (json.contains(u"segmentFrames"_s)) {
+        job.segmentFrames = json[u"segmentFrames"_s].toInt();
+        if (job.segmentFrames <= 0) {
+            errorMessage = u"invalid segmentFrames"_s;
+            return std::nullopt;
+        }
+    } else if (json.contains(u"segmentDuration"_s)) {
+        const double segmentDuration = json[u"segmentDuration"_s].toDouble();
+        if (segmentDuration <= 0) {
+            errorMessage = u"invalid segmentDuration"_s;
+            return std::nullopt;
+        }
+        // Segments are cut on frame boundaries
+        job.segmentFrames = std::max(1, static_cast<int>(std::lround(segmentDuration * av_q2d(job.frameRate))));
+    }
+    if (job.segmentFrames > 0) {
+        if (json.contains(u"manifest"_s))
+            job.manifestFileName = absolutePath(stringValue(json[u"manifest"_s]));
+        else
+            job.manifestFileName = QFileInfo(job.outputFileName).dir().filePath(u"manifest.ffconcat"_s);
+    }
+
+    if (json.contains(u"report"_s))
+        job.reportFileName = absolutePath(stringValue(json[u"report"_s]));
+
+    if (json.contains(u"properties"_s)) {
+        if (!json[u"properties"_s].isObject()) {
+            errorMessage = u"properties must be an object"_s;
+            return std::nullopt;
+        }
+        job.initialProperties = json[u"properties"_s].toObject().toVariantMap();
+    }
+
+    return job;
+}
+
+void RenderJob::applyTo(RenderContext* renderContext) const
+{
+    renderContext->setSourceUrl(sourceUrl);
+    renderContext->setOutputFileName(outputFileName);
+    renderContext->setFrameSize(frameSize);
+    renderContext->setFrameRate(frameRate);
+    renderContext->setSampleRate(sampleRate);
+    renderContext->setRenditions(renditions);
+    renderContext->setSegmentFrames(segmentFrames);
+    renderContext->setManifestFileName(manifestFileName);
+    renderContext->setFramesPerEvent(framesPerEvent);
+    renderContext->setReportFileName(reportFileName);
+    renderContext->setInitialProperties(initialProperties);
+}
@@ -0,0 +1,40 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "render_context.h"
+#include "rendition.h"
+#include <QDir>
+#include <QList>
+#include <QSize>
+#include <QString>
+#include <QUrl>
+#include <QVariantMap>
+#include <optional>
+class QJsonObject;
+
+// Parameters of one encoding job run by the render server.
+// Requests use the encoder option names as JSON keys, with source and output for the positional arguments, e.g.
+// {"source": "demo.qml", "output": "demo.nut", "fps": "30000/1001", "size": "1280x720", "rendition": ["320x180:small.nut"]}
+// Relative paths are resolved against baseDirectory, the server working directory or the batch manifest directory.
+// An optional "properties" object sets initial properties of the root item loaded by RenderSession.
+struct RenderJob {
+    QUrl sourceUrl;
+    QString outputFileName;
+    // NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+    QSize frameSize { 640, 360 };
+    Rational frameRate = DefaultFrameRate;
+    int sampleRate = DefaultSampleRate;
+    QList<Rendition> renditions;
+    int segmentFrames = 0;
+    QString manifestFileName;
+    int framesPerEvent = 1;
+    QString reportFileName;
+    QVariantMap initialProperties;
+
+    // Returns nullopt and sets errorMessage if the request is invalid
+    static std::optional<RenderJob> fromJson(const QJsonObject& json, QString& errorMessage, const QDir& baseDirectory = QDir::current());
+
+    void applyTo(RenderContext* renderContext) const;
+};
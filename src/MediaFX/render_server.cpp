@@ -0,0 +1,193 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "render_server.h"
+#include "memory_accounting.h"
+#include "profiler.h"
+#include "render_context.h"
+#include "render_job.h"
+#include "render_window.h"
+#include <QByteArray>
+#include <QDebug>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QLocalSocket>
+#include <QMessageLogContext>
+#include <QQmlEngine>
+#include <QQmlError>
+#include <QQuickItem>
+#include <QSize>
+#include <QUrl>
+#include <QVariant>
+#include <QVariantMap>
+#include <Qt>
+#include <QtCore>
+using namespace Qt::Literals::StringLiterals;
+
+RenderServer::RenderServer(QQmlEngine* engine, QObject* parent)
+    : QObject(parent)
+    , m_engine(engine)
+{
+    connect(&m_server, &QLocalServer::newConnection, this, &RenderServer::onNewConnection);
+    // Sessions exit the engine when they end, which here only ends the job
+    connect(m_engine, &QQmlEngine::exit, this, &RenderServer::onEngineExit);
+}
+
+RenderServer::~RenderServer()
+{
+    delete m_jobItem; // NOLINT(cppcoreguidelines-owning-memory)
+    delete m_renderWindow; // NOLINT(cppcoreguidelines-owning-memory)
+}
+
+bool RenderServer::initialize()
+{
+    m_renderContext = m_engine->singletonInstance<RenderContext*>("MediaFX", "RenderContext");
+    if (!m_renderContext)
+        return false;
+
+    QQmlComponent windowComponent(m_engine, QUrl(u"qrc:/qt/qml/MediaFX/app-server.qml"_s));
+    QObject* object = windowComponent.create();
+    m_renderWindow = qobject_cast<RenderWindow*>(object);
+    if (!m_renderWindow) {
+        delete object; // NOLINT(cppcoreguidelines-owning-memory)
+        for (auto& error : windowComponent.errors())
+            qCritical() << error;
+        return false;
+    }
+    // Compiled once and created for each job
+    m_jobComponent = std::make_unique<QQmlComponent>(m_engine, QUrl(u"qrc:/qt/qml/MediaFX/app-server-job.qml"_s));
+    if (m_jobComponent->isError()) {
+        for (auto& error : m_jobComponent->errors())
+            qCritical() << error;
+        return false;
+    }
+    return true;
+}
+
+bool RenderServer::listen(const QString& socketPath)
+{
+    QLocalServer::removeServer(socketPath);
+    if (!m_server.listen(socketPath)) {
+        qCritical() << "Failed to listen on" << socketPath << m_server.errorString();
+        return false;
+    }
+    return true;
+}
+
+void RenderServer::onNewConnection()
+{
+    while (QLocalSocket* socket = m_server.nextPendingConnection()) {
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { readRequests(socket); });
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+void RenderServer::readRequests(QLocalSocket* socket)
+{
+    while (socket->canReadLine()) {
+        const QByteArray line = socket->readLine().trimmed();
+        if (line.isEmpty())
+            continue;
+        QJsonParseError parseError;
+        const QJsonDocument request = QJsonDocument::fromJson(line, &parseError);
+        if (!request.isObject()) {
+            respond(socket, { { u"status"_s, u"error"_s }, { u"error"_s, parseError.errorString() } });
+            continue;
+        }
+        const QJsonObject json = request.object();
+        QString errorMessage;
+        auto job = RenderJob::fromJson(json, errorMessage);
+        if (!job) {
+            respond(socket, { { u"id"_s, json[u"id"_s] }, { u"status"_s, u"error"_s }, { u"error"_s, errorMessage } });
+            continue;
+        }
+        m_pendingJobs.enqueue({ socket, json[u"id"_s], *job });
+    }
+    if (!m_jobItem)
+        startNextJob();
+}
+
+void RenderServer::addJob(const RenderJob& job, const QJsonValue& id)
+{
+    m_pendingJobs.enqueue({ nullptr, id, job });
+    if (!m_jobItem)
+        startNextJob();
+}
+
+void RenderServer::respond(QLocalSocket* socket, const QJsonObject& response)
+{
+    if (!socket || socket->state() != QLocalSocket::ConnectedState)
+        return;
+    socket->write(QJsonDocument(response).toJson(QJsonDocument::Compact) + '\n');
+    socket->flush();
+}
+
+void RenderServer::startNextJob()
+{
+    if (m_pendingJobs.isEmpty() || !m_renderWindow)
+        return;
+    m_currentJob = m_pendingJobs.dequeue();
+    const RenderJob& job = m_currentJob.job;
+    m_jobExitCode = -1;
+
+    // Statistics and peaks are reported per job
+    Profiler::setEnabled(false);
+    Profiler::reset();
+    MemoryAccounting::resetPeaks();
+
+    job.applyTo(m_renderContext);
+    m_renderWindow->setRenditions(job.renditions);
+    m_renderWindow->resize(job.frameSize);
+    // QQuickWindow does not resize contentItem
+    m_renderWindow->contentItem()->setSize(job.frameSize);
+
+    m_jobTimer.start();
+    QObject* object = m_jobComponent->beginCreate(m_engine->rootContext());
+    m_jobItem = qobject_cast<QQuickItem*>(object);
+    if (!m_jobItem) {
+        delete object; // NOLINT(cppcoreguidelines-owning-memory)
+        qCritical() << "Failed to create render job" << m_jobComponent->errorString();
+        m_jobExitCode = 1;
+        finishJob();
+        return;
+    }
+    m_jobComponent->setInitialProperties(m_jobItem, { { u"renderWindow"_s, QVariant::fromValue(m_renderWindow.data()) } });
+    m_jobItem->setParent(m_renderWindow);
+    m_jobItem->setParentItem(m_renderWindow->contentItem());
+    m_jobComponent->completeCreate();
+}
+
+void RenderServer::onEngineExit(int exitCode)
+{
+    // Only the first exit of a job counts, e.g. a fatal error is followed by the session ending
+    if (!m_jobItem || m_jobExitCode >= 0)
+        return;
+    m_jobExitCode = exitCode;
+    // Exit is emitted while rendering, the job is destroyed once back in the event loop
+    QMetaObject::invokeMethod(this, &RenderServer::finishJob, Qt::QueuedConnection);
+}
+
+void RenderServer::finishJob()
+{
+    if (m_renderWindow) {
+        m_renderWindow->setRenderSession(nullptr);
+        // The encoder is destroyed with the job
+        disconnect(m_renderWindow, &RenderWindow::frameReady, nullptr, nullptr);
+    }
+    delete m_jobItem; // NOLINT(cppcoreguidelines-owning-memory)
+
+    const QJsonObject response {
+        { u"id"_s, m_currentJob.id },
+        { u"status"_s, m_jobExitCode == 0 ? u"ok"_s : u"error"_s },
+        { u"exitCode"_s, m_jobExitCode },
+        { u"elapsedMs"_s, m_jobTimer.elapsed() },
+    };
+    respond(m_currentJob.socket, response);
+    m_currentJob = PendingJob();
+    emit jobFinished(response);
+    if (m_pendingJobs.isEmpty())
+        emit jobsFinished();
+    else
+        startNextJob();
+}
@@ -0,0 +1,80 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "render_job.h"
+#include <QElapsedTimer>
+#include <QJsonValue>
+#include <QLocalServer>
+#include <QObject>
+#include <QPointer>
+#include <QQmlComponent>
+#include <QQueue>
+#include <QString>
+#include <memory>
+class QJsonObject;
+class QLocalSocket;
+class QQmlEngine;
+class QQuickItem;
+class RenderContext;
+class RenderWindow;
+
+// Runs encoding jobs received on a local socket, or queued by encoder --batch, one after another in one process.
+// The QML engine, its compiled components and the RenderWindow (and so its QRhi and pipelines)
+// are created once and reused by every job, and decoded clips shared between jobs are reused from the FrameCache.
+// Each request is a line of JSON, see RenderJob, with an optional id that is echoed in the response.
+// Each job is answered with a line of JSON once it finishes, e.g. {"id": 1, "status": "ok", "exitCode": 0, "elapsedMs": 1234}
+class RenderServer : public QObject {
+    Q_OBJECT
+public:
+    explicit RenderServer(QQmlEngine* engine, QObject* parent = nullptr);
+    RenderServer(RenderServer&&) = delete;
+    RenderServer& operator=(RenderServer&&) = delete;
+    ~RenderServer() override;
+
+    // Creates the RenderWindow and compiles the job component
+    bool initialize();
+    // Listens on socketPath, replacing a stale socket file
+    bool listen(const QString& socketPath);
+
+    // Queues a job, started once the jobs queued before it finish
+    void addJob(const RenderJob& job, const QJsonValue& id = QJsonValue());
+
+signals:
+    // The response for each job, e.g. {"id": 1, "status": "ok", "exitCode": 0, "elapsedMs": 1234}
+    void jobFinished(const QJsonObject& response);
+    // No jobs remain queued
+    void jobsFinished();
+
+private slots:
+    void onNewConnection();
+    void onEngineExit(int exitCode);
+
+private:
+    Q_DISABLE_COPY(RenderServer);
+
+    struct PendingJob {
+        QPointer<QLocalSocket> socket;
+        QJsonValue id;
+        RenderJob job;
+    };
+
+    void readRequests(QLocalSocket* socket);
+    static void respond(QLocalSocket* socket, const QJsonObject& response);
+    void startNextJob();
+    void finishJob();
+
+    QQmlEngine* m_engine;
+    RenderContext* m_renderContext = nullptr;
+    QLocalServer m_server;
+    std::unique_ptr<QQmlComponent> m_jobComponent;
+    QPointer<RenderWindow> m_renderWindow;
+    QQueue<PendingJob> m_pendingJobs;
+    // The running job
+    PendingJob m_currentJob;
+    QPointer<QQuickItem> m_jobItem;
+    QElapsedTimer m_jobTimer;
+    // -1 until the running job exits
+    int m_jobExitCode = -1;
+};
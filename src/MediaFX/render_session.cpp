@@ -5,13 +5,20 @@
 #include "animation.h"
 #include "audio_renderer.h"
 #include "formats.h"
+#include "interval_tree.h"
+#include "media_clip.h"
+#include "memory_accounting.h"
+#include "profiler.h"
 #include "render_context.h"
+#include "session_report.h"
+#include "tracer.h"
 #include "util.h"
 #include <QAudioBuffer>
 #include <QAudioFormat>
 #include <QCoreApplication>
 #include <QDebug>
 #include <QEvent>
+#include <QJsonObject>
 #include <QList>
 #include <QObject>
 #include <QPointer>
@@ -23,6 +30,7 @@
 #include <QString>
 #include <QVariant>
 #include <QtLogging>
+#include <stdint.h>
 using namespace Qt::Literals::StringLiterals;
 
 /*!
@@ -96,6 +104,9 @@ void RenderSession::componentComplete()
 {
     QQuickItem::componentComplete();
 
+    // Stop batching frames once exiting, exit() is queued
+    connect(qmlEngine(this), &QQmlEngine::exit, this, [this]() { m_isExiting = true; });
+
     m_currentRenderTime = Interval(0us, frameRateToFrameDuration<microseconds>(frameRate()));
     m_animationDriver = std::make_unique<AnimationDriver>(frameRateToFrameDuration<microseconds>(frameRate()));
     m_animationDriver->install();
@@ -117,7 +128,7 @@ void RenderSession::componentComplete()
     QPointer<QQmlContext> context(new QQmlContext(creationContext, creationContext));
     // The RenderSession.session attached property uses this to find the session
     context->setContextProperty(SessionContextProperty, this);
-    QObject* object = component.create(context);
+    QObject* object = component.createWithInitialProperties(m_initialProperties, context);
     m_loadedItem = qobject_cast<QQuickItem*>(object);
     if (!m_loadedItem) {
         qmlWarning(this) << "Failed to load" << m_sourceUrl;
@@ -175,6 +186,99 @@ void RenderSession::setSampleRate(int sampleRate)
     }
 }
 
+/*!
+    \qmlproperty int RenderSession::pipelineDepth
+
+    Number of frames each MediaClip decodes ahead of rendering on a worker thread.
+    The default of \c 0 decodes each frame on the GUI thread when it is rendered.
+*/
+void RenderSession::setPipelineDepth(int pipelineDepth)
+{
+    if (m_pipelineDepth != pipelineDepth) {
+        if (m_pipelineDepth != 0) {
+            qmlWarning(this) << "RenderSession pipelineDepth is a write-once property";
+            return;
+        }
+        m_pipelineDepth = pipelineDepth;
+        emit pipelineDepthChanged();
+    }
+}
+
+/*!
+    \qmlproperty int RenderSession::framesPerEvent
+
+    Maximum number of frames rendered per event loop iteration, default \c 1.
+    Rendering several frames per iteration avoids event loop overhead for each frame,
+    which is significant for small frame sizes. Posted events are still delivered between frames,
+    and the batch ends early if rendering is paused.
+*/
+void RenderSession::setFramesPerEvent(int framesPerEvent)
+{
+    if (m_framesPerEvent != framesPerEvent) {
+        if (m_framesPerEvent != 1) {
+            qmlWarning(this) << "RenderSession framesPerEvent is a write-once property";
+            return;
+        }
+        if (framesPerEvent < 1) {
+            qmlWarning(this) << "RenderSession framesPerEvent must be at least 1";
+            return;
+        }
+        m_framesPerEvent = framesPerEvent;
+        emit framesPerEventChanged();
+    }
+}
+
+/*!
+    \qmlproperty string RenderSession::reportFileName
+
+    If set, a JSON performance report is written to this path after \l sessionEnded is emitted.
+    It covers frames rendered, wall time, per frame latency percentiles for decoding each clip,
+    rendering, readback, audio mixing and muxing, peak queue depths, bytes read and written and peak RSS.
+    Setting it enables collecting these statistics, so it should be set before any media is loaded.
+*/
+void RenderSession::setReportFileName(const QString& reportFileName)
+{
+    if (m_reportFileName != reportFileName) {
+        if (!m_reportFileName.isEmpty()) {
+            qmlWarning(this) << "RenderSession reportFileName is a write-once property";
+            return;
+        }
+        m_reportFileName = reportFileName;
+        Profiler::setEnabled(true);
+        emit reportFileNameChanged();
+    }
+}
+
+/*!
+    \qmlproperty object RenderSession::initialProperties
+
+    Initial property values of the root item loaded from \l sourceUrl,
+    e.g. to render the same source with different titles in a batch.
+*/
+void RenderSession::setInitialProperties(const QVariantMap& initialProperties)
+{
+    if (m_initialProperties != initialProperties) {
+        if (isComponentComplete()) {
+            qmlWarning(this) << "RenderSession initialProperties can not be changed once loaded";
+            return;
+        }
+        m_initialProperties = initialProperties;
+        emit initialPropertiesChanged();
+    }
+}
+
+/*!
+    \qmlmethod object RenderSession::memoryUsage
+
+    Live and peak bytes held by decoded video frames, audio buffers, packets,
+    codec frames, filtergraph frames and GPU readback buffers,
+    for the whole session (\c session) and for each clip source (\c clips).
+*/
+QJsonObject RenderSession::memoryUsage() const
+{
+    return MemoryAccounting::toJson();
+}
+
 /*!
     \qmlmethod void RenderSession::pauseRendering
 
@@ -205,13 +309,71 @@ void RenderSession::resumeRendering()
 
 void RenderSession::render()
 {
-    if (isRenderingPaused())
-        return;
+    Tracer::Span span("RenderSession::render");
+    for (int i = 0; i < m_framesPerEvent; i++) {
+        m_isBatchingFrames = i > 0;
+        if (!renderFrame()) {
+            m_isBatchingFrames = false;
+            return;
+        }
+    }
+    m_isBatchingFrames = false;
+
+    postRenderEvent();
+}
+
+void RenderSession::setMediaClipActive(MediaClip* clip, bool active)
+{
+    if (active)
+        m_activeMediaClips.emplace(clip->renderOrder(), clip);
+    else
+        m_activeMediaClips.erase(clip->renderOrder());
+}
+
+void RenderSession::scheduleMediaClip(MediaClip* clip, const Interval<microseconds>& interval)
+{
+    m_mediaClipSchedule.insert(interval, clip);
+}
+
+void RenderSession::unscheduleMediaClip(MediaClip* clip)
+{
+    m_mediaClipSchedule.removeIf([clip](const Interval<microseconds>&, const QPointer<MediaClip>& scheduledClip) {
+        return !scheduledClip || scheduledClip == clip;
+    });
+}
+
+void RenderSession::renderMediaClips()
+{
+    // Open decoders of clips scheduled to start soon, so they have frames ready
+    if (!m_mediaClipSchedule.isEmpty()) {
+        const microseconds now = m_currentRenderTime.start();
+        m_mediaClipSchedule.forEachOverlapping(Interval(now, now + DecoderLookahead), [now](const Interval<microseconds>& interval, const QPointer<MediaClip>& clip) {
+            if (clip)
+                clip->preload(interval.start() - now);
+        });
+    }
+
+    // Only active clips are rendered, in creation order.
+    // Clips can be activated or deactivated by rendering earlier clips, so look up the next one each time.
+    for (auto it = m_activeMediaClips.begin(); it != m_activeMediaClips.end();) {
+        const int64_t order = it->first;
+        it->second->render();
+        it = m_activeMediaClips.upper_bound(order);
+    }
+}
+
+// Returns true if another frame can be rendered without returning to the event loop
+bool RenderSession::renderFrame()
+{
+    if (isRenderingPaused() || m_isExiting)
+        return false;
+    Tracer::Context traceContext(m_frameCount - 1);
+    Tracer::Span span("RenderSession::renderFrame");
     if (!m_isResumingRender)
-        emit renderMediaClips();
+        renderMediaClips();
     if (isRenderingPaused()) {
         m_isResumingRender = true;
-        return;
+        return false;
     }
     m_isResumingRender = false;
 
@@ -223,18 +385,24 @@ void RenderSession::render()
 
     if (isSessionEnded()) {
         emit sessionEnded();
+        // Frames are all muxed once the above slots finish encoding
+        if (!m_reportFileName.isEmpty() && !SessionReport::write(m_reportFileName, m_frameCount - 1, nanoseconds(m_sessionTimer.nsecsElapsed()))) {
+            emit qmlEngine(this)->exit(1);
+            return false;
+        }
         // Exit 0, the above slot should have exited with an error if necessary
         emit qmlEngine(this)->exit(0);
-        return;
+        return false;
     }
 
     m_animationDriver->advance();
 
-    postRenderEvent();
+    return !m_isExiting;
 }
 
 void RenderSession::beginSession()
 {
+    m_sessionTimer.start();
     postRenderEvent();
 }
 
@@ -4,20 +4,28 @@
 #pragma once
 
 #include "interval.h"
+#include "interval_tree.h"
 #include "render_context.h"
 #include <QAudioBuffer>
 #include <QAudioFormat>
+#include <QElapsedTimer>
+#include <QJsonObject>
 #include <QObject>
 #include <QPointer>
 #include <QQuickItem>
 #include <QRectF>
+#include <QString>
 #include <QUrl>
+#include <QVariantMap>
 #include <QtCore>
 #include <QtQmlIntegration>
 #include <chrono>
+#include <map>
 #include <memory>
+#include <stdint.h>
 class AnimationDriver;
 class AudioRenderer;
+class MediaClip;
 class RenderSessionAttached;
 using namespace std::chrono;
 
@@ -27,6 +35,10 @@ class RenderSession : public QQuickItem {
     Q_PROPERTY(IntervalGadget currentRenderTime READ currentRenderTime NOTIFY currentRenderTimeChanged FINAL)
     Q_PROPERTY(Rational frameRate READ frameRate WRITE setFrameRate NOTIFY frameRateChanged FINAL)
     Q_PROPERTY(int sampleRate READ sampleRate WRITE setSampleRate NOTIFY sampleRateChanged FINAL)
+    Q_PROPERTY(int pipelineDepth READ pipelineDepth WRITE setPipelineDepth NOTIFY pipelineDepthChanged FINAL)
+    Q_PROPERTY(int framesPerEvent READ framesPerEvent WRITE setFramesPerEvent NOTIFY framesPerEventChanged FINAL)
+    Q_PROPERTY(QString reportFileName READ reportFileName WRITE setReportFileName NOTIFY reportFileNameChanged FINAL)
+    Q_PROPERTY(QVariantMap initialProperties READ initialProperties WRITE setInitialProperties NOTIFY initialPropertiesChanged FINAL)
     QML_ATTACHED(RenderSessionAttached)
     QML_ELEMENT
 
@@ -54,6 +66,20 @@ public:
     int sampleRate() const { return m_sampleRate; }
     void setSampleRate(int sampleRate);
 
+    int pipelineDepth() const { return m_pipelineDepth; }
+    void setPipelineDepth(int pipelineDepth);
+
+    int framesPerEvent() const { return m_framesPerEvent; }
+    void setFramesPerEvent(int framesPerEvent);
+    // True while rendering frames after the first in an event loop turn
+    bool isBatchingFrames() const { return m_isBatchingFrames; }
+
+    const QString& reportFileName() const { return m_reportFileName; }
+    void setReportFileName(const QString& reportFileName);
+
+    const QVariantMap& initialProperties() const { return m_initialProperties; }
+    void setInitialProperties(const QVariantMap& initialProperties);
+
     const QAudioFormat& outputAudioFormat() const { return m_outputAudioFormat; }
     const IntervalGadget currentRenderTime() const { return IntervalGadget(m_currentRenderTime); }
 
@@ -65,7 +91,15 @@ public:
 
     Q_INVOKABLE void pauseRendering();
     Q_INVOKABLE void resumeRendering();
+    Q_INVOKABLE QJsonObject memoryUsage() const;
     bool isRenderingPaused() const { return m_pauseRendering > 0; }
+
+    // Active MediaClips are rendered each frame in the order they were created
+    int64_t nextMediaClipOrder() { return m_nextMediaClipOrder++; }
+    void setMediaClipActive(MediaClip* clip, bool active);
+    // Clips scheduled to play over a session time interval have their decoders opened ahead of it
+    void scheduleMediaClip(MediaClip* clip, const Interval<microseconds>& interval);
+    void unscheduleMediaClip(MediaClip* clip);
     bool isSessionEnded() const { return m_sessionEnded; }
 
     static RenderSession* findSession(QObject* object);
@@ -74,9 +108,12 @@ signals:
     void sourceUrlChanged();
     void frameRateChanged();
     void sampleRateChanged();
+    void pipelineDepthChanged();
+    void framesPerEventChanged();
+    void reportFileNameChanged();
+    void initialPropertiesChanged();
     void currentRenderTimeChanged();
     void sessionEnded();
-    void renderMediaClips();
     void renderScene();
 
 public slots:
@@ -85,6 +122,8 @@ public slots:
     void fatalError() const;
 
 protected:
+    bool renderFrame();
+    void renderMediaClips();
     void postRenderEvent();
     void classBegin() override { }
     void componentComplete() override;
@@ -94,11 +133,20 @@ private:
     Q_DISABLE_COPY(RenderSession);
 
     static const QString SessionContextProperty;
+    // How far ahead of its scheduled interval a clips decoder is opened
+    static constexpr microseconds DecoderLookahead = 1s;
 
     QUrl m_sourceUrl;
     QPointer<QQuickItem> m_loadedItem;
     Rational m_frameRate = DefaultFrameRate;
     int m_sampleRate = DefaultSampleRate;
+    int m_pipelineDepth = 0;
+    int m_framesPerEvent = 1;
+    bool m_isBatchingFrames = false;
+    QString m_reportFileName;
+    QVariantMap m_initialProperties;
+    QElapsedTimer m_sessionTimer;
+    bool m_isExiting = false;
     QAudioFormat m_outputAudioFormat;
     Interval<microseconds> m_currentRenderTime;
     int m_frameCount = 1;
@@ -109,6 +157,9 @@ private:
     std::unique_ptr<AnimationDriver> m_animationDriver;
     bool m_isRenderEventPosted = false;
     bool m_isResumingRender = false;
+    int64_t m_nextMediaClipOrder = 0;
+    std::map<int64_t, MediaClip*> m_activeMediaClips;
+    IntervalTree<QPointer<MediaClip>> m_mediaClipSchedule;
 };
 
 class RenderSessionAttached : public QObject {
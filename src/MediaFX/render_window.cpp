@@ -2,15 +2,22 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 #include "render_window.h"
 #include "audio_renderer.h"
+#include "media_sequence.h"
+#include "profiler.h"
 #include "render_control.h"
 #include "render_session.h"
+#include "rendition.h"
+#include "tracer.h"
 #include <QAudioBuffer>
 #include <QByteArray>
 #include <QDebug>
+#include <QList>
 #include <QMessageLogContext>
 #include <QQmlEngine>
 #include <QQmlInfo>
 #include <QQuickItem>
+#include <QString>
+#include <QtCore>
 #ifdef MEDIAFX_ENABLE_VULKAN
 #include <QQuickGraphicsConfiguration>
 #include <QSGRendererInterface>
@@ -30,6 +37,14 @@ RenderWindow::RenderWindow(RenderControl* renderControl)
 
     \brief Renders QML content into an offscreen buffer.
 */
+
+/*!
+    \qmlproperty list<rendition> RenderWindow::renditions
+
+    Additional downscaled outputs. Each rendition is scaled on the GPU
+    from the rendered frame and delivered with the frameReady signal.
+    These can only be changed while there is no \l renderSession.
+*/
 RenderWindow::RenderWindow()
     : RenderWindow(new RenderControl())
 {
@@ -45,10 +60,6 @@ RenderWindow::RenderWindow()
         setVulkanInstance(&m_vulkanInstance);
     }
 #endif
-    if (!m_renderControl->initialize()) {
-        qCritical() << "Failed to initialize QQuickRenderControl";
-        return;
-    }
     m_isValid = true;
 }
 
@@ -60,34 +71,174 @@ void RenderWindow::componentComplete()
     // https://bugreports.qt.io/browse/QTBUG-55028
     contentItem()->setSize(size());
 
-    if (!m_renderSession) {
-        qmlWarning(this) << "RenderWindow renderSession is a required property";
-        emit qmlEngine(this)->exit(1);
+    if (!m_isValid)
+        return;
+    if (m_threadedRendering)
+        m_renderControl->startRenderThread();
+    m_renderControl->setPipelineCacheDirectory(m_pipelineCacheDirectory);
+    if (!m_renderControl->initializeRendering()) {
+        qCritical() << "Failed to initialize QQuickRenderControl";
+        m_isValid = false;
     }
 }
 
+/*!
+    \qmlproperty RenderSession RenderWindow::renderSession
+
+    The session rendered into this window. This can be \c null
+    and assigned later, e.g. the render server assigns a new session for each job.
+*/
 void RenderWindow::setRenderSession(RenderSession* renderSession)
 {
     if (renderSession != m_renderSession) {
+        // Drop a frame still rendering for the previous session
+        if (m_isFramePending) {
+            m_isFramePending = false;
+            m_renderControl->finishVideoFrame();
+        }
         m_renderSession = renderSession;
         emit renderSessionChanged();
     }
 }
 
+void RenderWindow::setRenditions(const QList<Rendition>& renditions)
+{
+    if (m_renditions != renditions) {
+        if (!m_renditions.isEmpty() && m_renderSession) {
+            qmlWarning(this) << "RenderWindow renditions cannot be changed during a session";
+            return;
+        }
+        m_renditions = renditions;
+        m_renderControl->setRenditions(m_renditions);
+        emit renditionsChanged();
+    }
+}
+
+/*!
+    \qmlproperty bool RenderWindow::threadedRendering
+
+    Sync and render the scene graph on a dedicated render thread.
+    The GUI thread is only blocked while the scene is synced, so animations and
+    bindings for the next frame are evaluated while the current frame renders.
+    Must be set when the RenderWindow is created.
+*/
+void RenderWindow::setThreadedRendering(bool threadedRendering)
+{
+    if (m_threadedRendering != threadedRendering) {
+        if (m_threadedRendering) {
+            qmlWarning(this) << "RenderWindow threadedRendering is a write-once property and cannot be changed";
+            return;
+        }
+        m_threadedRendering = threadedRendering;
+        emit threadedRenderingChanged();
+    }
+}
+
+/*!
+    \qmlproperty string RenderWindow::pipelineCacheDirectory
+
+    Directory to load the GPU pipeline cache from when rendering is initialized,
+    and save it back to when the window is destroyed.
+    Each graphics backend and driver has its own cache file, so the directory can be shared.
+    Must be set when the RenderWindow is created.
+*/
+void RenderWindow::setPipelineCacheDirectory(const QString& pipelineCacheDirectory)
+{
+    if (m_pipelineCacheDirectory != pipelineCacheDirectory) {
+        if (!m_pipelineCacheDirectory.isEmpty()) {
+            qmlWarning(this) << "RenderWindow pipelineCacheDirectory is a write-once property and cannot be changed";
+            return;
+        }
+        m_pipelineCacheDirectory = pipelineCacheDirectory;
+        emit pipelineCacheDirectoryChanged();
+    }
+}
+
+/*!
+    \qmlmethod void RenderWindow::warmUpPipelines
+
+    Render the pending transitions of every \l MediaSequence in the session once, and discard the frame.
+    This creates their shader pipelines (or loads them from the pipeline cache) before the session begins,
+    instead of stalling the frame where each transition starts.
+    Must be called before \l {RenderSession::beginSession}.
+*/
+void RenderWindow::warmUpPipelines()
+{
+    if (!m_isValid || !m_renderSession)
+        return;
+    QList<QQuickItem*> transitions;
+    const QList<MediaSequence*> sequences = m_renderSession->findChildren<MediaSequence*>();
+    for (const MediaSequence* sequence : sequences)
+        transitions.append(sequence->pendingTransitions());
+    if (transitions.isEmpty())
+        return;
+
+    Tracer::Span span("RenderWindow::warmUpPipelines");
+    // Pipelines depend on the render target, so render them into the same one as the session
+    for (QQuickItem* transition : std::as_const(transitions)) {
+        transition->setParentItem(contentItem());
+        transition->setSize(size());
+    }
+    if (m_renderControl->renderVideoFrame().isNull())
+        qWarning() << "Failed to render transitions for pipeline warmup";
+    for (QQuickItem* transition : std::as_const(transitions))
+        transition->setParentItem(nullptr);
+}
+
 void RenderWindow::render()
 {
-    if (!m_isValid) {
+    if (!m_isValid || !m_renderSession) {
         emit qmlEngine(this)->exit(1);
         return;
     }
-    QByteArray videoData = m_renderControl->renderVideoFrame();
-    if (videoData.isNull()) {
+    // When threaded, the previous frame is still rendering while this one is polished.
+    // Frames batched into one event loop iteration only deliver posted events.
+    m_renderControl->polishVideoFrame(!renderSession()->isBatchingFrames());
+    if (!emitPendingFrame())
+        return;
+    if (!m_renderControl->syncVideoFrame()) {
         emit qmlEngine(this)->exit(1);
         return;
     }
-    QAudioBuffer audioBuffer = renderSession()->rootAudioRenderer()->mix();
+    QAudioBuffer audioBuffer;
+    {
+        Profiler::Scope scope(Profiler::Stage::Mix);
+        audioBuffer = renderSession()->rootAudioRenderer()->mix();
+    }
     if (!audioBuffer.isValid())
         audioBuffer = renderSession()->silentOutputAudioBuffer();
+    m_pendingAudioBuffer = audioBuffer;
+    m_pendingTraceFrame = Tracer::currentFrame();
+    m_isFramePending = true;
+
+    // Otherwise it is emitted once rendered, when the next frame starts or rendering finishes
+    if (!m_renderControl->isThreaded())
+        emitPendingFrame();
+}
+
+/*!
+    \qmlmethod void RenderWindow::finishRendering
+
+    Wait for the last frame to render and emit it.
+    This must be called when the session ends, before encoding is finished.
+*/
+void RenderWindow::finishRendering()
+{
+    emitPendingFrame();
+}
 
-    emit frameReady(audioBuffer, videoData);
-}
\ No newline at end of file
+bool RenderWindow::emitPendingFrame()
+{
+    if (!m_isFramePending)
+        return true;
+    m_isFramePending = false;
+    // When threaded this is a frame behind the session
+    Tracer::Context traceContext(m_pendingTraceFrame);
+    QByteArray videoData = m_renderControl->finishVideoFrame();
+    if (videoData.isNull()) {
+        emit qmlEngine(this)->exit(1);
+        return false;
+    }
+    emit frameReady(m_pendingAudioBuffer, videoData, m_renderControl->renditionVideoFrames());
+    return true;
+}
@@ -4,27 +4,35 @@
 #pragma once
 
 #include "render_session.h"
+#include "rendition.h"
+#include <QAudioBuffer>
+#include <QByteArray>
+#include <QList>
 #include <QObject>
 #include <QPointer>
 #include <QQmlParserStatus>
 #include <QQuickWindow>
+#include <QString>
 #include <QtCore>
 #include <QtQmlIntegration>
 #include <memory>
 #include <qtgui-config.h>
+#include <stdint.h>
 #if (QT_CONFIG(vulkan) && __has_include(<vulkan/vulkan.h>))
 #define MEDIAFX_ENABLE_VULKAN
 #endif
 #ifdef MEDIAFX_ENABLE_VULKAN
 #include <QVulkanInstance>
 #endif
-class QAudioBuffer;
 class RenderControl;
 
 class RenderWindow : public QQuickWindow, public QQmlParserStatus {
     Q_OBJECT
     Q_INTERFACES(QQmlParserStatus)
     Q_PROPERTY(RenderSession* renderSession READ renderSession WRITE setRenderSession NOTIFY renderSessionChanged REQUIRED FINAL)
+    Q_PROPERTY(QList<Rendition> renditions READ renditions WRITE setRenditions NOTIFY renditionsChanged FINAL)
+    Q_PROPERTY(bool threadedRendering READ isThreadedRendering WRITE setThreadedRendering NOTIFY threadedRenderingChanged FINAL)
+    Q_PROPERTY(QString pipelineCacheDirectory READ pipelineCacheDirectory WRITE setPipelineCacheDirectory NOTIFY pipelineCacheDirectoryChanged FINAL)
     QML_ELEMENT
 
 public:
@@ -38,12 +46,27 @@ public:
     RenderSession* renderSession() const { return m_renderSession; }
     void setRenderSession(RenderSession* renderSession);
 
+    const QList<Rendition>& renditions() const { return m_renditions; }
+    void setRenditions(const QList<Rendition>& renditions);
+
+    bool isThreadedRendering() const { return m_threadedRendering; }
+    void setThreadedRendering(bool threadedRendering);
+
+    const QString& pipelineCacheDirectory() const { return m_pipelineCacheDirectory; }
+    void setPipelineCacheDirectory(const QString& pipelineCacheDirectory);
+
+    Q_INVOKABLE void warmUpPipelines();
+
 signals:
     void renderSessionChanged();
-    void frameReady(const QAudioBuffer& audioBuffer, const QByteArray& videoData);
+    void renditionsChanged();
+    void threadedRenderingChanged();
+    void pipelineCacheDirectoryChanged();
+    void frameReady(const QAudioBuffer& audioBuffer, const QByteArray& videoData, const QList<QByteArray>& renditionData);
 
 public slots:
     void render();
+    void finishRendering();
 
 protected:
     void classBegin() override { }
@@ -54,7 +77,15 @@ private:
 
     RenderWindow(RenderControl* renderControl);
 
+    bool emitPendingFrame();
+
     QPointer<RenderSession> m_renderSession;
+    QList<Rendition> m_renditions;
+    bool m_threadedRendering = false;
+    QString m_pipelineCacheDirectory;
+    bool m_isFramePending = false;
+    QAudioBuffer m_pendingAudioBuffer;
+    int64_t m_pendingTraceFrame = -1;
 #ifdef MEDIAFX_ENABLE_VULKAN
     QVulkanInstance m_vulkanInstance;
 #endif
@@ -0,0 +1,87 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "rendition.h"
+#include "formats.h"
+#include <QString>
+#include <QStringList>
+extern "C" {
+#include <libavutil/parseutils.h>
+#include <libavutil/pixdesc.h>
+#include <libavutil/pixfmt.h>
+}
+using namespace Qt::Literals::StringLiterals;
+
+/*!
+    \qmlvaluetype rendition
+    \ingroup qmlvaluetypes
+    \inqmlmodule MediaFX
+    \brief Specifies an additional output rendition.
+
+    A rendition is a downscaled copy of the rendered output written to its own file.
+    Renditions are scaled on the GPU from the single rendered frame,
+    so the scene is only rendered once regardless of the number of renditions.
+*/
+
+/*!
+    \qmlproperty size rendition::frameSize
+
+    The frame size of the rendition.
+*/
+
+/*!
+    \qmlproperty string rendition::pixelFormat
+
+    The pixel format of the rendition, \c rgba or \c bgra.
+*/
+
+/*!
+    \qmlproperty string rendition::outputFileName
+
+    The NUT file the rendition is written to.
+*/
+
+std::optional<Rendition> Rendition::fromString(const QString& spec)
+{
+    qsizetype sizeEnd = spec.indexOf(':');
+    if (sizeEnd <= 0)
+        return std::nullopt;
+    int width = 0, height = 0;
+    if (av_parse_video_size(&width, &height, qUtf8Printable(spec.left(sizeEnd))) < 0)
+        return std::nullopt;
+
+    QString pixelFormat(VideoPixelFormatName_FFMPEG);
+    QString outputFileName = spec.mid(sizeEnd + 1);
+    qsizetype formatEnd = outputFileName.indexOf(':');
+    if (formatEnd > 0) {
+        const QString format = outputFileName.left(formatEnd);
+        if (isPixelFormatSupported(format)) {
+            pixelFormat = format;
+            outputFileName = outputFileName.mid(formatEnd + 1);
+        } else if (av_get_pix_fmt(qUtf8Printable(format)) != AV_PIX_FMT_NONE) {
+            // An unsupported pixel format, not a path. Paths like this must start with ./
+            return std::nullopt;
+        }
+    }
+    if (outputFileName.isEmpty())
+        return std::nullopt;
+    if (outputFileName == u"-"_s)
+        outputFileName = u"pipe:"_s;
+
+    return Rendition(QSize(width, height), pixelFormat, outputFileName);
+}
+
+bool Rendition::isPixelFormatSupported(const QString& pixelFormat)
+{
+    return pixelFormat == u"rgba"_s || pixelFormat == u"bgra"_s;
+}
+
+AVPixelFormat Rendition::ffmpegPixelFormat() const
+{
+    return isSwizzled() ? AV_PIX_FMT_BGRA : VideoPixelFormat_FFMPEG;
+}
+
+bool Rendition::isSwizzled() const
+{
+    return m_pixelFormat == u"bgra"_s;
+}
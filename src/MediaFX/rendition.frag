@@ -0,0 +1,9 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+#version 440
+layout(location = 0) in vec2 v_texCoord;
+layout(location = 0) out vec4 fragColor;
+layout(binding = 1) uniform sampler2D source;
+void main() {
+    fragColor = texture(source, v_texCoord);
+}
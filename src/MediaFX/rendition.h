@@ -0,0 +1,70 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QDebug>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QtQmlIntegration>
+#include <optional>
+extern "C" {
+#include <libavutil/pixfmt.h>
+}
+
+class Rendition {
+    Q_GADGET
+    QML_VALUE_TYPE(rendition)
+    Q_PROPERTY(QSize frameSize READ frameSize FINAL)
+    Q_PROPERTY(QString pixelFormat READ pixelFormat FINAL)
+    Q_PROPERTY(QString outputFileName READ outputFileName FINAL)
+
+public:
+    Rendition() = default;
+    explicit Rendition(const QSize& frameSize, const QString& pixelFormat, const QString& outputFileName)
+        : m_frameSize(frameSize)
+        , m_pixelFormat(pixelFormat)
+        , m_outputFileName(outputFileName)
+    {
+    }
+    Rendition(Rendition&&) = default;
+    Rendition(const Rendition&) = default;
+    Rendition& operator=(Rendition&&) = default;
+    Rendition& operator=(const Rendition&) = default;
+    ~Rendition() = default;
+
+    // Parse WxH[:pixelformat]:file
+    static std::optional<Rendition> fromString(const QString& spec);
+    static bool isPixelFormatSupported(const QString& pixelFormat);
+
+    const QSize& frameSize() const { return m_frameSize; }
+    const QString& pixelFormat() const { return m_pixelFormat; }
+    const QString& outputFileName() const { return m_outputFileName; }
+
+    AVPixelFormat ffmpegPixelFormat() const;
+    // true if red and blue channels must be swapped when downscaling
+    bool isSwizzled() const;
+    int frameByteSize() const { return m_frameSize.width() * m_frameSize.height() * 4; }
+
+    friend bool operator==(const Rendition& lhs, const Rendition& rhs) noexcept
+    {
+        return lhs.m_frameSize == rhs.m_frameSize && lhs.m_pixelFormat == rhs.m_pixelFormat && lhs.m_outputFileName == rhs.m_outputFileName;
+    }
+    friend bool operator!=(const Rendition& lhs, const Rendition& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+    friend inline QDebug operator<<(QDebug dbg, const Rendition& rendition)
+    {
+        QDebugStateSaver saver(dbg);
+        dbg.nospace() << "(" << rendition.m_frameSize << ", " << rendition.m_pixelFormat << ", " << rendition.m_outputFileName << ")";
+        return dbg;
+    }
+
+private:
+    QSize m_frameSize;
+    QString m_pixelFormat;
+    QString m_outputFileName;
+};
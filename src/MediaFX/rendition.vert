@@ -0,0 +1,10 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+#version 440
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec2 texCoord;
+layout(location = 0) out vec2 v_texCoord;
+void main() {
+    v_texCoord = texCoord;
+    gl_Position = vec4(position, 0.0, 1.0);
+}
@@ -0,0 +1,67 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "rendition_writer.h"
+#include "profiler.h"
+#include <QDebug>
+#include <QtLogging>
+#include <optional>
+#include <utility>
+
+RenditionWriter::RenditionWriter(const Rendition& rendition)
+    : m_rendition(rendition)
+{
+}
+
+RenditionWriter::~RenditionWriter()
+{
+    m_queue.close();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+bool RenditionWriter::open(const AVRational& frameRate, int sampleRate)
+{
+    if (!m_muxer.open(m_rendition.outputFileName(), m_rendition.frameSize(), m_rendition.ffmpegPixelFormat(), frameRate, sampleRate))
+        return false;
+    m_thread = std::thread(&RenditionWriter::run, this);
+    return true;
+}
+
+bool RenditionWriter::write(const QAudioBuffer& audioBuffer, const QByteArray& videoData)
+{
+    if (m_failed)
+        return false;
+    if (videoData.size() != m_rendition.frameByteSize()) {
+        qCritical() << "Rendition video buffer has incorrect byte size" << m_rendition;
+        return false;
+    }
+    if (!m_queue.push(Frame { audioBuffer, videoData }))
+        return false;
+    if (Profiler::isEnabled())
+        Profiler::recordQueueDepth(Profiler::Queue::Rendition, m_queue.peakSize());
+    return true;
+}
+
+bool RenditionWriter::finish()
+{
+    m_queue.close();
+    if (m_thread.joinable())
+        m_thread.join();
+    if (m_failed)
+        return false;
+    return m_muxer.finish();
+}
+
+void RenditionWriter::run()
+{
+    while (std::optional<Frame> frame = m_queue.pop()) {
+        if (!m_muxer.write(frame->audioBuffer, frame->videoData)) {
+            qCritical() << "Failed to write rendition" << m_rendition;
+            m_failed = true;
+            // Unblock the producer, remaining frames are discarded
+            m_queue.close();
+            return;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "bounded_queue.h"
+#include "muxer.h"
+#include "rendition.h"
+#include <QAudioBuffer>
+#include <QByteArray>
+#include <atomic>
+#include <thread>
+extern "C" {
+#include <libavutil/rational.h>
+}
+
+// Muxes a Rendition on its own thread
+class RenditionWriter {
+public:
+    explicit RenditionWriter(const Rendition& rendition);
+    RenditionWriter(RenditionWriter&&) = delete;
+    RenditionWriter(const RenditionWriter&) = delete;
+    RenditionWriter& operator=(RenditionWriter&&) = delete;
+    RenditionWriter& operator=(const RenditionWriter&) = delete;
+    ~RenditionWriter();
+
+    bool open(const AVRational& frameRate, int sampleRate);
+    // Queue a frame for writing, blocks if the writer thread is behind
+    bool write(const QAudioBuffer& audioBuffer, const QByteArray& videoData);
+    // Flush queued frames and write the trailer
+    bool finish();
+
+    const Rendition& rendition() const { return m_rendition; }
+
+private:
+    struct Frame {
+        QAudioBuffer audioBuffer;
+        QByteArray videoData;
+    };
+
+    void run();
+
+    static constexpr size_t QueueCapacity = 4;
+
+    Rendition m_rendition;
+    Muxer m_muxer;
+    BoundedQueue<Frame> m_queue { QueueCapacity };
+    std::thread m_thread;
+    std::atomic<bool> m_failed = false;
+};
@@ -0,0 +1,132 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "segmented_muxer.h"
+#include <QAudioBuffer>
+#include <QByteArray>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QIODevice>
+#include <QSaveFile>
+#include <QString>
+#include <QtLogging>
+#include <array>
+#include <memory>
+#include <utility>
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/rational.h>
+}
+using namespace Qt::Literals::StringLiterals;
+
+SegmentedMuxer::SegmentedMuxer(const QString& outputPattern, const QString& manifestFileName, int segmentFrames, Muxer::FileIO fileIO)
+    : m_outputPattern(outputPattern)
+    , m_manifestFileName(manifestFileName)
+    , m_segmentFrames(segmentFrames)
+    , m_fileIO(fileIO)
+{
+}
+
+SegmentedMuxer::~SegmentedMuxer() = default;
+
+bool SegmentedMuxer::isValidPattern(const QString& outputPattern)
+{
+    std::array<char, 1024> buf; // NOLINT(cppcoreguidelines-pro-type-member-init)
+    return av_get_frame_filename2(buf.data(), buf.size(), qUtf8Printable(outputPattern), 0, 0) >= 0;
+}
+
+QString SegmentedMuxer::segmentFileName(int segment) const
+{
+    std::array<char, 1024> buf; // NOLINT(cppcoreguidelines-pro-type-member-init)
+    if (av_get_frame_filename2(buf.data(), buf.size(), qUtf8Printable(m_outputPattern), segment, 0) < 0)
+        return QString();
+    return QString::fromUtf8(buf.data());
+}
+
+bool SegmentedMuxer::open(const QSize& frameSize, AVPixelFormat pixelFormat, const AVRational& frameRate, int sampleRate)
+{
+    if (m_segmentFrames <= 0) {
+        qCritical() << "Invalid segment length" << m_segmentFrames;
+        return false;
+    }
+    if (!isValidPattern(m_outputPattern)) {
+        qCritical() << "Segment output must contain a frame number pattern, e.g. %05d:" << m_outputPattern;
+        return false;
+    }
+    m_frameSize = frameSize;
+    m_pixelFormat = pixelFormat;
+    m_frameRate = frameRate;
+    m_sampleRate = sampleRate;
+    // Start with an empty manifest so stale entries from a previous run are not consumed
+    if (!writeManifest(false))
+        return false;
+    return openSegment();
+}
+
+bool SegmentedMuxer::openSegment()
+{
+    QString fileName = segmentFileName(m_segmentCount);
+    auto muxer = std::make_unique<Muxer>(m_fileIO);
+    if (!muxer->open(fileName, m_frameSize, m_pixelFormat, m_frameRate, m_sampleRate))
+        return false;
+    m_muxer.swap(muxer);
+    m_segmentFrameCount = 0;
+    return true;
+}
+
+bool SegmentedMuxer::closeSegment()
+{
+    if (!m_muxer->finish())
+        return false;
+
+    // ffconcat paths are relative to the manifest
+    QString fileName = QFileInfo(m_manifestFileName).dir().relativeFilePath(QFileInfo(m_muxer->outputFileName()).absoluteFilePath());
+    fileName.replace(u"'"_s, u"'\\''"_s);
+    AVRational duration = av_mul_q(AVRational { m_segmentFrameCount, 1 }, av_inv_q(m_frameRate));
+    m_manifestEntries.append(u"file '%1'\nduration %2\n"_s.arg(fileName).arg(av_q2d(duration), 0, 'f', 6));
+    m_segmentCount++;
+    m_muxer.reset();
+    return true;
+}
+
+bool SegmentedMuxer::writeManifest(bool complete)
+{
+    // QSaveFile writes a temporary file and renames it over the manifest on commit
+    QSaveFile manifest(m_manifestFileName);
+    if (!manifest.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qCritical() << "Failed to open manifest" << m_manifestFileName << manifest.errorString();
+        return false;
+    }
+    manifest.write("ffconcat version 1.0\n");
+    for (const auto& entry : std::as_const(m_manifestEntries))
+        manifest.write(entry.toUtf8());
+    if (complete)
+        manifest.write("# complete\n");
+    if (!manifest.commit()) {
+        qCritical() << "Failed to write manifest" << m_manifestFileName << manifest.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool SegmentedMuxer::write(const QAudioBuffer& audioBuffer, const QByteArray& videoData)
+{
+    if (!m_muxer)
+        return false;
+    if (m_segmentFrameCount >= m_segmentFrames) {
+        if (!closeSegment() || !writeManifest(false) || !openSegment())
+            return false;
+    }
+    if (!m_muxer->write(audioBuffer, videoData))
+        return false;
+    m_segmentFrameCount++;
+    return true;
+}
+
+bool SegmentedMuxer::finish()
+{
+    if (!m_muxer)
+        return false;
+    return closeSegment() && writeManifest(true);
+}
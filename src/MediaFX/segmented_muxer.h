@@ -0,0 +1,58 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "frame_sink.h"
+#include "muxer.h"
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <memory>
+extern "C" {
+#include <libavutil/pixfmt.h>
+#include <libavutil/rational.h>
+}
+class QAudioBuffer;
+class QByteArray;
+
+// Writes a rolling sequence of NUT files, starting a new file every segmentFrames frames.
+// Completed segments are listed in an ffconcat manifest which is replaced atomically
+// each time a segment is closed, so segments can be consumed while rendering continues.
+class SegmentedMuxer : public FrameSink {
+public:
+    // outputPattern must contain a printf style frame number, e.g. segment-%05d.nut
+    explicit SegmentedMuxer(const QString& outputPattern, const QString& manifestFileName, int segmentFrames, Muxer::FileIO fileIO = Muxer::FileIO::AVIO);
+    SegmentedMuxer(SegmentedMuxer&&) = delete;
+    SegmentedMuxer(const SegmentedMuxer&) = delete;
+    SegmentedMuxer& operator=(SegmentedMuxer&&) = delete;
+    SegmentedMuxer& operator=(const SegmentedMuxer&) = delete;
+    ~SegmentedMuxer() override;
+
+    static bool isValidPattern(const QString& outputPattern);
+
+    bool open(const QSize& frameSize, AVPixelFormat pixelFormat, const AVRational& frameRate, int sampleRate);
+    bool write(const QAudioBuffer& audioBuffer, const QByteArray& videoData) override;
+    bool finish() override;
+
+    int segmentCount() const { return m_segmentCount; }
+
+private:
+    QString segmentFileName(int segment) const;
+    bool openSegment();
+    bool closeSegment();
+    bool writeManifest(bool complete);
+
+    QString m_outputPattern;
+    QString m_manifestFileName;
+    int m_segmentFrames;
+    Muxer::FileIO m_fileIO;
+    QSize m_frameSize;
+    AVPixelFormat m_pixelFormat = AV_PIX_FMT_NONE;
+    AVRational m_frameRate = { 0, 1 };
+    int m_sampleRate = 0;
+    std::unique_ptr<Muxer> m_muxer;
+    int m_segmentCount = 0;
+    int m_segmentFrameCount = 0;
+    QStringList m_manifestEntries;
+};
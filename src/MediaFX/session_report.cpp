@@ -0,0 +1,98 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "session_report.h"
+#include "latency_histogram.h"
+#include "memory_accounting.h"
+#include "memory_governor.h"
+#include "profiler.h"
+#include "render_control.h"
+#include <QByteArray>
+#include <QDebug>
+#include <QFile>
+#include <QIODevice>
+#include <QJsonDocument>
+#include <QtLogging>
+#include <array>
+#include <stddef.h>
+#include <sys/resource.h>
+using namespace Qt::Literals::StringLiterals;
+
+namespace {
+
+QJsonObject latencyObject(const LatencyHistogram::Snapshot& histogram)
+{
+    return QJsonObject {
+        { u"count"_s, static_cast<qint64>(histogram.count()) },
+        { u"p50Ns"_s, static_cast<qint64>(histogram.percentile(50).count()) },
+        { u"p95Ns"_s, static_cast<qint64>(histogram.percentile(95).count()) },
+        { u"p99Ns"_s, static_cast<qint64>(histogram.percentile(99).count()) },
+        { u"maxNs"_s, static_cast<qint64>(histogram.max().count()) },
+    };
+}
+
+}
+
+QJsonObject SessionReport::create(uint64_t frameCount, nanoseconds elapsed)
+{
+    const double elapsedSeconds = duration<double>(elapsed).count();
+
+    QJsonObject decodeLatency;
+    for (const auto& [source, histogram] : Profiler::clipHistograms())
+        decodeLatency.insert(source, latencyObject(histogram));
+    QJsonObject latency { { u"decode"_s, decodeLatency } };
+    constexpr std::array frameStages {
+        Profiler::Stage::Render,
+        Profiler::Stage::Readback,
+        Profiler::Stage::Mix,
+        Profiler::Stage::Mux,
+    };
+    for (auto stage : frameStages)
+        latency.insert(QString::fromLatin1(Profiler::stageName(stage)), latencyObject(Profiler::stageHistogram(stage)));
+
+    QJsonObject queueDepths;
+    for (size_t i = 0; i < Profiler::QueueCount; i++) {
+        auto queue = static_cast<Profiler::Queue>(i);
+        queueDepths.insert(QString::fromLatin1(Profiler::queueName(queue)), static_cast<qint64>(Profiler::peakQueueDepth(queue)));
+    }
+
+    return QJsonObject {
+        { u"frames"_s, static_cast<qint64>(frameCount) },
+        { u"seconds"_s, elapsedSeconds },
+        { u"fps"_s, elapsedSeconds > 0 ? static_cast<double>(frameCount) / elapsedSeconds : 0.0 },
+        { u"latency"_s, latency },
+        { u"peakQueueDepth"_s, queueDepths },
+        { u"skippedFrames"_s, static_cast<qint64>(Profiler::counter(Profiler::Counter::SkippedFrames)) },
+        { u"bytesRead"_s, static_cast<qint64>(Profiler::counter(Profiler::Counter::BytesRead)) },
+        { u"bytesWritten"_s, static_cast<qint64>(Profiler::counter(Profiler::Counter::BytesWritten)) },
+        { u"pipelineCacheLoadedBytes"_s, static_cast<qint64>(RenderControl::loadedPipelineCacheSize()) },
+        { u"peakRssBytes"_s, static_cast<qint64>(peakResidentSetSize()) },
+        { u"memory"_s, MemoryAccounting::toJson() },
+        { u"memoryLimitBytes"_s, static_cast<qint64>(MemoryGovernor::limit()) },
+        { u"memoryThrottles"_s, static_cast<qint64>(MemoryGovernor::throttleCount()) },
+    };
+}
+
+bool SessionReport::write(const QString& fileName, uint64_t frameCount, nanoseconds elapsed)
+{
+    QByteArray json = QJsonDocument(create(frameCount, elapsed)).toJson();
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size() || !file.flush()) {
+        qCritical() << "Could not write session report" << fileName << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+int64_t SessionReport::peakResidentSetSize()
+{
+    struct rusage usage = {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    // Linux reports kilobytes
+    return static_cast<int64_t>(usage.ru_maxrss) * 1024; // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+#endif
+}
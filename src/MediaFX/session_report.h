@@ -0,0 +1,21 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+#include <chrono>
+#include <stdint.h>
+using namespace std::chrono;
+
+// JSON summary of a render session built from the Profiler, written when the session ends.
+// Latencies are per frame percentiles in nanoseconds.
+class SessionReport {
+public:
+    static QJsonObject create(uint64_t frameCount, nanoseconds elapsed);
+    static bool write(const QString& fileName, uint64_t frameCount, nanoseconds elapsed);
+
+    // Peak resident set size of the process in bytes, or -1 if unknown
+    static int64_t peakResidentSetSize();
+};
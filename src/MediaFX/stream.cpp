@@ -2,13 +2,17 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "stream.h"
+#include "memory_accounting.h"
+#include "tracer.h"
 #include "util.h"
 #include <QString>
 #include <chrono>
 #include <compare>
 #include <errno.h>
+#include <memory>
 #include <ratio>
 #include <stddef.h>
+#include <stdint.h>
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavcodec/codec.h>
@@ -17,6 +21,7 @@ extern "C" {
 #include <libavfilter/buffersrc.h>
 #include <libavformat/avformat.h>
 #include <libavformat/version.h>
+#include <libavutil/buffer.h>
 #include <libavutil/error.h>
 #include <libavutil/frame.h>
 #include <libavutil/mem.h>
@@ -33,6 +38,66 @@ void FreeFrame::operator()(AVFrame* frame) const
     av_frame_free(&frame);
 }
 
+int64_t frameBufferBytes(const AVFrame* frame)
+{
+    int64_t bytes = 0;
+    for (const AVBufferRef* buffer : frame->buf) {
+        if (buffer)
+            bytes += static_cast<int64_t>(buffer->size);
+    }
+    for (int i = 0; i < frame->nb_extended_buf; i++)
+        bytes += static_cast<int64_t>(frame->extended_buf[i]->size); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return bytes;
+}
+
+namespace {
+
+// A codec buffer wrapped so it is accounted until its last reference is released,
+// which may be after the Stream and its clip are destroyed
+struct AccountedBuffer {
+    AVBufferRef* buffer;
+    std::shared_ptr<MemoryAccounting::Account> account;
+    MemoryAccounting::Allocation allocation;
+};
+
+void releaseAccountedBuffer(void* opaque, uint8_t*)
+{
+    std::unique_ptr<AccountedBuffer> accounted(static_cast<AccountedBuffer*>(opaque));
+    av_buffer_unref(&accounted->buffer);
+}
+
+bool accountBuffer(AVBufferRef** buffer, const std::shared_ptr<MemoryAccounting::Account>& account)
+{
+    auto accounted = std::make_unique<AccountedBuffer>(AccountedBuffer { *buffer, account, MemoryAccounting::Allocation(account.get(), MemoryAccounting::Category::CodecFrames, static_cast<int64_t>((*buffer)->size)) });
+    AVBufferRef* wrapped = av_buffer_create((*buffer)->data, (*buffer)->size, releaseAccountedBuffer, accounted.get(), 0);
+    if (!wrapped)
+        return false;
+    accounted.release();
+    *buffer = wrapped;
+    return true;
+}
+
+// Allocates with the default allocator, then wraps each buffer to account for it.
+// Called on codec worker threads.
+int getAccountedBuffer(AVCodecContext* codecContext, AVFrame* frame, int flags)
+{
+    int ret = avcodec_default_get_buffer2(codecContext, frame, flags);
+    if (ret < 0)
+        return ret;
+    const auto& account = *static_cast<std::shared_ptr<MemoryAccounting::Account>*>(codecContext->opaque);
+    for (AVBufferRef*& buffer : frame->buf) {
+        if (buffer && !accountBuffer(&buffer, account))
+            return AVERROR(ENOMEM);
+    }
+    for (int i = 0; i < frame->nb_extended_buf; i++) {
+        if (!accountBuffer(&frame->extended_buf[i], account)) // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+}
+
 class Filter {
 public:
     Filter(AVFilterGraph* filterGraph)
@@ -110,6 +175,10 @@ int Stream::open(AVFormatContext* formatContext, AVMediaType mediaType, int rela
         return ret;
     }
     m_codecContext->pkt_timebase = avstream->time_base;
+    if (m_memoryAccount) {
+        m_codecContext->opaque = &m_memoryAccount;
+        m_codecContext->get_buffer2 = getAccountedBuffer;
+    }
     if ((ret = avcodec_open2(m_codecContext, codec, NULL)) < 0) {
         emit errorMessage(u"%1 stream avcodec_open2 failed: %2"_s.arg(streamType(), av_err2qstring(ret)));
         return ret;
@@ -211,6 +280,7 @@ int Stream::bufferSrcAddFrame(AVFrame* frame)
     // Return if we already sent EOF
     if (m_bufferSrcEOF)
         return 0;
+    Tracer::Span span("Stream::pushFrame");
     if ((ret = av_buffersrc_add_frame_flags(bufferSrcContext(), frame, frame ? AV_BUFFERSRC_FLAG_KEEP_REF : AV_BUFFERSRC_FLAG_PUSH)) < 0) {
         emit errorMessage(u"%1 stream av_buffersrc_add_frame_flags failed: %2"_s.arg(streamType(), av_err2qstring(ret)));
         return ret;
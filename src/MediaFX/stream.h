@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "memory_accounting.h"
 #include <QObject>
 #include <QString>
 #include <chrono>
@@ -24,6 +25,9 @@ struct FreeFrame {
     void operator()(AVFrame* frame) const;
 };
 
+// Total size of the buffers referenced by frame
+int64_t frameBufferBytes(const AVFrame* frame);
+
 class Stream : public QObject {
     Q_OBJECT
 public:
@@ -34,6 +38,10 @@ public:
     Stream& operator=(Stream&&) = delete;
     ~Stream() override;
 
+    // Decoded buffers are accounted against account, codec buffers share it until released. Set before open()
+    void setMemoryAccount(const std::shared_ptr<MemoryAccounting::Account>& account) { m_memoryAccount = account; }
+    MemoryAccounting::Account* memoryAccount() const { return m_memoryAccount.get(); }
+
     int open(AVFormatContext* formatContext, AVMediaType mediaType, int relatedStreamIndex);
     bool isSinkFrameTimeValid(int64_t pts);
     int bufferSrcAddFrame(AVFrame* frame);
@@ -68,6 +76,8 @@ private:
     int m_streamIndex = -1;
     bool m_streamEOF = false;
     bool m_bufferSrcEOF = false;
+    // The codec context opaque points to this
+    std::shared_ptr<MemoryAccounting::Account> m_memoryAccount;
     AVCodecContext* m_codecContext = nullptr;
     std::unique_ptr<Filter> m_filter;
     std::unique_ptr<AVFrame, FreeFrame> m_frame;
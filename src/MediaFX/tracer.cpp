@@ -0,0 +1,181 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "tracer.h"
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QFileDevice>
+#include <QIODevice>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QString>
+#include <QThread>
+#include <QtLogging>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+using namespace Qt::Literals::StringLiterals;
+
+namespace {
+
+struct Event {
+    const char* name;
+    steady_clock::time_point start;
+    steady_clock::time_point end;
+    QString source;
+    int64_t frame;
+};
+
+// Only the owning thread appends, the mutex is uncontended except while writing the trace
+struct ThreadEvents {
+    int tid = 0;
+    QString name;
+    std::mutex mutex;
+    std::vector<Event> events;
+};
+
+struct ThreadContext {
+    ThreadEvents* events = nullptr;
+    QString source;
+    int64_t frame = -1;
+};
+
+thread_local ThreadContext t_context; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+std::mutex s_threadsMutex; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+// Outlive their threads so spans from finished threads are still written
+std::vector<std::unique_ptr<ThreadEvents>> s_threads; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+steady_clock::time_point s_startTime; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+ThreadEvents& threadEvents()
+{
+    if (!t_context.events) {
+        auto events = std::make_unique<ThreadEvents>();
+        QThread* thread = QThread::currentThread();
+        if (!thread->objectName().isEmpty())
+            events->name = thread->objectName();
+        else if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread())
+            events->name = u"MediaFX main"_s;
+        std::lock_guard lock(s_threadsMutex);
+        events->tid = static_cast<int>(s_threads.size()) + 1;
+        if (events->name.isEmpty())
+            events->name = u"thread %1"_s.arg(events->tid);
+        t_context.events = events.get();
+        s_threads.push_back(std::move(events));
+    }
+    return *t_context.events;
+}
+
+double microsecondsSinceStart(steady_clock::time_point time)
+{
+    return duration<double, std::micro>(time - s_startTime).count();
+}
+
+}
+
+void Tracer::Context::enter(const QString& source, int64_t frame)
+{
+    m_previousSource = std::exchange(t_context.source, source);
+    m_previousFrame = std::exchange(t_context.frame, frame);
+}
+
+void Tracer::Context::enter(int64_t frame)
+{
+    m_previousSource = t_context.source;
+    m_previousFrame = std::exchange(t_context.frame, frame);
+}
+
+void Tracer::Context::leave()
+{
+    t_context.source = std::move(m_previousSource);
+    t_context.frame = m_previousFrame;
+}
+
+void Tracer::start()
+{
+    std::lock_guard lock(s_threadsMutex);
+    for (auto& thread : s_threads) {
+        std::lock_guard threadLock(thread->mutex);
+        thread->events.clear();
+    }
+    s_startTime = steady_clock::now();
+    s_enabled.store(true, std::memory_order_relaxed);
+}
+
+bool Tracer::finish(const QString& fileName)
+{
+    s_enabled.store(false, std::memory_order_relaxed);
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCritical() << "Could not open trace file" << fileName << file.errorString();
+        return false;
+    }
+    const qint64 pid = QCoreApplication::applicationPid();
+    bool first = true;
+    auto writeEvent = [&](const QJsonObject& event) {
+        file.write(first ? "\n" : ",\n");
+        first = false;
+        file.write(QJsonDocument(event).toJson(QJsonDocument::Compact));
+    };
+
+    file.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    std::lock_guard lock(s_threadsMutex);
+    for (auto& thread : s_threads) {
+        std::lock_guard threadLock(thread->mutex);
+        writeEvent(QJsonObject {
+            { u"name"_s, u"thread_name"_s },
+            { u"ph"_s, u"M"_s },
+            { u"pid"_s, pid },
+            { u"tid"_s, thread->tid },
+            { u"args"_s, QJsonObject { { u"name"_s, thread->name } } },
+        });
+        for (const auto& event : thread->events) {
+            QJsonObject args;
+            if (!event.source.isEmpty())
+                args.insert(u"source"_s, event.source);
+            if (event.frame >= 0)
+                args.insert(u"frame"_s, static_cast<qint64>(event.frame));
+            writeEvent(QJsonObject {
+                { u"name"_s, QString::fromLatin1(event.name) },
+                { u"ph"_s, u"X"_s },
+                { u"pid"_s, pid },
+                { u"tid"_s, thread->tid },
+                { u"ts"_s, microsecondsSinceStart(event.start) },
+                { u"dur"_s, duration<double, std::micro>(event.end - event.start).count() },
+                { u"args"_s, args },
+            });
+        }
+        thread->events.clear();
+    }
+    file.write("\n]}\n");
+    if (!file.flush() || file.error() != QFileDevice::NoError) {
+        qCritical() << "Could not write trace file" << fileName << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void Tracer::setThreadName(const QString& name)
+{
+    if (!isEnabled())
+        return;
+    ThreadEvents& events = threadEvents();
+    std::lock_guard lock(events.mutex);
+    events.name = name;
+}
+
+int64_t Tracer::currentFrame()
+{
+    return t_context.frame;
+}
+
+void Tracer::record(const char* name, steady_clock::time_point start, steady_clock::time_point end)
+{
+    ThreadEvents& events = threadEvents();
+    std::lock_guard lock(events.mutex);
+    events.events.push_back(Event { name, start, end, t_context.source, t_context.frame });
+}
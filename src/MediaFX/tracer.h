@@ -0,0 +1,94 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+using namespace std::chrono;
+
+// Records timestamped spans across all threads and writes them in Chrome trace event format,
+// viewable in Perfetto or chrome://tracing.
+// Disabled by default, a disabled Span or Context only tests a flag.
+class Tracer {
+public:
+    // Tags spans recorded on this thread while in scope with a clip source and frame number
+    class Context {
+    public:
+        Context(const QString& source, int64_t frame)
+            : m_enabled(Tracer::isEnabled())
+        {
+            if (Q_UNLIKELY(m_enabled))
+                enter(source, frame);
+        }
+        // Keeps the current source
+        explicit Context(int64_t frame)
+            : m_enabled(Tracer::isEnabled())
+        {
+            if (Q_UNLIKELY(m_enabled))
+                enter(frame);
+        }
+        Context(Context&&) = delete;
+        Context(const Context&) = delete;
+        Context& operator=(Context&&) = delete;
+        Context& operator=(const Context&) = delete;
+        ~Context()
+        {
+            if (Q_UNLIKELY(m_enabled))
+                leave();
+        }
+
+    private:
+        void enter(const QString& source, int64_t frame);
+        void enter(int64_t frame);
+        void leave();
+
+        bool m_enabled;
+        QString m_previousSource;
+        int64_t m_previousFrame = -1;
+    };
+
+    // Records the enclosing scope as a span, name must be a string literal
+    class Span {
+    public:
+        explicit Span(const char* name)
+            : m_name(Tracer::isEnabled() ? name : nullptr)
+        {
+            if (Q_UNLIKELY(m_name))
+                m_start = steady_clock::now();
+        }
+        Span(Span&&) = delete;
+        Span(const Span&) = delete;
+        Span& operator=(Span&&) = delete;
+        Span& operator=(const Span&) = delete;
+        ~Span()
+        {
+            if (Q_UNLIKELY(m_name))
+                Tracer::record(m_name, m_start, steady_clock::now());
+        }
+
+    private:
+        const char* m_name;
+        steady_clock::time_point m_start;
+    };
+
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    // Discards any previous spans and starts recording
+    static void start();
+    // Stops recording and writes all spans to fileName
+    static bool finish(const QString& fileName);
+
+    // Names this thread in the trace, Qt threads default to their QThread objectName
+    static void setThreadName(const QString& name);
+    // Frame number of the innermost Context on this thread, or -1
+    static int64_t currentFrame();
+
+private:
+    static void record(const char* name, steady_clock::time_point start, steady_clock::time_point end);
+
+    static inline std::atomic<bool> s_enabled = false;
+};
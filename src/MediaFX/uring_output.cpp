@@ -0,0 +1,231 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "uring_output.h"
+#include <QString>
+
+#ifdef MEDIAFX_ENABLE_IO_URING
+
+#include <QDebug>
+#include <QRegularExpression>
+#include <QtLogging>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <liburing.h>
+#include <memory>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+extern "C" {
+#include <libavformat/avio.h>
+}
+using namespace Qt::Literals::StringLiterals;
+
+namespace {
+
+constexpr size_t Alignment = 4096;
+constexpr int AVIOBufferSize = 64 * 1024;
+
+}
+
+std::unique_ptr<UringOutput> UringOutput::create(const QString& outputFileName, bool directIO)
+{
+    QString fileName = outputFileName;
+    if (fileName.startsWith(u"file:"_s))
+        fileName.remove(0, 5);
+    // Anything else with a protocol prefix is left to avio
+    static const QRegularExpression protocolRegex(u"^[A-Za-z][A-Za-z0-9+.-]*:"_s);
+    if (fileName.isEmpty() || protocolRegex.match(fileName).hasMatch())
+        return nullptr;
+
+    std::unique_ptr<UringOutput> output(new UringOutput());
+    if (!output->open(fileName, directIO))
+        return nullptr;
+    return output;
+}
+
+UringOutput::~UringOutput()
+{
+    if (m_ring) {
+        // The kernel may still be reading from our chunks
+        while (m_inFlight > 0 && reapCompletion(true)) { }
+        io_uring_queue_exit(m_ring);
+        delete m_ring;
+    }
+    for (auto& chunk : m_chunks)
+        free(chunk.data); // NOLINT(cppcoreguidelines-no-malloc)
+    if (m_fd != -1)
+        ::close(m_fd);
+}
+
+bool UringOutput::open(const QString& fileName, bool directIO)
+{
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    if (directIO) {
+        m_fd = ::open(qUtf8Printable(fileName), flags | O_DIRECT, 0666); // NOLINT(cppcoreguidelines-pro-type-vararg)
+        // Some filesystems (e.g. tmpfs) do not support O_DIRECT
+        if (m_fd == -1 && errno == EINVAL)
+            qWarning() << "O_DIRECT not supported for" << fileName << ", using buffered io_uring output";
+        else
+            m_directIO = true;
+    }
+    if (m_fd == -1) {
+        m_directIO = false;
+        m_fd = ::open(qUtf8Printable(fileName), flags, 0666); // NOLINT(cppcoreguidelines-pro-type-vararg)
+    }
+    if (m_fd == -1) {
+        qCritical() << "Could not open output file" << fileName << strerror(errno);
+        return false;
+    }
+
+    auto ring = std::make_unique<io_uring>();
+    if (int ret = io_uring_queue_init(QueueDepth, ring.get(), 0); ret < 0) {
+        qWarning() << "io_uring unavailable, using avio output:" << strerror(-ret);
+        return false;
+    }
+    m_ring = ring.release();
+
+    m_chunks.resize(QueueDepth);
+    for (auto& chunk : m_chunks) {
+        void* data = nullptr;
+        if (posix_memalign(&data, Alignment, ChunkSize) != 0)
+            return false;
+        chunk.data = static_cast<uint8_t*>(data);
+    }
+
+    // Output is copied straight into our chunks, bypass the AVIOContext buffer
+    return allocateContext(AVIOBufferSize, true, &UringOutput::writePacket);
+}
+
+int UringOutput::writePacket(void* opaque, AVIOWriteBuffer buf, int bufSize)
+{
+    auto* self = static_cast<UringOutput*>(opaque);
+    const uint8_t* data = buf;
+    size_t remaining = bufSize;
+    while (remaining > 0) {
+        if (self->m_failed)
+            return AVERROR(EIO);
+        Chunk& chunk = self->m_chunks[self->m_currentChunk];
+        size_t size = std::min(remaining, ChunkSize - self->m_chunkFill);
+        memcpy(chunk.data + self->m_chunkFill, data, size); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        self->m_chunkFill += size;
+        data += size; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        remaining -= size;
+        if (self->m_chunkFill == ChunkSize && !self->submitChunk(ChunkSize))
+            return AVERROR(EIO);
+    }
+    return bufSize;
+}
+
+bool UringOutput::submitChunk(size_t size)
+{
+    Chunk& chunk = m_chunks[m_currentChunk];
+    io_uring_sqe* sqe = io_uring_get_sqe(m_ring);
+    if (!sqe) {
+        qCritical() << "io_uring submission queue full";
+        m_failed = true;
+        return false;
+    }
+    io_uring_prep_write(sqe, m_fd, chunk.data, size, m_fileOffset);
+    io_uring_sqe_set_data(sqe, &chunk);
+    if (int ret = io_uring_submit(m_ring); ret < 0) {
+        qCritical() << "io_uring_submit failed:" << strerror(-ret);
+        m_failed = true;
+        return false;
+    }
+    chunk.size = size;
+    chunk.inFlight = true;
+    m_inFlight++;
+    m_fileOffset += size;
+    m_chunkFill = 0;
+    m_currentChunk = (m_currentChunk + 1) % m_chunks.size();
+
+    // Collect finished writes, and block only if the next chunk is still being written
+    while (reapCompletion(false)) { }
+    while (!m_failed && m_chunks[m_currentChunk].inFlight)
+        reapCompletion(true);
+    return !m_failed;
+}
+
+bool UringOutput::reapCompletion(bool wait)
+{
+    if (m_inFlight == 0)
+        return false;
+    io_uring_cqe* cqe = nullptr;
+    int ret = wait ? io_uring_wait_cqe(m_ring, &cqe) : io_uring_peek_cqe(m_ring, &cqe);
+    if (ret == -EAGAIN || ret == -EINTR)
+        return false;
+    if (ret < 0) {
+        qCritical() << "io_uring wait failed:" << strerror(-ret);
+        m_failed = true;
+        return false;
+    }
+    auto* chunk = static_cast<Chunk*>(io_uring_cqe_get_data(cqe));
+    if (cqe->res < 0) {
+        qCritical() << "io_uring write failed:" << strerror(-cqe->res);
+        m_failed = true;
+    } else if (static_cast<size_t>(cqe->res) != chunk->size) {
+        qCritical() << "io_uring short write" << cqe->res << "of" << chunk->size;
+        m_failed = true;
+    }
+    io_uring_cqe_seen(m_ring, cqe);
+    chunk->inFlight = false;
+    m_inFlight--;
+    return true;
+}
+
+bool UringOutput::finish()
+{
+    avio_flush(context());
+    if (m_failed)
+        return false;
+
+    uint64_t fileSize = m_fileOffset + m_chunkFill;
+    if (m_chunkFill > 0) {
+        size_t size = m_chunkFill;
+        if (m_directIO) {
+            // O_DIRECT writes must be block aligned, the padding is truncated below
+            size = (size + Alignment - 1) / Alignment * Alignment;
+            memset(m_chunks[m_currentChunk].data + m_chunkFill, 0, size - m_chunkFill); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        }
+        if (!submitChunk(size))
+            return false;
+    }
+    while (!m_failed && m_inFlight > 0)
+        reapCompletion(true);
+    if (m_failed)
+        return false;
+
+    if (m_directIO && ftruncate(m_fd, static_cast<off_t>(fileSize)) == -1) {
+        qCritical() << "Could not truncate output file:" << strerror(errno);
+        return false;
+    }
+    if (fsync(m_fd) == -1) {
+        qCritical() << "Could not sync output file:" << strerror(errno);
+        return false;
+    }
+    if (::close(m_fd) == -1) {
+        m_fd = -1;
+        qCritical() << "Could not close output file:" << strerror(errno);
+        return false;
+    }
+    m_fd = -1;
+    return context()->error == 0;
+}
+
+#else
+
+std::unique_ptr<UringOutput> UringOutput::create(const QString&, bool)
+{
+    return nullptr;
+}
+
+UringOutput::~UringOutput() = default;
+
+bool UringOutput::finish()
+{
+    return false;
+}
+
+#endif
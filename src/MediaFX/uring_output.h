@@ -0,0 +1,57 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include "avio_output.h"
+#include <QString>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+struct io_uring;
+
+// File output through io_uring.
+// Output is gathered into large page aligned chunks which are written asynchronously
+// with several writes in flight, so the render thread does not block on write syscalls.
+// Optionally opened O_DIRECT to bypass the page cache. The file is fsynced in finish().
+class UringOutput : public AVIOOutput {
+public:
+    static constexpr size_t ChunkSize = 4 * 1024 * 1024;
+    static constexpr unsigned QueueDepth = 4;
+
+    // Returns nullptr if io_uring is unavailable or outputFileName is not a local file
+    static std::unique_ptr<UringOutput> create(const QString& outputFileName, bool directIO);
+
+    UringOutput(UringOutput&&) = delete;
+    UringOutput(const UringOutput&) = delete;
+    UringOutput& operator=(UringOutput&&) = delete;
+    UringOutput& operator=(const UringOutput&) = delete;
+    ~UringOutput() override;
+
+    bool finish() override;
+
+private:
+    UringOutput() = default;
+
+    bool open(const QString& fileName, bool directIO);
+    static int writePacket(void* opaque, AVIOWriteBuffer buf, int bufSize);
+    bool submitChunk(size_t size);
+    bool reapCompletion(bool wait);
+
+    struct Chunk {
+        uint8_t* data = nullptr;
+        size_t size = 0;
+        bool inFlight = false;
+    };
+
+    int m_fd = -1;
+    bool m_directIO = false;
+    io_uring* m_ring = nullptr;
+    std::vector<Chunk> m_chunks;
+    size_t m_currentChunk = 0;
+    size_t m_chunkFill = 0;
+    uint64_t m_fileOffset = 0;
+    unsigned m_inFlight = 0;
+    bool m_failed = false;
+};
@@ -0,0 +1,79 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QImage>
+#include <QSGTexture>
+#include <QSize>
+#include <QVideoFrame>
+#include <QtTypes>
+#include <memory>
+#include <rhi/qrhi.h>
+
+// Texture uploaded from the RGBA pixels of the most recent frame.
+// Created, used and destroyed on the render thread.
+class VideoFrameTexture : public QSGTexture {
+public:
+    VideoFrameTexture()
+    {
+        setFiltering(QSGTexture::Linear);
+    }
+    VideoFrameTexture(VideoFrameTexture&&) = delete;
+    VideoFrameTexture(const VideoFrameTexture&) = delete;
+    VideoFrameTexture& operator=(VideoFrameTexture&&) = delete;
+    VideoFrameTexture& operator=(const VideoFrameTexture&) = delete;
+    ~VideoFrameTexture() override = default;
+
+    // The frame is uploaded by the next commitTextureOperations()
+    void setVideoFrame(const QVideoFrame& videoFrame, bool mirrorVertically)
+    {
+        m_videoFrame = videoFrame;
+        m_currentVideoFrame = videoFrame;
+        m_mirrorVertically = mirrorVertically;
+        m_size = videoFrame.size();
+    }
+    // The last frame set, to skip setting the same frame again
+    const QVideoFrame& currentVideoFrame() const { return m_currentVideoFrame; }
+    // Number of frames uploaded
+    int uploadCount() const { return m_uploadCount; }
+
+    qint64 comparisonKey() const override { return static_cast<qint64>(reinterpret_cast<quintptr>(this)); } // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    QRhiTexture* rhiTexture() const override { return m_texture.get(); }
+    QSize textureSize() const override { return m_size; }
+    bool hasAlphaChannel() const override { return true; }
+    bool hasMipmaps() const override { return false; }
+
+    void commitTextureOperations(QRhi* rhi, QRhiResourceUpdateBatch* resourceUpdates) override
+    {
+        if (!m_videoFrame.isValid())
+            return;
+        QVideoFrame videoFrame(m_videoFrame);
+        // Release the frame once uploaded
+        m_videoFrame = QVideoFrame();
+        if (!videoFrame.map(QVideoFrame::ReadOnly))
+            return;
+        // Frames are a single packed RGBA plane, see VideoPixelFormat_Qt
+        QImage frameImage(videoFrame.bits(0), videoFrame.width(), videoFrame.height(), videoFrame.bytesPerLine(0), QImage::Format_RGBA8888);
+        QImage image = m_mirrorVertically ? frameImage.mirrored() : frameImage.copy();
+        videoFrame.unmap();
+
+        if (!m_texture || m_texture->pixelSize() != image.size()) {
+            m_texture.reset(rhi->newTexture(QRhiTexture::RGBA8, image.size()));
+            if (!m_texture->create()) {
+                m_texture.reset();
+                return;
+            }
+        }
+        resourceUpdates->uploadTexture(m_texture.get(), image);
+        m_uploadCount++;
+    }
+
+private:
+    QVideoFrame m_videoFrame;
+    QVideoFrame m_currentVideoFrame;
+    bool m_mirrorVertically = false;
+    QSize m_size;
+    int m_uploadCount = 0;
+    std::unique_ptr<QRhiTexture> m_texture;
+};
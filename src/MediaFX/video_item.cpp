@@ -0,0 +1,179 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "video_item.h"
+#include "media_clip.h"
+#include "video_frame_texture.h"
+#include <QPointF>
+#include <QQuickWindow>
+#include <QSGImageNode>
+#include <QSGNode>
+#include <QSizeF>
+#include <memory>
+
+namespace {
+
+// Keeps the shared texture alive while the image node samples it
+class VideoItemNode : public QSGNode {
+public:
+    explicit VideoItemNode(QSGImageNode* imageNode)
+        : m_imageNode(imageNode)
+    {
+        appendChildNode(imageNode);
+    }
+    VideoItemNode(VideoItemNode&&) = delete;
+    VideoItemNode(const VideoItemNode&) = delete;
+    VideoItemNode& operator=(VideoItemNode&&) = delete;
+    VideoItemNode& operator=(const VideoItemNode&) = delete;
+    ~VideoItemNode() override = default;
+
+    QSGImageNode* imageNode() const { return m_imageNode; }
+
+    void setTexture(const std::shared_ptr<VideoFrameTexture>& texture)
+    {
+        if (texture != m_texture) {
+            m_texture = texture;
+            m_imageNode->setTexture(m_texture.get());
+        }
+    }
+
+private:
+    // Owned by this node as its child
+    QSGImageNode* m_imageNode;
+    std::shared_ptr<VideoFrameTexture> m_texture;
+};
+
+}
+
+/*!
+    \qmltype VideoItem
+    //! \instantiates VideoItem
+    \inqmlmodule MediaFX
+    \inherits Item
+    \brief Renders video frames from a MediaClip, sharing one texture with other VideoItems.
+
+    Each \l VideoRenderer uploads every frame of its clip to its own texture.
+    All VideoItems rendering the same \l mediaClip share a single texture instead,
+    so each frame is uploaded once however many items render it.
+*/
+VideoItem::VideoItem(QQuickItem* parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents);
+}
+
+VideoItem::~VideoItem()
+{
+    if (m_mediaClip)
+        m_mediaClip->detachVideoItem();
+}
+
+/*!
+    \qmlproperty MediaClip VideoItem::mediaClip
+
+    The MediaClip to render.
+*/
+void VideoItem::setMediaClip(MediaClip* mediaClip)
+{
+    if (mediaClip == m_mediaClip)
+        return;
+    if (m_videoSink)
+        disconnect(m_videoSink, nullptr, this, nullptr);
+    if (m_mediaClip) {
+        disconnect(m_mediaClip, nullptr, this, nullptr);
+        m_mediaClip->detachVideoItem();
+    }
+    m_mediaClip = mediaClip;
+    m_videoSink = m_mediaClip ? m_mediaClip->attachVideoItem() : nullptr;
+    if (m_videoSink) {
+        // Stop rendering the last frame of a clip destroyed while still set
+        connect(m_mediaClip, &QObject::destroyed, this, &VideoItem::onMediaClipDestroyed);
+        connect(m_videoSink, &QVideoSink::videoFrameChanged, this, &VideoItem::onVideoFrameChanged);
+        onVideoFrameChanged(m_videoSink->videoFrame());
+    } else {
+        onVideoFrameChanged(QVideoFrame());
+    }
+    emit mediaClipChanged();
+}
+
+/*!
+    \qmlproperty enumeration VideoItem::fillMode
+
+    How the frames are scaled to the item, the same as VideoOutput.fillMode,
+    default \c VideoOutput.PreserveAspectFit.
+    \sa {VideoOutput::fillMode}
+*/
+void VideoItem::setFillMode(int fillMode)
+{
+    if (m_fillMode != fillMode) {
+        m_fillMode = fillMode;
+        update();
+        emit fillModeChanged();
+    }
+}
+
+void VideoItem::onVideoFrameChanged(const QVideoFrame& videoFrame)
+{
+    m_videoFrame = videoFrame;
+    m_videoFrameDirty = true;
+    update();
+}
+
+void VideoItem::onMediaClipDestroyed()
+{
+    m_videoSink = nullptr;
+    onVideoFrameChanged(QVideoFrame());
+    emit mediaClipChanged();
+}
+
+void VideoItem::geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry)
+{
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    update();
+}
+
+std::shared_ptr<VideoFrameTexture> VideoItem::syncSharedTexture(std::weak_ptr<VideoFrameTexture>& sharedTexture, const QVideoFrame& videoFrame)
+{
+    std::shared_ptr<VideoFrameTexture> texture = sharedTexture.lock();
+    if (!texture) {
+        texture = std::make_shared<VideoFrameTexture>();
+        sharedTexture = texture;
+    }
+    // Whichever item synchronizes first sets a new frame, the texture uploads it once when first drawn
+    if (texture->currentVideoFrame() != videoFrame)
+        texture->setVideoFrame(videoFrame, false);
+    return texture;
+}
+
+QSGNode* VideoItem::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData*)
+{
+    auto node = static_cast<VideoItemNode*>(oldNode);
+    if (!m_mediaClip || !m_videoFrame.isValid() || width() <= 0 || height() <= 0) {
+        delete node; // NOLINT(cppcoreguidelines-owning-memory)
+        return nullptr;
+    }
+    if (!node)
+        node = new VideoItemNode(window()->createImageNode()); // NOLINT(cppcoreguidelines-owning-memory)
+
+    node->setTexture(syncSharedTexture(m_mediaClip->sharedVideoTexture(), m_videoFrame));
+    QSGImageNode* imageNode = node->imageNode();
+    if (m_videoFrameDirty) {
+        imageNode->markDirty(QSGNode::DirtyMaterial);
+        m_videoFrameDirty = false;
+    }
+
+    const QSizeF frameSize(m_videoFrame.size());
+    QRectF rect = boundingRect();
+    QRectF sourceRect(QPointF(0, 0), frameSize);
+    if (m_fillMode == Qt::KeepAspectRatio) {
+        const QSizeF fitted = frameSize.scaled(size(), Qt::KeepAspectRatio);
+        rect = QRectF(QPointF((width() - fitted.width()) / 2, (height() - fitted.height()) / 2), fitted);
+    } else if (m_fillMode == Qt::KeepAspectRatioByExpanding) {
+        // Crop the frame instead of rendering outside the item
+        const QSizeF cropped = size().scaled(frameSize, Qt::KeepAspectRatio);
+        sourceRect = QRectF(QPointF((frameSize.width() - cropped.width()) / 2, (frameSize.height() - cropped.height()) / 2), cropped);
+    }
+    imageNode->setRect(rect);
+    imageNode->setSourceRect(sourceRect);
+    return node;
+}
@@ -0,0 +1,63 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QQuickItem>
+#include <QRectF>
+#include <QVideoFrame>
+#include <QVideoSink> // IWYU pragma: keep
+#include <QtQmlIntegration>
+#include <memory>
+class MediaClip;
+class QSGNode;
+class VideoFrameTexture;
+
+// Renders the video frames of a MediaClip like VideoRenderer, but every VideoItem rendering the same clip
+// shares one texture that each frame is uploaded to once, instead of each VideoOutput uploading its own copy.
+class VideoItem : public QQuickItem {
+    Q_OBJECT
+    Q_PROPERTY(MediaClip* mediaClip READ mediaClip WRITE setMediaClip NOTIFY mediaClipChanged FINAL)
+    Q_PROPERTY(int fillMode READ fillMode WRITE setFillMode NOTIFY fillModeChanged FINAL)
+    QML_ELEMENT
+
+public:
+    explicit VideoItem(QQuickItem* parent = nullptr);
+    VideoItem(VideoItem&&) = delete;
+    VideoItem& operator=(VideoItem&&) = delete;
+    ~VideoItem() override;
+
+    MediaClip* mediaClip() const { return m_mediaClip; }
+    void setMediaClip(MediaClip* mediaClip);
+
+    int fillMode() const { return m_fillMode; }
+    void setFillMode(int fillMode);
+
+    // Returns the texture shared through sharedTexture, creating it if needed,
+    // and sets videoFrame on it unless it is already the current frame
+    static std::shared_ptr<VideoFrameTexture> syncSharedTexture(std::weak_ptr<VideoFrameTexture>& sharedTexture, const QVideoFrame& videoFrame);
+
+signals:
+    void mediaClipChanged();
+    void fillModeChanged();
+
+protected:
+    QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) override;
+    void geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry) override;
+
+private slots:
+    void onVideoFrameChanged(const QVideoFrame& videoFrame);
+    void onMediaClipDestroyed();
+
+private:
+    Q_DISABLE_COPY(VideoItem);
+
+    QPointer<MediaClip> m_mediaClip;
+    QPointer<QVideoSink> m_videoSink;
+    QVideoFrame m_videoFrame;
+    bool m_videoFrameDirty = false;
+    // VideoOutput.PreserveAspectFit
+    int m_fillMode = Qt::KeepAspectRatio;
+};
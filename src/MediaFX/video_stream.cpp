@@ -3,6 +3,8 @@
 
 #include "video_stream.h"
 #include "formats.h"
+#include "memory_accounting.h"
+#include "tracer.h"
 #include "util.h"
 #include <QObject>
 #include <QSize>
@@ -12,6 +14,8 @@
 #include <QtCore>
 #include <array>
 #include <cstring>
+#include <stdint.h>
+#include <utility>
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavfilter/avfilter.h>
@@ -87,12 +91,14 @@ QString VideoStream::configureFilters()
 
 void VideoStream::processFrame(AVFrame* frame)
 {
+    Tracer::Span span("VideoStream::processFrame");
     Stream::processFrame(frame);
     if (!frame) {
         return;
     }
     // Swap frames because VideoOutput just compares internal frame pointers and ignores if the same
     std::swap(m_videoFrames.first, m_videoFrames.second);
+    std::swap(m_videoFrameAllocations.first, m_videoFrameAllocations.second);
     QVideoFrame& videoFrame = m_videoFrames.first;
     QVideoFrameFormat format = videoFrame.surfaceFormat();
     if (format.frameHeight() != frame->height || format.frameWidth() != frame->width) {
@@ -101,6 +107,7 @@ void VideoStream::processFrame(AVFrame* frame)
         newFormat.setColorSpace(VideoColorSpace_Qt);
         newFormat.setColorRange(VideoColorRange_Qt);
         videoFrame = QVideoFrame(newFormat);
+        m_videoFrameAllocations.first = MemoryAccounting::Allocation(memoryAccount(), MemoryAccounting::Category::VideoFrames, static_cast<int64_t>(frame->linesize[0]) * frame->height);
     }
 
     videoFrame.map(QVideoFrame::WriteOnly);
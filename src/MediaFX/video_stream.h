@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "memory_accounting.h"
 #include "stream.h"
 #include "util.h"
 #include <QString>
@@ -38,4 +39,5 @@ protected:
 private:
     AVRational m_outputFrameRate;
     std::pair<QVideoFrame, QVideoFrame> m_videoFrames;
+    std::pair<MemoryAccounting::Allocation, MemoryAccounting::Allocation> m_videoFrameAllocations;
 };
\ No newline at end of file
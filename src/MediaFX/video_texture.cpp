@@ -0,0 +1,207 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "video_texture.h"
+#include "formats.h"
+#include "video_frame_texture.h"
+#include <QList>
+#include <QQmlListReference>
+#include <QQmlProperty>
+#include <QSGTextureProvider>
+#include <QSize>
+#include <QSizeF>
+#include <QVariant>
+#include <QtMath>
+using namespace Qt::Literals::StringLiterals;
+
+class VideoTextureProvider : public QSGTextureProvider {
+public:
+    VideoTextureProvider() = default;
+    VideoTextureProvider(VideoTextureProvider&&) = delete;
+    VideoTextureProvider(const VideoTextureProvider&) = delete;
+    VideoTextureProvider& operator=(VideoTextureProvider&&) = delete;
+    VideoTextureProvider& operator=(const VideoTextureProvider&) = delete;
+    ~VideoTextureProvider() override = default;
+
+    QSGTexture* texture() const override
+    {
+        return m_texture.textureSize().isEmpty() ? nullptr : &m_texture;
+    }
+
+    void setVideoFrame(const QVideoFrame& videoFrame, bool mirrorVertically)
+    {
+        m_texture.setVideoFrame(videoFrame, mirrorVertically);
+        emit textureChanged();
+    }
+
+private:
+    mutable VideoFrameTexture m_texture;
+};
+
+/*!
+    \qmltype VideoTexture
+    //! \instantiates VideoTexture
+    \inqmlmodule MediaFX
+    \inherits Item
+    \brief Provides the frames of a \l VideoRenderer as a texture to a ShaderEffect.
+
+    When \l sourceItem is a hidden, plain \l VideoRenderer (or an item containing only one)
+    the decoded frames are uploaded and sampled directly, avoiding rendering the item
+    into an offscreen ShaderEffectSource layer.
+    \l direct is \c false if the frames can not be used as is, e.g. the renderer is transformed,
+    has a layer effect or letterboxes the video. A ShaderEffectSource should be used instead then.
+*/
+VideoTexture::VideoTexture(QQuickItem* parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents);
+}
+
+VideoTexture::~VideoTexture()
+{
+    releaseResources();
+}
+
+/*!
+    \qmlproperty Item VideoTexture::sourceItem
+
+    The \l VideoRenderer, or item containing a \l VideoRenderer, to sample frames from.
+*/
+void VideoTexture::setSourceItem(QQuickItem* sourceItem)
+{
+    if (sourceItem == m_sourceItem)
+        return;
+    if (m_sourceItem)
+        disconnect(m_sourceItem, nullptr, this, nullptr);
+    if (m_videoSink)
+        disconnect(m_videoSink, nullptr, this, nullptr);
+    m_sourceItem = sourceItem;
+    // Sampled directly the source is not hidden like ShaderEffectSource.hideSource, so it must already be hidden
+    if (m_sourceItem)
+        connect(m_sourceItem, &QQuickItem::visibleChanged, this, &VideoTexture::updateDirect);
+    m_videoOutput = m_sourceItem ? findVideoOutput(m_sourceItem) : nullptr;
+    m_videoSink = m_videoOutput ? m_videoOutput->property("videoSink").value<QVideoSink*>() : nullptr;
+    if (m_videoSink) {
+        connect(m_videoSink, &QVideoSink::videoFrameChanged, this, &VideoTexture::onVideoFrameChanged);
+        // The current frame may have been rendered before we connected
+        onVideoFrameChanged(m_videoSink->videoFrame());
+    } else {
+        onVideoFrameChanged(QVideoFrame());
+    }
+    emit sourceItemChanged();
+}
+
+/*!
+    \qmlproperty bool VideoTexture::mirrorVertically
+
+    Upload frames upside down, to match a ShaderEffectSource with \c ShaderEffectSource.NoMirroring.
+*/
+void VideoTexture::setMirrorVertically(bool mirrorVertically)
+{
+    if (mirrorVertically != m_mirrorVertically) {
+        m_mirrorVertically = mirrorVertically;
+        m_videoFrameDirty = true;
+        update();
+        emit mirrorVerticallyChanged();
+    }
+}
+
+/*!
+    \qmlproperty bool VideoTexture::direct
+
+    \c true if frames from \l sourceItem are being sampled directly.
+*/
+
+QQuickItem* VideoTexture::findVideoOutput(QQuickItem* item)
+{
+    auto isVideoOutput = [](QQuickItem* item) {
+        return item->property("videoSink").value<QVideoSink*>() != nullptr;
+    };
+    if (isVideoOutput(item))
+        return item;
+    // e.g. MediaSequence clipping container
+    const QList<QQuickItem*> children = item->childItems();
+    if (children.size() == 1 && isVideoOutput(children.first()))
+        return children.first();
+    return nullptr;
+}
+
+void VideoTexture::onVideoFrameChanged(const QVideoFrame& videoFrame)
+{
+    m_videoFrame = videoFrame;
+    m_videoFrameDirty = true;
+    updateDirect();
+    if (m_direct)
+        update();
+}
+
+void VideoTexture::updateDirect()
+{
+    bool direct = false;
+    QQuickItem* output = m_videoOutput;
+    if (output && !m_sourceItem->isVisible() && m_videoFrame.isValid() && m_videoFrame.pixelFormat() == VideoPixelFormat_Qt
+        && m_videoFrame.rotation() == QtVideo::Rotation::None && !m_videoFrame.mirrored()) {
+        // The output must render the frame as is, filling the source item
+        direct = output->childItems().isEmpty()
+            && qFuzzyCompare(output->opacity(), 1.0)
+            && qFuzzyCompare(output->scale(), 1.0)
+            && qFuzzyIsNull(output->rotation())
+            && QQmlListReference(output, "transform").count() == 0
+            && !QQmlProperty::read(output, u"layer.enabled"_s).toBool()
+            && output->property("orientation").toInt() == 0;
+        if (direct && output != m_sourceItem) {
+            direct = output->position().isNull()
+                && output->size() == m_sourceItem->size()
+                && qFuzzyCompare(m_sourceItem->opacity(), 1.0);
+        }
+        if (direct) {
+            const auto fillMode = static_cast<Qt::AspectRatioMode>(output->property("fillMode").toInt());
+            const QSizeF outputSize = output->size();
+            const QSizeF frameSize = QSizeF(m_videoFrame.size()).scaled(outputSize, fillMode);
+            direct = qAbs(frameSize.width() - outputSize.width()) < 1 && qAbs(frameSize.height() - outputSize.height()) < 1;
+        }
+    }
+    if (direct != m_direct) {
+        m_direct = direct;
+        if (m_direct)
+            update();
+        emit directChanged();
+    }
+}
+
+QSGTextureProvider* VideoTexture::textureProvider() const
+{
+    if (!m_provider) {
+        m_provider = new VideoTextureProvider(); // NOLINT(cppcoreguidelines-owning-memory)
+        if (m_videoFrame.isValid())
+            m_provider->setVideoFrame(m_videoFrame, m_mirrorVertically);
+    }
+    return m_provider;
+}
+
+QSGNode* VideoTexture::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData*)
+{
+    // Nothing is rendered, the frame is only synced to the provider
+    if (m_provider && m_videoFrameDirty && m_direct) {
+        m_provider->setVideoFrame(m_videoFrame, m_mirrorVertically);
+        m_videoFrameDirty = false;
+    }
+    return oldNode;
+}
+
+void VideoTexture::releaseResources()
+{
+    // The provider lives on the render thread, its event loop deletes it without waiting for the window to sync again.
+    // A render server job can end with the item leaving a window that is never synced for it.
+    if (m_provider) {
+        m_provider->deleteLater();
+        m_provider = nullptr;
+    }
+}
+
+void VideoTexture::invalidateSceneGraph()
+{
+    // Called on the render thread before the QRhi is destroyed
+    delete m_provider; // NOLINT(cppcoreguidelines-owning-memory)
+    m_provider = nullptr;
+}
@@ -0,0 +1,76 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QQuickItem>
+#include <QRectF>
+#include <QVideoFrame>
+#include <QVideoSink> // IWYU pragma: keep
+#include <QtQmlIntegration>
+class QSGNode;
+class QSGTextureProvider;
+class VideoTextureProvider;
+
+// Texture provider for ShaderEffect that samples the frames rendered by a plain VideoOutput directly,
+// instead of rendering the item into an offscreen layer like ShaderEffectSource.
+// direct is false if the VideoOutput is visible, transformed or letterboxed, or sourceItem is anything else,
+// and a ShaderEffectSource layer should be used instead.
+class VideoTexture : public QQuickItem {
+    Q_OBJECT
+    Q_PROPERTY(QQuickItem* sourceItem READ sourceItem WRITE setSourceItem NOTIFY sourceItemChanged FINAL)
+    Q_PROPERTY(bool mirrorVertically READ mirrorVertically WRITE setMirrorVertically NOTIFY mirrorVerticallyChanged FINAL)
+    Q_PROPERTY(bool direct READ isDirect NOTIFY directChanged FINAL)
+    QML_ELEMENT
+
+public:
+    using QQuickItem::QQuickItem;
+
+    VideoTexture(QQuickItem* parent = nullptr);
+    VideoTexture(VideoTexture&&) = delete;
+    VideoTexture& operator=(VideoTexture&&) = delete;
+    ~VideoTexture() override;
+
+    QQuickItem* sourceItem() const { return m_sourceItem; }
+    void setSourceItem(QQuickItem* sourceItem);
+
+    bool mirrorVertically() const { return m_mirrorVertically; }
+    void setMirrorVertically(bool mirrorVertically);
+
+    bool isDirect() const { return m_direct; }
+
+    bool isTextureProvider() const override { return true; }
+    QSGTextureProvider* textureProvider() const override;
+
+signals:
+    void sourceItemChanged();
+    void mirrorVerticallyChanged();
+    void directChanged();
+
+protected:
+    QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) override;
+    void releaseResources() override;
+
+private slots:
+    void onVideoFrameChanged(const QVideoFrame& videoFrame);
+    void updateDirect();
+    // Qt Quick calls this slot by name when the scene graph is invalidated
+    void invalidateSceneGraph();
+
+private:
+    Q_DISABLE_COPY(VideoTexture);
+
+    static QQuickItem* findVideoOutput(QQuickItem* item);
+
+    QPointer<QQuickItem> m_sourceItem;
+    QPointer<QQuickItem> m_videoOutput;
+    QPointer<QVideoSink> m_videoSink;
+    QVideoFrame m_videoFrame;
+    bool m_videoFrameDirty = false;
+    bool m_mirrorVertically = false;
+    bool m_direct = false;
+    // Created, used and deleted on the render thread
+    mutable VideoTextureProvider* m_provider = nullptr;
+};
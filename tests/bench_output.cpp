@@ -0,0 +1,159 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Output backend throughput benchmark, not run by ctest.
+// Run ./bench_output to compare buffered and zero-copy pipe output,
+// and avio and io_uring file output. File output is written below the current directory,
+// run it from the disk to be measured (not tmpfs). io_uring results include the fsync done in finish().
+
+#include "formats.h"
+#include "muxer.h"
+#include "util.h"
+#include <QAudioBuffer>
+#include <QAudioFormat>
+#include <QByteArray>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QTemporaryDir>
+#include <QtCore>
+#include <QtTest>
+#include <array>
+#include <chrono>
+#include <fcntl.h>
+#include <stdint.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+extern "C" {
+#include <libavutil/rational.h>
+}
+using namespace std::chrono;
+using namespace Qt::Literals::StringLiterals;
+
+namespace {
+
+constexpr int FrameCount = 120;
+constexpr AVRational FrameRate = { 30, 1 };
+constexpr int SampleRate = 44100;
+
+// Write FrameCount frames to outputFileName and return bytes written per second
+double writeFrames(const QString& outputFileName, const QSize& frameSize, Muxer::FileIO fileIO = Muxer::FileIO::AVIO)
+{
+    QAudioFormat audioFormat;
+    audioFormat.setSampleFormat(AudioSampleFormat_Qt);
+    audioFormat.setChannelConfig(AudioChannelLayout_Qt);
+    audioFormat.setSampleRate(SampleRate);
+    QAudioBuffer audioBuffer(audioFormat.framesForDuration(frameRateToFrameDuration<microseconds>(FrameRate).count()), audioFormat);
+
+    // Rendered frames are freshly allocated each frame, do the same here
+    std::vector<QByteArray> frames;
+    frames.reserve(FrameCount);
+    for (int i = 0; i < FrameCount; i++)
+        frames.emplace_back(static_cast<qsizetype>(frameSize.width()) * frameSize.height() * 4, static_cast<char>(i));
+
+    QElapsedTimer timer;
+    timer.start();
+    Muxer muxer(fileIO);
+    if (!muxer.open(outputFileName, frameSize, VideoPixelFormat_FFMPEG, FrameRate, SampleRate))
+        return 0;
+    qint64 bytes = 0;
+    for (auto& frame : frames) {
+        if (!muxer.write(audioBuffer, frame))
+            return 0;
+        bytes += frame.size() + audioBuffer.byteCount();
+        frame = QByteArray();
+    }
+    if (!muxer.finish())
+        return 0;
+    return static_cast<double>(bytes) / (static_cast<double>(timer.nsecsElapsed()) / 1e9);
+}
+
+}
+
+Q_DECLARE_METATYPE(Muxer::FileIO);
+
+class bench_Output : public QObject {
+    Q_OBJECT
+
+private slots:
+    void pipe_data()
+    {
+        QTest::addColumn<QSize>("frameSize");
+        QTest::addColumn<bool>("zeroCopy");
+
+        // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+        QTest::newRow("1080p buffered") << QSize(1920, 1080) << false;
+        QTest::newRow("1080p vmsplice") << QSize(1920, 1080) << true;
+        QTest::newRow("4K buffered") << QSize(3840, 2160) << false;
+        QTest::newRow("4K vmsplice") << QSize(3840, 2160) << true;
+        // NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+    }
+
+    void pipe()
+    {
+        QFETCH(QSize, frameSize);
+        QFETCH(bool, zeroCopy);
+
+        if (zeroCopy)
+            qunsetenv("MEDIAFX_BUFFERED_PIPE");
+        else
+            qputenv("MEDIAFX_BUFFERED_PIPE", "1");
+
+        std::array<int, 2> fds {};
+        QVERIFY(pipe2(fds.data(), O_CLOEXEC) == 0);
+
+        // Consumer drains the pipe as fast as it can, like ffmpeg reading raw frames
+        std::thread reader([fd = fds[0]]() {
+            std::vector<char> buffer(1024 * 1024); // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+            while (read(fd, buffer.data(), buffer.size()) > 0) { }
+            close(fd);
+        });
+
+        double bytesPerSecond = writeFrames(u"pipe:%1"_s.arg(fds[1]), frameSize);
+        close(fds[1]);
+        reader.join();
+        qunsetenv("MEDIAFX_BUFFERED_PIPE");
+
+        QVERIFY(bytesPerSecond > 0);
+        QTest::setBenchmarkResult(bytesPerSecond, QTest::BytesPerSecond);
+    }
+
+    void file_data()
+    {
+        QTest::addColumn<QSize>("frameSize");
+        QTest::addColumn<Muxer::FileIO>("fileIO");
+
+        // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+        QTest::newRow("1080p avio") << QSize(1920, 1080) << Muxer::FileIO::AVIO;
+        QTest::newRow("1080p uring") << QSize(1920, 1080) << Muxer::FileIO::Uring;
+        QTest::newRow("1080p uring-direct") << QSize(1920, 1080) << Muxer::FileIO::UringDirect;
+        QTest::newRow("4K avio") << QSize(3840, 2160) << Muxer::FileIO::AVIO;
+        QTest::newRow("4K uring") << QSize(3840, 2160) << Muxer::FileIO::Uring;
+        QTest::newRow("4K uring-direct") << QSize(3840, 2160) << Muxer::FileIO::UringDirect;
+        // NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+    }
+
+    void file()
+    {
+        QFETCH(QSize, frameSize);
+        QFETCH(Muxer::FileIO, fileIO);
+#ifndef MEDIAFX_ENABLE_IO_URING
+        if (fileIO != Muxer::FileIO::AVIO)
+            QSKIP("io_uring support not enabled");
+#endif
+
+        QTemporaryDir outputDir(QDir::current().filePath(u"bench_output-XXXXXX"_s));
+        QVERIFY(outputDir.isValid());
+
+        double bytesPerSecond = writeFrames(outputDir.filePath(u"output.nut"_s), frameSize, fileIO);
+
+        QVERIFY(bytesPerSecond > 0);
+        QTest::setBenchmarkResult(bytesPerSecond, QTest::BytesPerSecond);
+    }
+};
+
+QTEST_GUILESS_MAIN(bench_Output);
+#include "bench_output.moc"
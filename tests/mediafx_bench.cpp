@@ -0,0 +1,292 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Microbenchmarks of per frame hot paths, not run by ctest.
+// Run ./mediafx_bench --json results.json to also write the median and minimum time
+// per operation of each benchmark as JSON, for comparing against a previous run.
+
+#include "audio_renderer.h"
+#include "decoder.h"
+#include "encoder.h"
+#include "formats.h"
+#include "interval.h"
+#include "render_context.h"
+#include "util.h"
+#include "video_stream.h"
+#include <QAudioBuffer>
+#include <QAudioFormat>
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QIODevice>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QtCore>
+#include <QtLogging>
+#include <QtTest>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <ratio>
+#include <stdint.h>
+#include <vector>
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/rational.h>
+}
+using namespace std::chrono;
+using namespace Qt::Literals::StringLiterals;
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+namespace {
+
+constexpr int Samples = 11;
+constexpr AVRational FrameRate = { 30, 1 };
+constexpr int SampleRate = 44100;
+
+struct FreeAVFrame {
+    void operator()(AVFrame* frame) const { av_frame_free(&frame); }
+};
+
+volatile int64_t sink = 0; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+QJsonObject& results()
+{
+    static QJsonObject results;
+    return results;
+}
+
+QAudioFormat audioFormat()
+{
+    QAudioFormat format;
+    format.setSampleFormat(AudioSampleFormat_Qt);
+    format.setChannelConfig(AudioChannelLayout_Qt);
+    format.setSampleRate(SampleRate);
+    return format;
+}
+
+QAudioBuffer audioBuffer()
+{
+    QAudioFormat format = audioFormat();
+    QAudioBuffer buffer(format.framesForDuration(frameRateToFrameDuration<microseconds>(FrameRate).count()), format);
+    float* data = buffer.data<float>();
+    for (int i = 0; i < buffer.sampleCount(); i++)
+        data[i] = static_cast<float>(i % 100) / 100.0f; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return buffer;
+}
+
+// Runs batch once to warm up then Samples times, batch returns the number of operations it performed.
+// Records the median and minimum time per operation for the current test function and data row.
+template <typename Batch>
+bool measure(Batch&& batch)
+{
+    if (batch() <= 0)
+        return false;
+    std::vector<double> nsPerOperation;
+    int64_t operations = 0;
+    for (int i = 0; i < Samples; i++) {
+        auto start = steady_clock::now();
+        int64_t count = batch();
+        auto elapsed = steady_clock::now() - start;
+        if (count <= 0)
+            return false;
+        operations = count;
+        nsPerOperation.push_back(duration<double, std::nano>(elapsed).count() / static_cast<double>(count));
+    }
+    std::sort(nsPerOperation.begin(), nsPerOperation.end());
+    const double median = nsPerOperation[nsPerOperation.size() / 2];
+
+    QString name = QString::fromLatin1(QTest::currentTestFunction());
+    if (QTest::currentDataTag())
+        name += u"/"_s + QString::fromLatin1(QTest::currentDataTag());
+    results().insert(name, QJsonObject {
+                               { u"operations"_s, static_cast<qint64>(operations) },
+                               { u"medianNs"_s, median },
+                               { u"minNs"_s, nsPerOperation.front() },
+                           });
+    QTest::setBenchmarkResult(median, QTest::WalltimeNanoseconds);
+    return true;
+}
+
+}
+
+class bench_MediaFX : public QObject {
+    Q_OBJECT
+
+private slots:
+    void mix_data()
+    {
+        QTest::addColumn<int>("inputs");
+        QTest::addColumn<float>("volume");
+
+        for (int inputs : { 1, 2, 4, 8 }) {
+            for (float volume : { 1.0f, 0.5f, 0.0f })
+                QTest::addRow("%d inputs volume %.1f", inputs, volume) << inputs << volume;
+        }
+    }
+
+    void mix()
+    {
+        QFETCH(int, inputs);
+        QFETCH(float, volume);
+
+        AudioRenderer renderer;
+        renderer.setVolume(volume);
+        QList<QAudioBuffer> buffers;
+        for (int i = 0; i < inputs; i++)
+            buffers.append(audioBuffer());
+
+        QVERIFY(measure([&]() {
+            constexpr int Frames = 100;
+            for (int frame = 0; frame < Frames; frame++) {
+                for (const auto& buffer : buffers)
+                    renderer.addAudioBuffer(buffer);
+                sink = sink + renderer.mix().byteCount();
+            }
+            return Frames;
+        }));
+    }
+
+    void processFrame_data()
+    {
+        QTest::addColumn<QSize>("frameSize");
+
+        QTest::newRow("360p") << QSize(640, 360);
+        QTest::newRow("1080p") << QSize(1920, 1080);
+        QTest::newRow("4K") << QSize(3840, 2160);
+    }
+
+    void processFrame()
+    {
+        QFETCH(QSize, frameSize);
+
+        std::unique_ptr<AVFrame, FreeAVFrame> frame(av_frame_alloc());
+        QVERIFY(frame);
+        frame->format = VideoPixelFormat_FFMPEG;
+        frame->width = frameSize.width();
+        frame->height = frameSize.height();
+        QVERIFY(av_frame_get_buffer(frame.get(), 1) >= 0);
+
+        VideoStream stream(FrameRate, 0us);
+        QVERIFY(measure([&]() {
+            constexpr int Frames = 20;
+            for (int i = 0; i < Frames; i++) {
+                frame->pts = i;
+                stream.processFrame(frame.get());
+            }
+            return Frames;
+        }));
+    }
+
+    void encode_data()
+    {
+        QTest::addColumn<QSize>("frameSize");
+
+        QTest::newRow("360p") << QSize(640, 360);
+        QTest::newRow("1080p") << QSize(1920, 1080);
+    }
+
+    void encode()
+    {
+        QFETCH(QSize, frameSize);
+
+        // Muxes synchronously into a nut stream that is discarded
+        Encoder encoder;
+        encoder.setOutputFileName(u"/dev/null"_s);
+        encoder.setFrameSize(frameSize);
+        encoder.setFrameRate(Rational { FrameRate.num, FrameRate.den });
+        encoder.setSampleRate(SampleRate);
+        encoder.initialize();
+
+        QAudioBuffer buffer = audioBuffer();
+        QByteArray videoData(static_cast<qsizetype>(frameSize.width()) * frameSize.height() * 4, '\x80');
+        QVERIFY(measure([&]() {
+            constexpr int Frames = 30;
+            for (int i = 0; i < Frames; i++) {
+                if (!encoder.encode(buffer, videoData))
+                    return 0;
+            }
+            return Frames;
+        }));
+        QVERIFY(encoder.finish());
+    }
+
+    void decode_data()
+    {
+        QTest::addColumn<QString>("inputPath");
+
+        QDir assets(QFINDTESTDATA("fixtures/assets"));
+        const QStringList assetNames = assets.entryList({ u"*.nut"_s, u"*.mp4"_s, u"*.png"_s, u"*.jpg"_s }, QDir::Files, QDir::Name);
+        for (const auto& assetName : assetNames)
+            QTest::newRow(qPrintable(assetName)) << assets.filePath(assetName);
+    }
+
+    void decode()
+    {
+        QFETCH(QString, inputPath);
+
+        // Each operation is one output frame, including opening the asset
+        QVERIFY(measure([&]() {
+            Decoder decoder;
+            if (decoder.open(inputPath, FrameRate, audioFormat(), 0s) < 0)
+                return 0;
+            int frames = 0;
+            while (!decoder.isAudioEOF() || !decoder.isVideoEOF()) {
+                if (!decoder.decode())
+                    return 0;
+                frames++;
+            }
+            return frames;
+        }));
+    }
+
+    void interval()
+    {
+        QVERIFY(measure([&]() {
+            constexpr int Frames = 100000;
+            const auto frameDuration = frameRateToFrameDuration<microseconds>(FrameRate);
+            Interval<microseconds> interval(0us, frameDuration);
+            for (int frame = 1; frame <= Frames; frame++) {
+                interval = interval.nextInterval(duration_cast<microseconds>(frame * frameRateToFrameDuration(FrameRate)));
+                sink = sink + (interval.contains(interval.start() + frameDuration / 2) ? 1 : 0);
+            }
+            return Frames;
+        }));
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    QString jsonFileName;
+    if (qsizetype i = args.indexOf(u"--json"_s); i != -1 && i + 1 < args.size()) {
+        jsonFileName = args.at(i + 1);
+        args.remove(i, 2);
+    }
+
+    bench_MediaFX bench;
+    int result = QTest::qExec(&bench, args);
+
+    if (!jsonFileName.isEmpty()) {
+        QFile jsonFile(jsonFileName);
+        QByteArray json = QJsonDocument(QJsonObject { { u"benchmarks"_s, results() } }).toJson();
+        if (!jsonFile.open(QIODevice::WriteOnly | QIODevice::Truncate) || jsonFile.write(json) != json.size()) {
+            qCritical() << "Could not write" << jsonFileName;
+            return 1;
+        }
+    }
+    return result;
+}
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+
+#include "mediafx_bench.moc"
@@ -0,0 +1,15 @@
+#!/usr/bin/env bash
+# Copyright (C) 2024 Andrew Wason
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+usage="$0 <pipelinecache-dir>"
+
+# Checks tst_qml_pipelinecache_cold saved a pipeline cache and tst_qml_pipelinecache_warm loaded it.
+# Both render into <pipelinecache-dir>/cache and write their reports alongside it.
+
+PIPELINECACHE=${1:?$usage}
+
+compgen -G "${PIPELINECACHE}/cache/*.pipelinecache" > /dev/null || { echo "No pipeline cache saved in ${PIPELINECACHE}/cache"; exit 1; }
+grep -Eq '"pipelineCacheLoadedBytes": 0,?$' "${PIPELINECACHE}/cold.json" || { echo "Cold run loaded a pipeline cache"; exit 1; }
+grep -Eq '"pipelineCacheLoadedBytes": [1-9]' "${PIPELINECACHE}/warm.json" || { echo "Warm run did not load the pipeline cache"; exit 1; }
+exit 0
@@ -0,0 +1,99 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import QtQuick
+import MediaFX
+import MediaFX.Transition as T
+
+// Checks the transitions of sequence sample hidden, untransformed VideoRenderers that fill their container
+// directly with a VideoTexture, and render anything else into a ShaderEffectSource layer.
+// expected optionally lists [sourceDirect, destDirect] for each transition in order.
+Item {
+    id: root
+
+    required property MediaSequence sequence
+    property var expected: []
+    property int transitionCount: 0
+    property var sides: []
+
+    function findEffect(item: Item): Item {
+        for (const child of item.children) {
+            if (child instanceof T.TransitionShaderEffect)
+                return child;
+            const effect = root.findEffect(child);
+            if (effect)
+                return effect;
+        }
+        return null;
+    }
+
+    function expectDirect(container: Item): bool {
+        if (!container || container.visible || container.children.length !== 1)
+            return false;
+        const renderer = container.children[0];
+        return renderer.transform.length === 0 && Math.abs(renderer.contentRect.width - renderer.width) < 1 && Math.abs(renderer.contentRect.height - renderer.height) < 1;
+    }
+
+    function beginTransition() {
+        const effect = root.sequence.currentTransition ? root.findEffect(root.sequence.currentTransition) : null;
+        root.sides = effect ? [
+            {
+                "name": "source",
+                "effect": effect,
+                "item": effect.sourceItem,
+                "expected": false,
+                "direct": false
+            },
+            {
+                "name": "dest",
+                "effect": effect,
+                "item": effect.destItem,
+                "expected": false,
+                "direct": false
+            }
+        ] : [];
+    }
+
+    function checkFrame() {
+        for (const side of root.sides) {
+            side.expected = root.expectDirect(side.item);
+            const direct = side.effect[side.name] instanceof VideoTexture;
+            if (!direct && !(side.effect[side.name] instanceof ShaderEffectSource))
+                console.warn("Transition", side.name, "is neither a VideoTexture nor a ShaderEffectSource");
+            if (direct && !side.expected)
+                console.warn("Transition", side.name, "sampled directly, it must be layered");
+            side.direct = side.direct || direct;
+        }
+    }
+
+    function endTransition() {
+        if (root.sides.length === 0)
+            return;
+        // The dest may have no frame yet when the transition begins, so it only has to be direct by the end
+        for (const side of root.sides) {
+            if (side.expected && !side.direct)
+                console.warn("Transition", root.transitionCount, side.name, "was layered, it can be sampled directly");
+        }
+        const expected = root.expected[root.transitionCount];
+        if (expected && (expected[0] !== root.sides[0].direct || expected[1] !== root.sides[1].direct))
+            console.warn("Transition", root.transitionCount, "direct", root.sides[0].direct, root.sides[1].direct, "expected", expected[0], expected[1]);
+        root.transitionCount++;
+        root.sides = [];
+    }
+
+    Connections {
+        function onCurrentTransitionChanged() {
+            root.endTransition();
+            root.beginTransition();
+        }
+
+        target: root.sequence
+    }
+    Connections {
+        function onCurrentRenderTimeChanged() {
+            root.checkFrame();
+        }
+
+        target: root.RenderSession.session
+    }
+}
@@ -0,0 +1,67 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import QtQuick
+import QtQuick.Layouts
+import MediaFX
+
+// multisink.qml with the still image played by an ImageClip decoded on a worker thread,
+// so it must match the multisink fixture. Its frames are timed from startTime like any clip.
+Item {
+    id: root
+
+    MediaClip {
+        id: videoClip
+
+        startTime: 3000
+        source: Qt.resolvedUrl("../fixtures/assets/red-640x360-30fps-4s-rms44100.nut")
+
+        Component.onCompleted: {
+            videoClip.clipEnded.connect(root.RenderSession.session.endSession);
+        }
+    }
+    ImageClip {
+        id: imageClip
+
+        asynchronous: true
+        startTime: 1000
+        endTime: 4000
+        source: Qt.resolvedUrl("../fixtures/assets/red-160x120.png")
+
+        Component.onCompleted: {
+            if (imageClip.duration !== 3000)
+                console.warn("ImageClip duration", imageClip.duration);
+        }
+        onCurrentFrameTimeChanged: {
+            if (!imageClip.currentFrameTime.containedBy(1000, 4000))
+                console.warn("ImageClip frame outside its interval", imageClip.currentFrameTime.start);
+        }
+    }
+    RowLayout {
+        id: layout
+
+        anchors.fill: parent
+        spacing: 0
+
+        VideoRenderer {
+            Layout.fillHeight: true
+            Layout.fillWidth: true
+            Layout.rowSpan: 2
+            mediaClip: imageClip
+        }
+        ColumnLayout {
+            spacing: 0
+
+            VideoRenderer {
+                Layout.fillHeight: true
+                Layout.preferredWidth: root.width * 0.75
+                mediaClip: videoClip
+            }
+            VideoRenderer {
+                Layout.fillHeight: true
+                Layout.preferredWidth: root.width * 0.75
+                mediaClip: videoClip
+            }
+        }
+    }
+}
@@ -0,0 +1,91 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import QtQuick
+import QtQuick.Layouts
+import MediaFX
+
+// multisink.qml rendered with VideoItems, so it must match the multisink fixture.
+// Hidden VideoItems also switch clips and outlive a destroyed clip without affecting the output.
+Item {
+    id: root
+
+    property MediaClip orphanClip: orphanClipComponent.createObject(root)
+
+    MediaClip {
+        id: videoClip
+
+        startTime: 3000
+        source: Qt.resolvedUrl("../fixtures/assets/red-640x360-30fps-4s-rms44100.nut")
+
+        Component.onCompleted: {
+            videoClip.clipEnded.connect(root.RenderSession.session.endSession);
+        }
+        onCurrentFrameTimeChanged: {
+            if (videoClip.currentFrameTime.contains(3300)) {
+                switchingItem.mediaClip = videoClip;
+                root.orphanClip.destroy();
+            } else if (videoClip.currentFrameTime.contains(3600)) {
+                if (switchingItem.mediaClip !== videoClip)
+                    console.warn("VideoItem did not switch clips");
+                if (orphanItem.mediaClip !== null)
+                    console.warn("VideoItem still references a destroyed clip");
+            }
+        }
+    }
+    MediaClip {
+        id: imageClip
+
+        endTime: 3000
+        source: Qt.resolvedUrl("../fixtures/assets/red-160x120.png")
+    }
+    Component {
+        id: orphanClipComponent
+
+        MediaClip {
+            endTime: 3000
+            source: Qt.resolvedUrl("../fixtures/assets/red-160x120.png")
+        }
+    }
+    RowLayout {
+        id: layout
+
+        anchors.fill: parent
+        spacing: 0
+
+        VideoItem {
+            Layout.fillHeight: true
+            Layout.fillWidth: true
+            Layout.rowSpan: 2
+            mediaClip: imageClip
+        }
+        ColumnLayout {
+            spacing: 0
+
+            VideoItem {
+                Layout.fillHeight: true
+                Layout.preferredWidth: root.width * 0.75
+                mediaClip: videoClip
+            }
+            VideoItem {
+                Layout.fillHeight: true
+                Layout.preferredWidth: root.width * 0.75
+                mediaClip: videoClip
+            }
+        }
+    }
+    VideoItem {
+        id: switchingItem
+
+        anchors.fill: parent
+        opacity: 0
+        mediaClip: imageClip
+    }
+    VideoItem {
+        id: orphanItem
+
+        anchors.fill: parent
+        opacity: 0
+        mediaClip: root.orphanClip
+    }
+}
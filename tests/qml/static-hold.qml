@@ -0,0 +1,36 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import QtQuick
+import MediaFX
+
+// A title card held for 2 seconds, nothing changes after the first frame.
+// forceRender moves an invisible item every frame so no frame can be skipped, the output must not change.
+Rectangle {
+    id: root
+
+    property bool forceRender: false
+
+    color: "red"
+
+    Connections {
+        function onCurrentRenderTimeChanged() {
+            if (root.RenderSession.session.currentRenderTime.start >= 2000)
+                root.RenderSession.session.endSession();
+        }
+
+        target: root.RenderSession.session
+    }
+    Rectangle {
+        anchors.centerIn: parent
+        width: parent.width / 2
+        height: parent.height / 2
+        color: "blue"
+    }
+    Rectangle {
+        width: 10
+        height: 10
+        color: "transparent"
+        rotation: root.forceRender ? root.RenderSession.session.currentRenderTime.start : 0
+    }
+}
@@ -0,0 +1,19 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import QtQuick
+import MediaFX
+
+// gl-transitions.qml checking which transitions sample their clips directly, so it must match the gl-transitions fixture.
+// GL transitions sample without mirroring, so directly sampled frames are uploaded upside down.
+Item {
+    Loader {
+        id: loader
+
+        source: "gl-transitions.qml"
+        anchors.fill: parent
+    }
+    VideoTextureCheck {
+        sequence: loader.item ? loader.item.children[0] : null
+    }
+}
@@ -0,0 +1,57 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import QtQuick
+import MediaFX
+
+// sequence.qml checking which transitions sample their clips directly, so it must match the sequence fixture.
+Item {
+    id: root
+
+    Loader {
+        id: loader
+
+        source: "sequence.qml"
+        anchors.fill: parent
+    }
+    VideoTextureCheck {
+        sequence: loader.item
+        // CrossFade and Wipe between 320x180 clips, then wipes to and from the letterboxed 160x120 image
+        expected: [[true, true], [true, true], [true, false], [false, true]]
+    }
+    MediaClip {
+        id: probeClip
+
+        endTime: 2000
+        source: Qt.resolvedUrl("../fixtures/assets/blue-320x180-30fps-3s-awb44100.nut")
+    }
+    // Transparent, so it does not change the output but is still visible
+    VideoRenderer {
+        id: probeRenderer
+
+        mediaClip: probeClip
+        opacity: 0
+        anchors.fill: parent
+    }
+    VideoTexture {
+        id: probeTexture
+
+        sourceItem: probeRenderer
+        visible: false
+        anchors.fill: parent
+    }
+    Connections {
+        function onCurrentRenderTimeChanged() {
+            // A visible source would still be rendered, so it must be layered and hidden
+            const start = root.RenderSession.session.currentRenderTime.start;
+            if (start >= 500 && start < 1000 && probeTexture.direct)
+                console.warn("VideoTexture sampled a visible VideoRenderer directly");
+            else if (start >= 1000 && start < 1500)
+                probeRenderer.visible = false;
+            else if (start >= 1500 && start < 2000 && !probeTexture.direct)
+                console.warn("VideoTexture did not sample a hidden VideoRenderer directly");
+        }
+
+        target: root.RenderSession.session
+    }
+}
@@ -0,0 +1,19 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import QtQuick
+import MediaFX
+
+// transformer.qml checking transformed clips are layered, so it must match the transformer fixture.
+Item {
+    Loader {
+        id: loader
+
+        source: "transformer.qml"
+        anchors.fill: parent
+    }
+    VideoTextureCheck {
+        sequence: loader.item ? loader.item.children[0] : null
+        expected: [[false, false]]
+    }
+}
@@ -4,7 +4,7 @@
 
 set -o pipefail
 
-usage="$0 <mediafxpath> <framerate>:<WxH> <qml-file> <output-file> <threshold>"
+usage="$0 <mediafxpath> <framerate>:<WxH> <qml-file> <output-file> <threshold> [encoder-options...]"
 
 BASE=${BASH_SOURCE%/*}
 
@@ -26,7 +26,7 @@ shift
 
 echo Testing ${QML}
 export QT_LOGGING_RULES="qt.qml.binding.removal.info=true"
-"${MEDIAFX}" encoder --exitOnWarning --fps ${FRAMERATE} --size ${SIZE} "${QML}" - | ffmpeg -hide_banner -f nut -i - -f nut -codec:v libx264 -preset veryslow -qp 0 -codec:a wavpack -y "${OUTPUT}" || exit 1
+"${MEDIAFX}" encoder --exitOnWarning --fps ${FRAMERATE} --size ${SIZE} "$@" "${QML}" - | ffmpeg -hide_banner -f nut -i - -f nut -codec:v libx264 -preset veryslow -qp 0 -codec:a wavpack -y "${OUTPUT}" || exit 1
 
 "${BASE}/../tools/framehash.sh" "${OUTPUT}" > "${OUTPUT}.framehash" || exit 1
 
@@ -1,27 +1,35 @@
 // Copyright (C) 2024 Andrew Wason
 // SPDX-License-Identifier: GPL-3.0-or-later
 
+#include "decode_queue.h"
 #include "decoder.h"
 #include "formats.h"
+#include "memory_accounting.h"
 #include <QAudioBuffer>
 #include <QAudioFormat>
+#include <QByteArray>
 #include <QDataStream>
+#include <QDateTime>
 #include <QDebug>
 #include <QFile>
 #include <QFileDevice>
 #include <QIODeviceBase>
 #include <QObject>
 #include <QString>
+#include <QTemporaryDir>
 #include <QTestData>
 #include <QVideoFrame>
 #include <QtLogging>
 #include <QtTest>
 #include <chrono>
 #include <memory>
+#include <optional>
+#include <stdint.h>
 extern "C" {
 #include <libavutil/rational.h>
 }
 using namespace std::chrono_literals;
+using namespace Qt::Literals::StringLiterals;
 
 // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
 
@@ -128,6 +136,139 @@ private slots:
         QCOMPARE(audioFrames, audioFrameCount);
         QCOMPARE(videoFrames, videoFrameCount);
     }
+
+    void decodeQueue()
+    {
+        QString inputPath = QFINDTESTDATA("fixtures/assets/red-320x180-15fps-8s-kal1624000.nut");
+        QAudioFormat audioFormat;
+        audioFormat.setSampleFormat(AudioSampleFormat_Qt);
+        audioFormat.setChannelConfig(AudioChannelLayout_Qt);
+        audioFormat.setSampleRate(44100);
+
+        Decoder decoder;
+        connect(&decoder, &Decoder::errorMessage, this, &tst_Decoder::onDecoderError);
+        QVERIFY(decoder.open(inputPath, AVRational { 15, 1 }, audioFormat, 0s) >= 0);
+        Decoder queuedDecoder;
+        connect(&queuedDecoder, &Decoder::errorMessage, this, &tst_Decoder::onDecoderError);
+        QVERIFY(queuedDecoder.open(inputPath, AVRational { 15, 1 }, audioFormat, 0s) >= 0);
+        DecodeQueue queue(&queuedDecoder, 3);
+
+        auto videoBytes = [](QVideoFrame videoFrame) {
+            videoFrame.map(QVideoFrame::ReadOnly);
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            QByteArray bytes(reinterpret_cast<const char*>(videoFrame.bits(0)), videoFrame.mappedBytes(0));
+            videoFrame.unmap();
+            return bytes;
+        };
+        auto audioBytes = [](const QAudioBuffer& audioBuffer) {
+            if (!audioBuffer.isValid())
+                return QByteArray();
+            return QByteArray(audioBuffer.constData<char>(), audioBuffer.byteCount());
+        };
+
+        // Queued frames must match decoding directly, including past EOF
+        for (int i = 0; i < 130; i++) {
+            QVERIFY(decoder.decode());
+            std::optional<DecodeQueue::Frame> frame = queue.pop();
+            QVERIFY(frame);
+            QCOMPARE(videoBytes(frame->videoFrame), videoBytes(decoder.outputVideoFrame()));
+            QCOMPARE(audioBytes(frame->audioBuffer), audioBytes(decoder.outputAudioBuffer()));
+        }
+    }
+
+    void memoryAccounting()
+    {
+        QString inputPath = QFINDTESTDATA("fixtures/assets/bbbjumprope-320x180-15fps-5.5s-44100.nut");
+        QAudioFormat audioFormat;
+        audioFormat.setSampleFormat(AudioSampleFormat_Qt);
+        audioFormat.setChannelConfig(AudioChannelLayout_Qt);
+        audioFormat.setSampleRate(44100);
+
+        MemoryAccounting::Account* account = MemoryAccounting::clipAccount(inputPath);
+        const int64_t sessionLiveBytes = MemoryAccounting::session().liveBytes();
+        {
+            Decoder decoder;
+            connect(&decoder, &Decoder::errorMessage, this, &tst_Decoder::onDecoderError);
+            QVERIFY(decoder.open(inputPath, AVRational { 15, 1 }, audioFormat, 0s) >= 0);
+            // The decoder's own account adds to the source account
+            QVERIFY(decoder.memoryAccount() && decoder.memoryAccount() != account);
+            {
+                DecodeQueue queue(&decoder, 2);
+                for (int i = 0; i < 10; i++)
+                    QVERIFY(queue.pop());
+            }
+            QVERIFY(account->liveBytes(MemoryAccounting::Category::CodecFrames) > 0);
+            QCOMPARE(decoder.memoryAccount()->liveBytes(MemoryAccounting::Category::CodecFrames), account->liveBytes(MemoryAccounting::Category::CodecFrames));
+            QVERIFY(account->liveBytes(MemoryAccounting::Category::VideoFrames) >= int64_t(320 * 180 * 4));
+            QVERIFY(account->liveBytes(MemoryAccounting::Category::AudioBuffers) > 0);
+            QVERIFY(account->peakBytes(MemoryAccounting::Category::Packets) > 0);
+            QVERIFY(account->peakBytes(MemoryAccounting::Category::FilterFrames) > 0);
+            QVERIFY(MemoryAccounting::session().liveBytes() > sessionLiveBytes);
+        }
+        // Everything is released with the decoder
+        QCOMPARE(account->liveBytes(), int64_t(0));
+        QCOMPARE(MemoryAccounting::session().liveBytes(), sessionLiveBytes);
+        QVERIFY(account->peakBytes() > 0);
+    }
+
+    void probeDuration_data()
+    {
+        QTest::addColumn<QString>("inputPath");
+
+        QTest::newRow("red-320x180-15fps-8s-kal1624000.nut") << QFINDTESTDATA("fixtures/assets/red-320x180-15fps-8s-kal1624000.nut");
+        QTest::newRow("red-160x120.png") << QFINDTESTDATA("fixtures/assets/red-160x120.png");
+    }
+
+    void probeDuration()
+    {
+        QFETCH(QString, inputPath);
+
+        QAudioFormat audioFormat;
+        audioFormat.setSampleFormat(AudioSampleFormat_Qt);
+        audioFormat.setChannelConfig(AudioChannelLayout_Qt);
+        audioFormat.setSampleRate(44100);
+
+        Decoder decoder;
+        connect(&decoder, &Decoder::errorMessage, this, &tst_Decoder::onDecoderError);
+        QVERIFY(decoder.open(inputPath, AVRational { 30, 1 }, audioFormat, 0s) >= 0);
+        // Same duration as an opened decoder
+        QCOMPARE(Decoder::probeDuration(inputPath).count(), decoder.duration().count());
+        // Served from the probe cache
+        QCOMPARE(Decoder::probeDuration(inputPath).count(), decoder.duration().count());
+        QVERIFY(Decoder::probeDuration(u"/nonexistent.nut"_s) < 0us);
+    }
+
+    void probeDurationCache()
+    {
+        QTemporaryDir tempDir;
+        QVERIFY(tempDir.isValid());
+        const QString inputPath = tempDir.filePath(u"probe.nut"_s);
+        QVERIFY(QFile::copy(QFINDTESTDATA("fixtures/assets/red-320x180-15fps-8s-kal1624000.nut"), inputPath));
+        const microseconds duration = Decoder::probeDuration(inputPath);
+        QVERIFY(duration > 0us);
+
+        QFile file(inputPath);
+        QVERIFY(file.open(QIODeviceBase::ReadWrite));
+        const QDateTime lastModified = file.fileTime(QFileDevice::FileModificationTime);
+        // Garbage of the same size and modification time is not reprobed
+        file.write(QByteArray(file.size(), '\0'));
+        QVERIFY(file.setFileTime(lastModified, QFileDevice::FileModificationTime));
+        file.close();
+        QCOMPARE(Decoder::probeDuration(inputPath).count(), duration.count());
+
+        // Modifying it invalidates the cached duration
+        QVERIFY(file.open(QIODeviceBase::ReadWrite));
+        QVERIFY(file.setFileTime(lastModified.addSecs(10), QFileDevice::FileModificationTime));
+        file.close();
+        QVERIFY(Decoder::probeDuration(inputPath) != duration);
+
+        // And a different source at the same path is probed again
+        QVERIFY(QFile::remove(inputPath));
+        QVERIFY(QFile::copy(QFINDTESTDATA("fixtures/assets/bbbjumprope-320x180-15fps-5.5s-44100.nut"), inputPath));
+        const microseconds replacedDuration = Decoder::probeDuration(inputPath);
+        QVERIFY(replacedDuration > 0us);
+        QVERIFY(replacedDuration != duration);
+    }
 };
 
 // NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
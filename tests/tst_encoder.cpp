@@ -3,6 +3,8 @@
 
 #include "encoder.h"
 #include "render_context.h"
+#include "rendition.h"
+#include "segmented_muxer.h"
 #include "util.h"
 #include <QAudioBuffer>
 #include <QAudioFormat>
@@ -16,6 +18,7 @@
 #include <QSize>
 #include <QString>
 #include <QSysInfo>
+#include <QTemporaryDir>
 #include <QtCore>
 #include <QtTest>
 #include <chrono>
@@ -36,9 +39,111 @@ private slots:
         QCOMPARE(frameRateToFrameDuration<microseconds>(AVRational { 30, 1 }), 33333us);
     }
 
+    void rendition_data()
+    {
+        QTest::addColumn<QString>("spec");
+        QTest::addColumn<bool>("isValid");
+        QTest::addColumn<QSize>("frameSize");
+        QTest::addColumn<QString>("pixelFormat");
+        QTest::addColumn<QString>("outputFileName");
+
+        // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+        QTest::newRow("default format") << "640x360:out.nut" << true << QSize(640, 360) << "rgba" << "out.nut";
+        QTest::newRow("bgra") << "320x180:bgra:out.nut" << true << QSize(320, 180) << "bgra" << "out.nut";
+        QTest::newRow("stdout") << "hd720:-" << true << QSize(1280, 720) << "rgba" << "pipe:";
+        QTest::newRow("unsupported format") << "640x360:yuv420p:out.nut" << false << QSize() << "" << "";
+        QTest::newRow("colon in path") << "640x360:dir:out.nut" << true << QSize(640, 360) << "rgba" << "dir:out.nut";
+        QTest::newRow("format-like path") << "640x360:./yuv420p:out.nut" << true << QSize(640, 360) << "rgba" << "./yuv420p:out.nut";
+        QTest::newRow("bad size") << "foo:out.nut" << false << QSize() << "" << "";
+        QTest::newRow("no path") << "640x360:" << false << QSize() << "" << "";
+        // NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+    }
+
+    void rendition()
+    {
+        QFETCH(QString, spec);
+        QFETCH(bool, isValid);
+        QFETCH(QSize, frameSize);
+        QFETCH(QString, pixelFormat);
+        QFETCH(QString, outputFileName);
+
+        auto rendition = Rendition::fromString(spec);
+        QCOMPARE(rendition.has_value(), isValid);
+        if (rendition) {
+            QCOMPARE(rendition->frameSize(), frameSize);
+            QCOMPARE(rendition->pixelFormat(), pixelFormat);
+            QCOMPARE(rendition->outputFileName(), outputFileName);
+        }
+    }
+
+    void segmented()
+    {
+        // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+        QTemporaryDir outputDir;
+        QVERIFY(outputDir.isValid());
+        QString manifestFileName = outputDir.filePath("manifest.ffconcat");
+
+        Encoder encoder;
+        QSignalSpy spy(&encoder, SIGNAL(encodingError()));
+        QVERIFY(spy.isValid());
+        encoder.setOutputFileName(outputDir.filePath("segment-%03d.nut"));
+        encoder.setFrameSize(QSize(32, 16));
+        encoder.setFrameRate(Rational { 5, 1 });
+        encoder.setSegmentFrames(4);
+        encoder.setManifestFileName(manifestFileName);
+        encoder.initialize();
+        QVERIFY(spy.empty());
+
+        QAudioFormat audioFormat;
+        audioFormat.setSampleFormat(QAudioFormat::Float);
+        audioFormat.setChannelConfig(QAudioFormat::ChannelConfigStereo);
+        audioFormat.setSampleRate(encoder.sampleRate());
+        QAudioBuffer audioBuffer(audioFormat.framesForDuration(frameRateToFrameDuration<microseconds>(encoder.frameRate()).count()), audioFormat);
+        QByteArray videoData(static_cast<qsizetype>(encoder.frameSize().width() * encoder.frameSize().height() * 4), 0);
+
+        auto readManifest = [&manifestFileName]() {
+            QFile manifest(manifestFileName);
+            if (!manifest.open(QIODevice::ReadOnly))
+                return QByteArray();
+            return manifest.readAll();
+        };
+
+        for (int i = 0; i < 10; i++) {
+            QVERIFY(encoder.encode(audioBuffer, videoData));
+            // First segment is published once the fifth frame starts the second segment
+            if (i == 3)
+                QCOMPARE(readManifest(), QByteArray("ffconcat version 1.0\n"));
+            if (i == 4)
+                QCOMPARE(readManifest(), QByteArray("ffconcat version 1.0\nfile 'segment-000.nut'\nduration 0.800000\n"));
+        }
+        QVERIFY(encoder.finish());
+        QVERIFY(spy.empty());
+
+        QCOMPARE(readManifest(), QByteArray("ffconcat version 1.0\n"
+                                            "file 'segment-000.nut'\nduration 0.800000\n"
+                                            "file 'segment-001.nut'\nduration 0.800000\n"
+                                            "file 'segment-002.nut'\nduration 0.400000\n"
+                                            "# complete\n"));
+        QVERIFY(QFile::exists(outputDir.filePath("segment-002.nut")));
+        QVERIFY(!QFile::exists(outputDir.filePath("segment-003.nut")));
+        QVERIFY(!SegmentedMuxer::isValidPattern("segment.nut"));
+        // NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+    }
+
+    void encode_data()
+    {
+        QTest::addColumn<int>("pipelineDepth");
+
+        // Output must be identical whether muxed inline or on the write thread
+        QTest::newRow("serial") << 0;
+        QTest::newRow("pipelined") << 3;
+    }
+
     void encode()
     {
         // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+        QFETCH(int, pipelineDepth);
+
         QString uname(QSysInfo::kernelType());
         uname.replace(0, 1, uname[0].toUpper());
         QDir outputDir(QFINDTESTDATA("../"));
@@ -55,6 +160,7 @@ private slots:
         encoder.setFrameSize(QSize(160, 120));
         encoder.setFrameRate(Rational { 5, 1 });
         encoder.setSampleRate(44100);
+        encoder.setPipelineDepth(pipelineDepth);
         encoder.initialize();
         QVERIFY(spy.empty());
 
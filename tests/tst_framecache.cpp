@@ -0,0 +1,144 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "frame_cache.h"
+#include <QAudioBuffer>
+#include <QAudioFormat>
+#include <QDateTime>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QVideoFrame>
+#include <QVideoFrameFormat>
+#include <QtTest>
+#include <chrono>
+#include <stdint.h>
+using namespace Qt::Literals::StringLiterals;
+using namespace std::chrono_literals;
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+class tst_FrameCache : public QObject {
+    Q_OBJECT
+
+private:
+    // 10x10 RGBA, 400 bytes
+    static QVideoFrame videoFrame()
+    {
+        return QVideoFrame(QVideoFrameFormat(QSize(10, 10), QVideoFrameFormat::Format_RGBA8888));
+    }
+
+    static FrameCache::Key key(const QString& sourceFile)
+    {
+        return FrameCache::Key { sourceFile, QDateTime::fromSecsSinceEpoch(0), 1000, 0us, { 30, 1 }, 44100 };
+    }
+
+    // Records and inserts a clip of frameCount frames
+    static void record(const FrameCache::Key& key, int frameCount, const microseconds& endTime)
+    {
+        FrameCache::Recorder recorder(key, true, false);
+        for (int i = 0; i < frameCount; ++i)
+            QVERIFY(recorder.add(videoFrame(), QAudioBuffer(), false));
+        recorder.finish(endTime);
+    }
+
+private slots:
+    void init()
+    {
+        FrameCache::clear();
+        FrameCache::setCapacity(2000);
+    }
+
+    void cleanupTestCase()
+    {
+        FrameCache::setCapacity(0);
+    }
+
+    void findRecorded()
+    {
+        record(key(u"/tmp/a.mp4"_s), 3, 100ms);
+        QCOMPARE(FrameCache::size(), int64_t(1200));
+
+        auto clip = FrameCache::find(key(u"/tmp/a.mp4"_s), 100ms);
+        QVERIFY(clip);
+        QVERIFY(clip->hasVideo);
+        QVERIFY(!clip->hasAudio);
+        QCOMPARE(clip->frames.size(), size_t(3));
+        // A shorter range is played from the longer clip, a longer range is not cached
+        QVERIFY(FrameCache::find(key(u"/tmp/a.mp4"_s), 50ms));
+        QVERIFY(!FrameCache::find(key(u"/tmp/a.mp4"_s), 200ms));
+
+        // Any change to the key is a different clip
+        FrameCache::Key modified = key(u"/tmp/a.mp4"_s);
+        modified.lastModified = QDateTime::fromSecsSinceEpoch(1);
+        QVERIFY(!FrameCache::find(modified, 100ms));
+        FrameCache::Key startTime = key(u"/tmp/a.mp4"_s);
+        startTime.startTime = 1s;
+        QVERIFY(!FrameCache::find(startTime, 100ms));
+    }
+
+    void recorderCapacity()
+    {
+        FrameCache::Recorder recorder(key(u"/tmp/a.mp4"_s), true, false);
+        for (int i = 0; i < 5; ++i)
+            QVERIFY(recorder.add(videoFrame(), QAudioBuffer(), false));
+        // 2400 bytes will not fit
+        QVERIFY(!recorder.add(videoFrame(), QAudioBuffer(), false));
+        recorder.finish(100ms);
+        QVERIFY(!FrameCache::find(key(u"/tmp/a.mp4"_s), 100ms));
+        QCOMPARE(FrameCache::size(), int64_t(0));
+    }
+
+    void evictLeastRecentlyUsed()
+    {
+        record(key(u"/tmp/a.mp4"_s), 2, 100ms);
+        record(key(u"/tmp/b.mp4"_s), 2, 100ms);
+        // a is now more recently used than b
+        QVERIFY(FrameCache::find(key(u"/tmp/a.mp4"_s), 100ms));
+        record(key(u"/tmp/c.mp4"_s), 2, 100ms);
+        QCOMPARE(FrameCache::size(), int64_t(1600));
+        QVERIFY(FrameCache::find(key(u"/tmp/a.mp4"_s), 100ms));
+        QVERIFY(!FrameCache::find(key(u"/tmp/b.mp4"_s), 100ms));
+        QVERIFY(FrameCache::find(key(u"/tmp/c.mp4"_s), 100ms));
+
+        QCOMPARE(FrameCache::evict(1), int64_t(800));
+        QCOMPARE(FrameCache::size(), int64_t(800));
+        QVERIFY(!FrameCache::find(key(u"/tmp/a.mp4"_s), 100ms));
+    }
+
+    void evictedWhilePlaying()
+    {
+        record(key(u"/tmp/a.mp4"_s), 2, 100ms);
+        auto clip = FrameCache::find(key(u"/tmp/a.mp4"_s), 100ms);
+        FrameCache::clear();
+        // Frames stay valid until released
+        QCOMPARE(clip->frames.size(), size_t(2));
+        QVERIFY(clip->frames.front().videoFrame.isValid());
+    }
+
+    void replaceShorter()
+    {
+        record(key(u"/tmp/a.mp4"_s), 1, 50ms);
+        record(key(u"/tmp/a.mp4"_s), 2, 100ms);
+        QCOMPARE(FrameCache::find(key(u"/tmp/a.mp4"_s), 50ms)->frames.size(), size_t(2));
+        // A shorter recording does not replace a longer one
+        record(key(u"/tmp/a.mp4"_s), 1, 50ms);
+        QCOMPARE(FrameCache::find(key(u"/tmp/a.mp4"_s), 50ms)->frames.size(), size_t(2));
+        QCOMPARE(FrameCache::size(), int64_t(800));
+    }
+
+    void disabled()
+    {
+        FrameCache::setCapacity(0);
+        QVERIFY(!FrameCache::isEnabled());
+        // Nothing fits
+        FrameCache::Recorder recorder(key(u"/tmp/a.mp4"_s), true, false);
+        QVERIFY(!recorder.add(videoFrame(), QAudioBuffer(), false));
+        QVERIFY(!FrameCache::key(u"/nonexistent/a.mp4"_s, 0us, { 30, 1 }, {}));
+    }
+};
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+
+QTEST_APPLESS_MAIN(tst_FrameCache);
+#include "tst_framecache.moc"
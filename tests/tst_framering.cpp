@@ -0,0 +1,159 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "formats.h"
+#include "frame_ring.h"
+#include "util.h"
+#include <QAudioBuffer>
+#include <QAudioFormat>
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QtCore>
+#include <QtTest>
+#include <chrono>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+extern "C" {
+#include <libavutil/rational.h>
+}
+using namespace std::chrono;
+using namespace Qt::Literals::StringLiterals;
+
+class tst_FrameRing : public QObject {
+    Q_OBJECT
+
+private slots:
+    void sharedMemoryName()
+    {
+        QCOMPARE(FrameRingWriter::sharedMemoryName(u"shm:mediafx"_s), u"/mediafx"_s);
+        QVERIFY(FrameRingWriter::sharedMemoryName(u"shm:"_s).isEmpty());
+        QVERIFY(FrameRingWriter::sharedMemoryName(u"output.nut"_s).isEmpty());
+    }
+
+    void readWrite()
+    {
+        // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+        const QString name = u"/tst_framering_%1"_s.arg(QCoreApplication::applicationPid());
+        const QSize frameSize(64, 32);
+        const AVRational frameRate { 30, 1 };
+        const int sampleRate = 44100;
+        const int frameCount = 10;
+
+        // Ring smaller than the frame count so the writer has to wait for the reader
+        FrameRingWriter writer(name, 2);
+        QVERIFY(writer.open(frameSize, VideoPixelFormat_FFMPEG, frameRate, sampleRate));
+
+        QAudioFormat audioFormat;
+        audioFormat.setSampleFormat(AudioSampleFormat_Qt);
+        audioFormat.setChannelConfig(AudioChannelLayout_Qt);
+        audioFormat.setSampleRate(sampleRate);
+        const int audioFrameCount = audioFormat.framesForDuration(frameRateToFrameDuration<microseconds>(frameRate).count());
+
+        FrameRingReader reader(name);
+        QVERIFY(reader.open());
+        QCOMPARE(reader.frameSize(), frameSize);
+        QCOMPARE(reader.pixelFormat(), VideoPixelFormat_FFMPEG);
+        QCOMPARE(reader.frameRate().num, frameRate.num);
+        QCOMPARE(reader.frameRate().den, frameRate.den);
+        QCOMPARE(reader.sampleRate(), sampleRate);
+        QCOMPARE(reader.channelCount(), audioFormat.channelCount());
+
+        std::thread writerThread([&]() {
+            for (int i = 0; i < frameCount; i++) {
+                QByteArray videoData(static_cast<qsizetype>(frameSize.width() * frameSize.height() * 4), static_cast<char>(i));
+                QAudioBuffer audioBuffer(audioFrameCount, audioFormat);
+                memset(audioBuffer.data<uint8_t>(), i, audioBuffer.byteCount());
+                if (!writer.write(audioBuffer, videoData))
+                    return;
+            }
+            writer.finish();
+        });
+
+        QList<uint64_t> sequences;
+        bool contentsValid = true;
+        while (auto frame = reader.acquire()) {
+            sequences.append(frame->sequence);
+            const auto expected = static_cast<uint8_t>(frame->sequence);
+            if (frame->videoByteSize != static_cast<size_t>(frameSize.width() * frameSize.height() * 4)
+                || frame->audioFrameCount != audioFrameCount
+                || frame->videoData[0] != expected || frame->videoData[frame->videoByteSize - 1] != expected // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+                || frame->audioData[0] != expected || frame->audioData[frame->audioByteSize - 1] != expected) // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+                contentsValid = false;
+            reader.release();
+        }
+        writerThread.join();
+
+        QVERIFY(contentsValid);
+        QCOMPARE(sequences.size(), frameCount);
+        for (int i = 0; i < frameCount; i++)
+            QCOMPARE(sequences.at(i), static_cast<uint64_t>(i));
+        // NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+    }
+
+    void readerOpensBeforeWriter()
+    {
+        // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+        const QString name = u"/tst_framering_early_%1"_s.arg(QCoreApplication::applicationPid());
+        FrameRingReader reader(name);
+        bool opened = false;
+        std::thread readerThread([&]() { opened = reader.open(5s); });
+
+        std::this_thread::sleep_for(50ms);
+        FrameRingWriter writer(name, 2);
+        QVERIFY(writer.open(QSize(16, 16), VideoPixelFormat_FFMPEG, AVRational { 30, 1 }, 44100));
+        readerThread.join();
+        QVERIFY(opened);
+        QCOMPARE(reader.frameSize(), QSize(16, 16));
+        // NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+    }
+
+    void readerOpenTimesOut()
+    {
+        FrameRingReader reader(u"/tst_framering_missing_%1"_s.arg(QCoreApplication::applicationPid()));
+        QVERIFY(!reader.open(50ms));
+    }
+
+    void writerFailsWithoutReader()
+    {
+        // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+        const QSize frameSize(16, 16);
+        FrameRingWriter writer(u"/tst_framering_noreader_%1"_s.arg(QCoreApplication::applicationPid()), 1, 50ms);
+        QVERIFY(writer.open(frameSize, VideoPixelFormat_FFMPEG, AVRational { 30, 1 }, 44100));
+        const QByteArray videoData(static_cast<qsizetype>(frameSize.width() * frameSize.height() * 4), 0);
+        // The first frame fills the ring, then there is no reader to release it
+        QVERIFY(writer.write(QAudioBuffer(), videoData));
+        QElapsedTimer timer;
+        timer.start();
+        QVERIFY(!writer.write(QAudioBuffer(), videoData));
+        QVERIFY(timer.elapsed() < 5000);
+        QVERIFY(!writer.finish());
+        // NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+    }
+
+    void writerFailsWhenReaderDetaches()
+    {
+        // NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+        const QString name = u"/tst_framering_detach_%1"_s.arg(QCoreApplication::applicationPid());
+        const QSize frameSize(16, 16);
+        FrameRingWriter writer(name, 1);
+        QVERIFY(writer.open(frameSize, VideoPixelFormat_FFMPEG, AVRational { 30, 1 }, 44100));
+        {
+            FrameRingReader reader(name);
+            QVERIFY(reader.open());
+        }
+        const QByteArray videoData(static_cast<qsizetype>(frameSize.width() * frameSize.height() * 4), 0);
+        QVERIFY(writer.write(QAudioBuffer(), videoData));
+        QVERIFY(!writer.write(QAudioBuffer(), videoData));
+        QVERIFY(!writer.finish());
+        // NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+    }
+};
+
+QTEST_GUILESS_MAIN(tst_FrameRing);
+#include "tst_framering.moc"
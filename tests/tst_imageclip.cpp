@@ -0,0 +1,86 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "formats.h"
+#include "image_clip.h"
+#include <QColor>
+#include <QImage>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QTemporaryDir>
+#include <QTestData>
+#include <QVideoFrame>
+#include <QtTest>
+#include <stdint.h>
+using namespace Qt::Literals::StringLiterals;
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+class tst_ImageClip : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tempDir;
+    QString m_imagePath;
+
+private slots:
+    void initTestCase()
+    {
+        QVERIFY(m_tempDir.isValid());
+        QImage image(40, 20, QImage::Format_ARGB32);
+        image.fill(QColor(255, 0, 0));
+        m_imagePath = m_tempDir.filePath(u"red.png"_s);
+        QVERIFY(image.save(m_imagePath));
+    }
+
+    void decodeImage()
+    {
+        QString errorMessage;
+        QVideoFrame videoFrame = ImageClip::decodeImage(m_imagePath, QSize(), errorMessage);
+        QVERIFY2(videoFrame.isValid(), qUtf8Printable(errorMessage));
+        QCOMPARE(videoFrame.size(), QSize(40, 20));
+        QCOMPARE(videoFrame.pixelFormat(), VideoPixelFormat_Qt);
+        QVERIFY(videoFrame.map(QVideoFrame::ReadOnly));
+        const uchar* pixel = videoFrame.bits(0);
+        QCOMPARE(pixel[0], uchar(255));
+        QCOMPARE(pixel[1], uchar(0));
+        QCOMPARE(pixel[2], uchar(0));
+        QCOMPARE(pixel[3], uchar(255));
+        videoFrame.unmap();
+    }
+
+    void sourceSize_data()
+    {
+        QTest::addColumn<QSize>("sourceSize");
+        QTest::addColumn<QSize>("expectedSize");
+
+        QTest::newRow("width") << QSize(20, 0) << QSize(20, 10);
+        QTest::newRow("height") << QSize(0, 5) << QSize(10, 5);
+        QTest::newRow("fit") << QSize(100, 5) << QSize(10, 5);
+        QTest::newRow("no upscale") << QSize(80, 80) << QSize(40, 20);
+    }
+
+    void sourceSize()
+    {
+        QFETCH(QSize, sourceSize);
+        QFETCH(QSize, expectedSize);
+
+        QString errorMessage;
+        QVideoFrame videoFrame = ImageClip::decodeImage(m_imagePath, sourceSize, errorMessage);
+        QVERIFY2(videoFrame.isValid(), qUtf8Printable(errorMessage));
+        QCOMPARE(videoFrame.size(), expectedSize);
+    }
+
+    void missing()
+    {
+        QString errorMessage;
+        QVERIFY(!ImageClip::decodeImage(m_tempDir.filePath(u"missing.png"_s), QSize(), errorMessage).isValid());
+        QVERIFY(!errorMessage.isEmpty());
+    }
+};
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+
+QTEST_APPLESS_MAIN(tst_ImageClip);
+#include "tst_imageclip.moc"
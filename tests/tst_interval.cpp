@@ -2,12 +2,16 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "interval.h"
+#include "interval_tree.h"
 #include <QDebug>
 #include <QObject>
 #include <QString>
 #include <QStringLiteral>
 #include <QtTest>
 #include <chrono>
+#include <random>
+#include <utility>
+#include <vector>
 using namespace std::chrono;
 using namespace std::chrono_literals;
 
@@ -47,6 +51,81 @@ private slots:
         dbg << Interval<microseconds>(100ms, 200ms); // NOLINT(cppcoreguidelines-avoid-magic-numbers)
         QCOMPARE(result, QStringLiteral("(100000us/100ms, 200000us/200ms) "));
     }
+
+    void intervalTree()
+    {
+        IntervalTree<int, milliseconds> tree;
+        tree.insert(Interval<milliseconds>(100ms, 200ms), 1);
+        tree.insert(Interval<milliseconds>(0ms, 50ms), 0);
+        tree.insert(Interval<milliseconds>(150ms, 300ms), 2);
+        QCOMPARE(tree.size(), size_t(3));
+
+        std::vector<int> values;
+        auto collect = [&values](const Interval<milliseconds>&, int value) { values.push_back(value); };
+        tree.forEachContaining(160ms, collect);
+        QCOMPARE(values, (std::vector<int> { 1, 2 }));
+        values.clear();
+        tree.forEachContaining(200ms, collect);
+        QCOMPARE(values, (std::vector<int> { 2 }));
+        values.clear();
+        tree.forEachOverlapping(Interval<milliseconds>(40ms, 100ms), collect);
+        QCOMPARE(values, (std::vector<int> { 0 }));
+
+        tree.removeIf([](const Interval<milliseconds>&, int value) { return value == 2; });
+        values.clear();
+        tree.forEachContaining(160ms, collect);
+        QCOMPARE(values, (std::vector<int> { 1 }));
+
+        // Querying a tree emptied by removeIf finds nothing
+        tree.removeIf([](const Interval<milliseconds>&, int) { return true; });
+        QVERIFY(tree.isEmpty());
+        values.clear();
+        tree.forEachContaining(160ms, collect);
+        tree.forEachOverlapping(Interval<milliseconds>(0ms, 1000ms), collect);
+        QVERIFY(values.empty());
+
+        // and it indexes new entries
+        tree.insert(Interval<milliseconds>(100ms, 200ms), 3);
+        tree.forEachContaining(160ms, collect);
+        QCOMPARE(values, (std::vector<int> { 3 }));
+    }
+
+    void intervalTreeRandom()
+    {
+        // Compare against a linear scan
+        std::mt19937 random(42); // NOLINT(cert-msc32-c,cert-msc51-cpp)
+        std::uniform_int_distribution<int> startDistribution(0, 10000);
+        std::uniform_int_distribution<int> durationDistribution(0, 500);
+        IntervalTree<int, milliseconds> tree;
+        std::vector<Interval<milliseconds>> intervals;
+        for (int i = 0; i < 1000; i++) {
+            milliseconds start(startDistribution(random));
+            Interval<milliseconds> interval(start, start + milliseconds(durationDistribution(random)));
+            intervals.push_back(interval);
+            tree.insert(interval, i);
+        }
+        for (int q = 0; q < 200; q++) {
+            milliseconds start(startDistribution(random));
+            Interval<milliseconds> query(start, start + milliseconds(durationDistribution(random)));
+            int expected = 0;
+            for (const auto& interval : intervals) {
+                if (interval.start() < query.end() && interval.end() > query.start())
+                    expected++;
+            }
+            // QCOMPARE can't return from the test inside the callback, so check the matches afterwards
+            std::vector<std::pair<Interval<milliseconds>, int>> found;
+            tree.forEachOverlapping(query, [&found](const Interval<milliseconds>& interval, int value) {
+                found.emplace_back(interval, value);
+            });
+            QCOMPARE(static_cast<int>(found.size()), expected);
+            milliseconds previousStart = 0ms;
+            for (const auto& [interval, value] : found) {
+                QCOMPARE(interval, intervals.at(static_cast<size_t>(value)));
+                QVERIFY(interval.start() >= previousStart);
+                previousStart = interval.start();
+            }
+        }
+    }
 };
 
 QTEST_APPLESS_MAIN(tst_Interval);
@@ -0,0 +1,73 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "latency_histogram.h"
+#include <QObject>
+#include <QtTest>
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+using namespace std::chrono;
+using namespace std::chrono_literals;
+
+class tst_LatencyHistogram : public QObject {
+    Q_OBJECT
+
+private slots:
+
+    void buckets()
+    {
+        for (uint64_t value = 0; value < 100000; value++) {
+            size_t index = LatencyHistogram::bucketIndex(value);
+            QVERIFY(index < LatencyHistogram::BucketCount);
+            QVERIFY(value <= LatencyHistogram::bucketUpperBound(index));
+            if (index > 0)
+                QVERIFY(value > LatencyHistogram::bucketUpperBound(index - 1));
+        }
+        QCOMPARE(LatencyHistogram::bucketIndex(UINT64_MAX), LatencyHistogram::BucketCount - 1);
+    }
+
+    void percentiles()
+    {
+        LatencyHistogram histogram;
+        for (int i = 1; i <= 1000; i++)
+            histogram.record(microseconds(i));
+        LatencyHistogram::Snapshot snapshot;
+        snapshot.add(histogram);
+        QCOMPARE(snapshot.count(), uint64_t(1000));
+        QCOMPARE(snapshot.max(), nanoseconds(1ms));
+        QCOMPARE(snapshot.percentile(100), nanoseconds(1ms));
+        // Buckets are accurate to 1/16
+        QVERIFY(snapshot.percentile(50) >= 500us && snapshot.percentile(50) <= 500us * 17 / 16);
+        QVERIFY(snapshot.percentile(99) >= 990us && snapshot.percentile(99) <= 1ms);
+
+        histogram.reset();
+        LatencyHistogram::Snapshot empty;
+        empty.add(histogram);
+        QCOMPARE(empty.count(), uint64_t(0));
+        QCOMPARE(empty.percentile(50), nanoseconds(0));
+    }
+
+    void threads()
+    {
+        LatencyHistogram histogram;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&histogram, t]() {
+                for (int i = 0; i < 10000; i++)
+                    histogram.record(nanoseconds(t * 10000 + i));
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        LatencyHistogram::Snapshot snapshot;
+        snapshot.add(histogram);
+        QCOMPARE(snapshot.count(), uint64_t(40000));
+        QCOMPARE(snapshot.max(), nanoseconds(39999));
+    }
+};
+
+QTEST_APPLESS_MAIN(tst_LatencyHistogram);
+#include "tst_latencyhistogram.moc"
@@ -0,0 +1,236 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "memory_accounting.h"
+#include "memory_governor.h"
+#include <QJsonObject>
+#include <QObject>
+#include <QString>
+#include <QtTest>
+#include <chrono>
+#include <memory>
+#include <stdint.h>
+#include <thread>
+#include <utility>
+#include <vector>
+using namespace Qt::Literals::StringLiterals;
+
+class tst_MemoryAccounting : public QObject {
+    Q_OBJECT
+
+private slots:
+
+    void account()
+    {
+        MemoryAccounting::Account parent;
+        MemoryAccounting::Account account(&parent);
+        account.add(MemoryAccounting::Category::VideoFrames, 1000);
+        account.add(MemoryAccounting::Category::Packets, 500);
+        account.add(MemoryAccounting::Category::VideoFrames, -1000);
+        account.add(MemoryAccounting::Category::Packets, 200);
+
+        QCOMPARE(account.liveBytes(MemoryAccounting::Category::VideoFrames), int64_t(0));
+        QCOMPARE(account.peakBytes(MemoryAccounting::Category::VideoFrames), int64_t(1000));
+        QCOMPARE(account.liveBytes(MemoryAccounting::Category::Packets), int64_t(700));
+        QCOMPARE(account.peakBytes(MemoryAccounting::Category::Packets), int64_t(700));
+        QCOMPARE(account.liveBytes(), int64_t(700));
+        // Peak total, not the sum of category peaks
+        QCOMPARE(account.peakBytes(), int64_t(1500));
+
+        QCOMPARE(parent.liveBytes(MemoryAccounting::Category::Packets), int64_t(700));
+        QCOMPARE(parent.peakBytes(), int64_t(1500));
+    }
+
+    void allocation()
+    {
+        MemoryAccounting::Account account;
+        {
+            MemoryAccounting::Allocation allocation(&account, MemoryAccounting::Category::Readback, 100);
+            QCOMPARE(account.liveBytes(MemoryAccounting::Category::Readback), int64_t(100));
+            allocation.resize(300);
+            QCOMPARE(account.liveBytes(MemoryAccounting::Category::Readback), int64_t(300));
+
+            MemoryAccounting::Allocation moved(std::move(allocation));
+            QCOMPARE(moved.bytes(), int64_t(300));
+            QCOMPARE(account.liveBytes(MemoryAccounting::Category::Readback), int64_t(300));
+
+            MemoryAccounting::Allocation other(&account, MemoryAccounting::Category::AudioBuffers, 50);
+            std::swap(moved, other);
+            QCOMPARE(moved.bytes(), int64_t(50));
+            QCOMPARE(account.liveBytes(), int64_t(350));
+
+            // Replacing releases the previous bytes, after the replacement was allocated
+            other = MemoryAccounting::Allocation(&account, MemoryAccounting::Category::Readback, 10);
+            QCOMPARE(account.liveBytes(MemoryAccounting::Category::Readback), int64_t(10));
+        }
+        QCOMPARE(account.liveBytes(), int64_t(0));
+        QCOMPARE(account.peakBytes(), int64_t(360));
+
+        // Null account is ignored
+        MemoryAccounting::Allocation unaccounted(nullptr, MemoryAccounting::Category::Readback, 100);
+        QCOMPARE(unaccounted.bytes(), int64_t(100));
+    }
+
+    void threads()
+    {
+        MemoryAccounting::Account account;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&account]() {
+                for (int i = 0; i < 10000; i++)
+                    MemoryAccounting::Allocation allocation(&account, MemoryAccounting::Category::CodecFrames, 10);
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        QCOMPARE(account.liveBytes(), int64_t(0));
+        QVERIFY(account.peakBytes() >= 10 && account.peakBytes() <= 40);
+    }
+
+    void clipAccounts()
+    {
+        MemoryAccounting::Account* account = MemoryAccounting::clipAccount(u"/tmp/a.nut"_s);
+        QCOMPARE(MemoryAccounting::clipAccount(u"/tmp/a.nut"_s), account);
+        QVERIFY(MemoryAccounting::clipAccount(u"/tmp/b.nut"_s) != account);
+
+        const int64_t sessionPeak = MemoryAccounting::session().peakBytes(MemoryAccounting::Category::FilterFrames);
+        {
+            MemoryAccounting::Allocation allocation(account, MemoryAccounting::Category::FilterFrames, 12345);
+            QCOMPARE(MemoryAccounting::session().liveBytes(MemoryAccounting::Category::FilterFrames), int64_t(12345));
+        }
+        QCOMPARE(MemoryAccounting::session().liveBytes(MemoryAccounting::Category::FilterFrames), int64_t(0));
+        QVERIFY(MemoryAccounting::session().peakBytes(MemoryAccounting::Category::FilterFrames) >= sessionPeak);
+
+        const QJsonObject json = MemoryAccounting::toJson();
+        const QJsonObject clip = json[u"clips"_s][u"/tmp/a.nut"_s].toObject();
+        QCOMPARE(clip[u"peakBytes"_s].toInteger(), qint64(12345));
+        QCOMPARE(clip[u"filterFrames"_s][u"peakBytes"_s].toInteger(), qint64(12345));
+        QCOMPARE(clip[u"filterFrames"_s][u"liveBytes"_s].toInteger(), qint64(0));
+        QVERIFY(json[u"session"_s][u"filterFrames"_s][u"peakBytes"_s].toInteger() >= 12345);
+    }
+
+    void createClipAccount()
+    {
+        MemoryAccounting::Account* sourceAccount = MemoryAccounting::clipAccount(u"/tmp/shared.nut"_s);
+        std::shared_ptr<MemoryAccounting::Account> first = MemoryAccounting::createClipAccount(u"/tmp/shared.nut"_s);
+        std::shared_ptr<MemoryAccounting::Account> second = MemoryAccounting::createClipAccount(u"/tmp/shared.nut"_s);
+        QVERIFY(first != second);
+
+        // Each clip counts only its own bytes, the source totals both
+        MemoryAccounting::Allocation firstAllocation(first.get(), MemoryAccounting::Category::VideoFrames, 100);
+        MemoryAccounting::Allocation secondAllocation(second.get(), MemoryAccounting::Category::VideoFrames, 200);
+        QCOMPARE(first->liveBytes(), int64_t(100));
+        QCOMPARE(second->liveBytes(), int64_t(200));
+        QCOMPARE(sourceAccount->liveBytes(MemoryAccounting::Category::VideoFrames), int64_t(300));
+
+        // A buffer holding a share of the account may release it after the clip is gone
+        std::weak_ptr<MemoryAccounting::Account> released = first;
+        {
+            std::shared_ptr<MemoryAccounting::Account> buffer = first;
+            first.reset();
+            firstAllocation.resize(0);
+            QVERIFY(!released.expired());
+        }
+        QVERIFY(released.expired());
+        QCOMPARE(sourceAccount->liveBytes(MemoryAccounting::Category::VideoFrames), int64_t(200));
+    }
+
+    void resetPeaks()
+    {
+        MemoryAccounting::Account* account = MemoryAccounting::clipAccount(u"/tmp/reset.nut"_s);
+        MemoryAccounting::Allocation live(account, MemoryAccounting::Category::Packets, 100);
+        {
+            MemoryAccounting::Allocation allocation(account, MemoryAccounting::Category::Packets, 5000);
+        }
+        QCOMPARE(account->peakBytes(MemoryAccounting::Category::Packets), int64_t(5100));
+
+        MemoryAccounting::resetPeaks();
+        QCOMPARE(account->peakBytes(MemoryAccounting::Category::Packets), int64_t(100));
+        QCOMPARE(account->peakBytes(), int64_t(100));
+        QCOMPARE(account->liveBytes(), int64_t(100));
+        QCOMPARE(MemoryAccounting::session().peakBytes(), MemoryAccounting::session().liveBytes());
+    }
+
+    void parseSize_data()
+    {
+        QTest::addColumn<QString>("size");
+        QTest::addColumn<qint64>("bytes");
+
+        QTest::newRow("bytes") << u"1000"_s << qint64(1000);
+        QTest::newRow("K") << u"4K"_s << qint64(4096);
+        QTest::newRow("m") << u"512m"_s << qint64(512) * 1024 * 1024;
+        QTest::newRow("G") << u"8G"_s << qint64(8) * 1024 * 1024 * 1024;
+        QTest::newRow("fraction") << u"1.5G"_s << qint64(3) * 512 * 1024 * 1024;
+        QTest::newRow("T") << u"1T"_s << qint64(1024) * 1024 * 1024 * 1024;
+        QTest::newRow("empty") << QString() << qint64(-1);
+        QTest::newRow("suffix only") << u"G"_s << qint64(-1);
+        QTest::newRow("negative") << u"-1G"_s << qint64(-1);
+        QTest::newRow("invalid") << u"8X"_s << qint64(-1);
+    }
+
+    void parseSize()
+    {
+        QFETCH(QString, size);
+        QFETCH(qint64, bytes);
+        QCOMPARE(static_cast<qint64>(MemoryGovernor::parseSize(size)), bytes);
+    }
+
+    void governor()
+    {
+        MemoryAccounting::Account* account = MemoryAccounting::clipAccount(u"/tmp/governor.nut"_s);
+        const int64_t baseline = MemoryAccounting::session().liveBytes();
+
+        QVERIFY(!MemoryGovernor::isOverLimit());
+        MemoryGovernor::setLimit(baseline + 1000);
+        MemoryAccounting::Allocation cached(account, MemoryAccounting::Category::VideoFrames, 800);
+        MemoryAccounting::Allocation held(account, MemoryAccounting::Category::VideoFrames, 100);
+        QVERIFY(!MemoryGovernor::isOverLimit());
+
+        // The evictor releases the cached allocation
+        int64_t requested = 0;
+        int id = MemoryGovernor::addEvictor([&](int64_t bytes) {
+            requested = bytes;
+            const int64_t released = cached.bytes();
+            cached.resize(0);
+            return released;
+        });
+        held.resize(300);
+        QVERIFY(!MemoryGovernor::isOverLimit());
+        QCOMPARE(requested, int64_t(100));
+        QCOMPARE(cached.bytes(), int64_t(0));
+
+        // Nothing left to evict
+        held.resize(2000);
+        QVERIFY(MemoryGovernor::isOverLimit());
+        held.resize(0);
+        QVERIFY(!MemoryGovernor::isOverLimit());
+
+        MemoryGovernor::removeEvictor(id);
+        MemoryGovernor::setLimit(0);
+    }
+
+    void leads()
+    {
+        MemoryGovernor::Lead nearLead;
+        MemoryGovernor::Lead farLead;
+        nearLead.set(40ms);
+        farLead.set(900ms);
+        QCOMPARE(MemoryGovernor::furthestLead().count(), microseconds(900ms).count());
+        // Under the limit nothing throttles
+        QVERIFY(!farLead.shouldThrottle());
+
+        MemoryGovernor::setLimit(MemoryAccounting::session().liveBytes() + 100);
+        MemoryAccounting::Allocation held(&MemoryAccounting::session(), MemoryAccounting::Category::VideoFrames, 200);
+        // The furthest ahead throttles first
+        QVERIFY(farLead.shouldThrottle());
+        QVERIFY(!nearLead.shouldThrottle());
+        // Then the next once it has nothing left to give up
+        farLead.set(0us);
+        QVERIFY(nearLead.shouldThrottle());
+
+        MemoryGovernor::setLimit(0);
+    }
+};
+
+QTEST_APPLESS_MAIN(tst_MemoryAccounting);
+#include "tst_memoryaccounting.moc"
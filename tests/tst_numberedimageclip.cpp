@@ -0,0 +1,161 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "image_decode_queue.h"
+#include "numbered_image_clip.h"
+#include "util.h"
+#include <QColor>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTestData>
+#include <QVideoFrame>
+#include <QtTest>
+#include <chrono>
+#include <stddef.h>
+extern "C" {
+#include <libavutil/rational.h>
+}
+using namespace std::chrono;
+using namespace Qt::Literals::StringLiterals;
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+class tst_NumberedImageClip : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tempDir;
+    QStringList m_imagePaths;
+
+    bool saveImage(const QString& name, int width)
+    {
+        QImage image(width, 10, QImage::Format_ARGB32);
+        image.fill(QColor(0, 0, 255));
+        return image.save(m_tempDir.filePath(name));
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QVERIFY(m_tempDir.isValid());
+        // Each image is a different width to identify it
+        for (int i = 0; i < 8; ++i) {
+            const QString name = u"shot.%1.png"_s.arg(i + 998, 3, 10, QChar(u'0'));
+            QVERIFY(saveImage(name, i + 1));
+            m_imagePaths.append(m_tempDir.filePath(name));
+        }
+        QVERIFY(saveImage(u"plain1.png"_s, 1));
+        QVERIFY(saveImage(u"plain2.png"_s, 1));
+        QVERIFY(saveImage(u"plain4.png"_s, 1));
+        QVERIFY(saveImage(u"still.png"_s, 1));
+    }
+
+    void sequenceFiles_data()
+    {
+        QTest::addColumn<QString>("firstFile");
+        QTest::addColumn<qsizetype>("expectedCount");
+
+        QTest::newRow("padding grows") << u"shot.998.png"_s << qsizetype(8);
+        QTest::newRow("start in middle") << u"shot.1003.png"_s << qsizetype(3);
+        QTest::newRow("stops at gap") << u"plain1.png"_s << qsizetype(2);
+    }
+
+    void sequenceFiles()
+    {
+        QFETCH(QString, firstFile);
+        QFETCH(qsizetype, expectedCount);
+
+        QString errorMessage;
+        const QStringList fileNames = NumberedImageClip::sequenceFiles(m_tempDir.filePath(firstFile), errorMessage);
+        QVERIFY2(!fileNames.isEmpty(), qUtf8Printable(errorMessage));
+        QCOMPARE(fileNames.size(), expectedCount);
+        QCOMPARE(fileNames.first(), m_tempDir.filePath(firstFile));
+    }
+
+    void sequenceFilesInvalid_data()
+    {
+        QTest::addColumn<QString>("firstFile");
+
+        QTest::newRow("missing") << u"missing.1.png"_s;
+        QTest::newRow("not numbered") << u"still.png"_s;
+    }
+
+    void sequenceFilesInvalid()
+    {
+        QFETCH(QString, firstFile);
+
+        QString errorMessage;
+        QVERIFY(NumberedImageClip::sequenceFiles(m_tempDir.filePath(firstFile), errorMessage).isEmpty());
+        QVERIFY(!errorMessage.isEmpty());
+    }
+
+    void imageIndexAt_data()
+    {
+        QTest::addColumn<int>("imageRate");
+        QTest::addColumn<int>("imageRateDen");
+        QTest::addColumn<QList<qsizetype>>("expectedIndexes");
+
+        // Output frames at 30fps
+        QTest::newRow("same rate") << 30 << 1 << QList<qsizetype> { 0, 1, 2, 3, 4, 5, 6 };
+        QTest::newRow("repeat") << 15 << 1 << QList<qsizetype> { 0, 0, 1, 1, 2, 2, 3 };
+        QTest::newRow("repeat uneven") << 24 << 1 << QList<qsizetype> { 0, 0, 1, 2, 3, 4, 4 };
+        QTest::newRow("skip") << 60 << 1 << QList<qsizetype> { 0, 2, 4, 6, 7, 7, 7 };
+        QTest::newRow("ntsc") << 30000 << 1001 << QList<qsizetype> { 0, 0, 1, 2, 3, 4, 5 };
+    }
+
+    void imageIndexAt()
+    {
+        QFETCH(int, imageRate);
+        QFETCH(int, imageRateDen);
+        QFETCH(QList<qsizetype>, expectedIndexes);
+
+        // Session frame times as NumberedImageClip plays them, truncated to microseconds
+        const auto frameDuration = frameRateToFrameDuration(AVRational { 30, 1 });
+        QList<qsizetype> indexes;
+        for (int frame = 0; frame < expectedIndexes.size(); ++frame)
+            indexes.append(NumberedImageClip::imageIndexAt(duration_cast<microseconds>(frame * frameDuration), AVRational { imageRate, imageRateDen }, 8));
+        QCOMPARE(indexes, expectedIndexes);
+    }
+
+    void decodeQueue_data()
+    {
+        QTest::addColumn<size_t>("threadCount");
+
+        QTest::newRow("inline") << size_t(0);
+        QTest::newRow("threads") << size_t(3);
+    }
+
+    void decodeQueue()
+    {
+        QFETCH(size_t, threadCount);
+
+        ImageDecodeQueue queue(m_imagePaths, QSize(), nullptr, threadCount, threadCount * 2);
+        QCOMPARE(queue.size(), m_imagePaths.size());
+        // Repeat an image and skip some
+        for (qsizetype index : { 0, 0, 1, 4, 5, 7 }) {
+            QString errorMessage;
+            QVideoFrame videoFrame = queue.frame(index, errorMessage);
+            QVERIFY2(videoFrame.isValid(), qUtf8Printable(errorMessage));
+            QCOMPARE(videoFrame.size(), QSize(static_cast<int>(index) + 1, 10));
+        }
+    }
+
+    void decodeQueueError()
+    {
+        ImageDecodeQueue queue({ m_imagePaths.first(), m_tempDir.filePath(u"missing.png"_s) }, QSize(), nullptr, 2, 4);
+        QString errorMessage;
+        QVERIFY(queue.frame(0, errorMessage).isValid());
+        QVERIFY(!queue.frame(1, errorMessage).isValid());
+        QVERIFY(!errorMessage.isEmpty());
+    }
+};
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+
+QTEST_APPLESS_MAIN(tst_NumberedImageClip);
+#include "tst_numberedimageclip.moc"
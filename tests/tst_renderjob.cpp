@@ -0,0 +1,130 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "render_context.h"
+#include "render_job.h"
+#include "rendition.h"
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QUrl>
+#include <QVariant>
+#include <QVariantMap>
+#include <QtTest>
+using namespace Qt::Literals::StringLiterals;
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+class tst_RenderJob : public QObject {
+    Q_OBJECT
+
+private:
+    static QJsonObject parse(const char* json)
+    {
+        return QJsonDocument::fromJson(json).object();
+    }
+
+private slots:
+    void defaults()
+    {
+        QString errorMessage;
+        auto job = RenderJob::fromJson(parse(R"({"source": "/tmp/demo.qml", "output": "/tmp/demo.nut"})"), errorMessage);
+        QVERIFY(job);
+        QCOMPARE(job->sourceUrl, QUrl::fromLocalFile(u"/tmp/demo.qml"_s));
+        QCOMPARE(job->outputFileName, u"/tmp/demo.nut"_s);
+        QCOMPARE(job->frameSize, QSize(640, 360));
+        QCOMPARE(job->frameRate, DefaultFrameRate);
+        QCOMPARE(job->sampleRate, DefaultSampleRate);
+        QVERIFY(job->renditions.isEmpty());
+        QCOMPARE(job->segmentFrames, 0);
+        QVERIFY(job->reportFileName.isEmpty());
+    }
+
+    void options()
+    {
+        QString errorMessage;
+        auto job = RenderJob::fromJson(parse(R"({"source": "demo.qml", "output": "/tmp/out-%05d.nut", "fps": "30000/1001", "size": "1280x720",
+            "sampleRate": 48000, "rendition": ["320x180:bgra:/tmp/small.nut"], "segmentDuration": 2, "report": "/tmp/report.json"})"),
+            errorMessage);
+        QVERIFY2(job, qUtf8Printable(errorMessage));
+        // Relative to the working directory
+        QCOMPARE(job->sourceUrl, QUrl::fromLocalFile(QDir::current().absoluteFilePath(u"demo.qml"_s)));
+        QCOMPARE(job->frameSize, QSize(1280, 720));
+        QCOMPARE(job->frameRate, (Rational { 30000, 1001 }));
+        QCOMPARE(job->sampleRate, 48000);
+        QCOMPARE(job->renditions.size(), 1);
+        QCOMPARE(job->renditions.first(), Rendition(QSize(320, 180), u"bgra"_s, u"/tmp/small.nut"_s));
+        QCOMPARE(job->segmentFrames, 60);
+        QCOMPARE(job->manifestFileName, u"/tmp/manifest.ffconcat"_s);
+        QCOMPARE(job->reportFileName, u"/tmp/report.json"_s);
+
+        // Numeric fps
+        job = RenderJob::fromJson(parse(R"({"source": "/tmp/demo.qml", "output": "/tmp/demo.nut", "fps": 25})"), errorMessage);
+        QVERIFY(job);
+        QCOMPARE(job->frameRate, (Rational { 25, 1 }));
+    }
+
+    void properties()
+    {
+        QString errorMessage;
+        auto job = RenderJob::fromJson(parse(R"({"source": "demo.qml", "output": "out/demo.nut", "properties": {"title": "Intro", "count": 3}})"),
+            errorMessage, QDir(u"/tmp/batch"_s));
+        QVERIFY2(job, qUtf8Printable(errorMessage));
+        // Relative to the batch manifest directory
+        QCOMPARE(job->sourceUrl, QUrl::fromLocalFile(u"/tmp/batch/demo.qml"_s));
+        QCOMPARE(job->outputFileName, u"/tmp/batch/out/demo.nut"_s);
+        QCOMPARE(job->initialProperties.value(u"title"_s), QVariant(u"Intro"_s));
+        QCOMPARE(job->initialProperties.value(u"count"_s).toInt(), 3);
+
+        RenderContext renderContext;
+        job->applyTo(&renderContext);
+        QCOMPARE(renderContext.initialProperties(), job->initialProperties);
+    }
+
+    void invalid_data()
+    {
+        QTest::addColumn<QString>("json");
+
+        QTest::newRow("no source") << uR"({"output": "/tmp/demo.nut"})"_s;
+        QTest::newRow("no output") << uR"({"source": "/tmp/demo.qml"})"_s;
+        QTest::newRow("stdout") << uR"({"source": "/tmp/demo.qml", "output": "-"})"_s;
+        QTest::newRow("fps") << uR"({"source": "/tmp/demo.qml", "output": "/tmp/demo.nut", "fps": "fast"})"_s;
+        QTest::newRow("size") << uR"({"source": "/tmp/demo.qml", "output": "/tmp/demo.nut", "size": "big"})"_s;
+        QTest::newRow("sampleRate") << uR"({"source": "/tmp/demo.qml", "output": "/tmp/demo.nut", "sampleRate": 0})"_s;
+        QTest::newRow("rendition") << uR"({"source": "/tmp/demo.qml", "output": "/tmp/demo.nut", "rendition": ["320x180"]})"_s;
+        QTest::newRow("segmentFrames") << uR"({"source": "/tmp/demo.qml", "output": "/tmp/demo.nut", "segmentFrames": -1})"_s;
+        QTest::newRow("properties") << uR"({"source": "/tmp/demo.qml", "output": "/tmp/demo.nut", "properties": ["title"]})"_s;
+    }
+
+    void invalid()
+    {
+        QFETCH(QString, json);
+
+        QString errorMessage;
+        QVERIFY(!RenderJob::fromJson(QJsonDocument::fromJson(json.toUtf8()).object(), errorMessage));
+        QVERIFY(!errorMessage.isEmpty());
+    }
+
+    void applyTo()
+    {
+        QString errorMessage;
+        auto job = RenderJob::fromJson(parse(R"({"source": "/tmp/demo.qml", "output": "/tmp/demo.nut", "size": "320x180", "fps": 25, "sampleRate": 48000, "framesPerEvent": 4})"), errorMessage);
+        QVERIFY(job);
+        RenderContext renderContext;
+        job->applyTo(&renderContext);
+        QCOMPARE(renderContext.sourceUrl(), job->sourceUrl);
+        QCOMPARE(renderContext.outputFileName(), job->outputFileName);
+        QCOMPARE(renderContext.frameSize(), QSize(320, 180));
+        QCOMPARE(renderContext.frameRate(), (Rational { 25, 1 }));
+        QCOMPARE(renderContext.sampleRate(), 48000);
+        QCOMPARE(renderContext.framesPerEvent(), 4);
+    }
+};
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+
+QTEST_APPLESS_MAIN(tst_RenderJob);
+#include "tst_renderjob.moc"
@@ -0,0 +1,183 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QByteArray>
+#include <QDeadlineTimer>
+#include <QFile>
+#include <QIODevice>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QLocalSocket>
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTestData>
+#include <QtTest>
+#include <chrono>
+using namespace std::chrono_literals;
+using namespace Qt::Literals::StringLiterals;
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+// Runs the mediafx serve and encoder --batch commands built alongside this test, MEDIAFX_PATH
+class tst_RenderServer : public QObject {
+    Q_OBJECT
+
+private:
+    static constexpr int JobTimeout = 120000;
+
+    static QByteArray readFile(const QString& fileName)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+            return QByteArray();
+        return file.readAll();
+    }
+
+    // The server listens once its RenderWindow is created
+    static bool connectToServer(QLocalSocket& socket, const QString& socketPath)
+    {
+        QDeadlineTimer deadline(30s);
+        while (!deadline.hasExpired()) {
+            socket.connectToServer(socketPath);
+            if (socket.waitForConnected(100))
+                return true;
+            QTest::qWait(100);
+        }
+        return false;
+    }
+
+    static QJsonObject request(int id, const QString& outputFileName)
+    {
+        return QJsonObject {
+            { u"id"_s, id },
+            { u"source"_s, QFINDTESTDATA("qml/video-clipstart.qml") },
+            { u"output"_s, outputFileName },
+            { u"fps"_s, 15 },
+            { u"size"_s, u"320x180"_s },
+        };
+    }
+
+private slots:
+    void serve()
+    {
+        QTemporaryDir tempDir;
+        QVERIFY(tempDir.isValid());
+        const QString socketPath = tempDir.filePath(u"mediafx.sock"_s);
+
+        QProcess server;
+        server.setProcessChannelMode(QProcess::ForwardedChannels);
+        // Without the frame cache, so both jobs decode their clip
+        server.start(QString::fromUtf8(MEDIAFX_PATH), { u"serve"_s, u"--frameCache"_s, u"0"_s, socketPath });
+        QVERIFY(server.waitForStarted());
+
+        QLocalSocket socket;
+        QVERIFY(connectToServer(socket, socketPath));
+        const QStringList outputFileNames { tempDir.filePath(u"job1.nut"_s), tempDir.filePath(u"job2.nut"_s) };
+        for (int id : { 1, 2 })
+            socket.write(QJsonDocument(request(id, outputFileNames.at(id - 1))).toJson(QJsonDocument::Compact) + '\n');
+        QVERIFY(socket.waitForBytesWritten());
+
+        // Jobs are answered in the order they were queued
+        QList<QJsonObject> responses;
+        while (responses.size() < 2 && socket.waitForReadyRead(JobTimeout)) {
+            while (socket.canReadLine())
+                responses.append(QJsonDocument::fromJson(socket.readLine()).object());
+        }
+        server.kill();
+        server.waitForFinished();
+
+        QCOMPARE(responses.size(), 2);
+        for (int id : { 1, 2 }) {
+            const QJsonObject& response = responses.at(id - 1);
+            QCOMPARE(response[u"id"_s].toInt(), id);
+            QCOMPARE(response[u"status"_s].toString(), u"ok"_s);
+            QCOMPARE(response[u"exitCode"_s].toInt(), 0);
+            QVERIFY(response[u"elapsedMs"_s].toInteger() > 0);
+        }
+
+        // Nothing from the first job may leak into the second
+        const QByteArray firstOutput = readFile(outputFileNames.at(0));
+        QVERIFY(!firstOutput.isEmpty());
+        QVERIFY(firstOutput == readFile(outputFileNames.at(1)));
+    }
+
+    void batchFrameCache()
+    {
+        QTemporaryDir tempDir;
+        QVERIFY(tempDir.isValid());
+        // Relative to the manifest directory
+        const QJsonArray jobs {
+            QJsonObject { { u"output"_s, u"first.nut"_s }, { u"report"_s, u"first.json"_s } },
+            QJsonObject { { u"output"_s, u"second.nut"_s }, { u"report"_s, u"second.json"_s } },
+        };
+        const QString manifestFileName = tempDir.filePath(u"manifest.json"_s);
+        QFile manifestFile(manifestFileName);
+        QVERIFY(manifestFile.open(QIODevice::WriteOnly));
+        manifestFile.write(QJsonDocument(jobs).toJson());
+        manifestFile.close();
+
+        QProcess batch;
+        batch.setProcessChannelMode(QProcess::ForwardedChannels);
+        batch.start(QString::fromUtf8(MEDIAFX_PATH), { u"encoder"_s, u"--exitOnWarning"_s, u"--fps"_s, u"15"_s, u"--size"_s, u"320x180"_s, u"--batch"_s, manifestFileName, QFINDTESTDATA("qml/video-clipstart.qml") });
+        QVERIFY(batch.waitForFinished(JobTimeout));
+        QCOMPARE(batch.exitStatus(), QProcess::NormalExit);
+        QCOMPARE(batch.exitCode(), 0);
+
+        // The first job decodes the clip, the second plays it from the frame cache without reading the source
+        const QJsonObject firstReport = QJsonDocument::fromJson(readFile(tempDir.filePath(u"first.json"_s))).object();
+        const QJsonObject secondReport = QJsonDocument::fromJson(readFile(tempDir.filePath(u"second.json"_s))).object();
+        QVERIFY(firstReport[u"bytesRead"_s].toInteger() > 0);
+        QCOMPARE(secondReport[u"bytesRead"_s].toInteger(), 0);
+        QCOMPARE(secondReport[u"frames"_s].toInteger(), firstReport[u"frames"_s].toInteger());
+
+        const QByteArray firstOutput = readFile(tempDir.filePath(u"first.nut"_s));
+        QVERIFY(!firstOutput.isEmpty());
+        QVERIFY(firstOutput == readFile(tempDir.filePath(u"second.nut"_s)));
+    }
+
+    void staticSceneSkipsFrames()
+    {
+        QTemporaryDir tempDir;
+        QVERIFY(tempDir.isValid());
+        const QJsonArray jobs {
+            QJsonObject { { u"output"_s, u"skipped.nut"_s }, { u"report"_s, u"skipped.json"_s } },
+            QJsonObject { { u"output"_s, u"rendered.nut"_s }, { u"report"_s, u"rendered.json"_s }, { u"properties"_s, QJsonObject { { u"forceRender"_s, true } } } },
+        };
+        const QString manifestFileName = tempDir.filePath(u"manifest.json"_s);
+        QFile manifestFile(manifestFileName);
+        QVERIFY(manifestFile.open(QIODevice::WriteOnly));
+        manifestFile.write(QJsonDocument(jobs).toJson());
+        manifestFile.close();
+
+        QProcess batch;
+        batch.setProcessChannelMode(QProcess::ForwardedChannels);
+        batch.start(QString::fromUtf8(MEDIAFX_PATH), { u"encoder"_s, u"--exitOnWarning"_s, u"--fps"_s, u"15"_s, u"--size"_s, u"320x180"_s, u"--batch"_s, manifestFileName, QFINDTESTDATA("qml/static-hold.qml") });
+        QVERIFY(batch.waitForFinished(JobTimeout));
+        QCOMPARE(batch.exitStatus(), QProcess::NormalExit);
+        QCOMPARE(batch.exitCode(), 0);
+
+        // Only the first frames of the held card are rendered, unless every frame is forced to render
+        const QJsonObject skippedReport = QJsonDocument::fromJson(readFile(tempDir.filePath(u"skipped.json"_s))).object();
+        const QJsonObject renderedReport = QJsonDocument::fromJson(readFile(tempDir.filePath(u"rendered.json"_s))).object();
+        const qint64 frames = skippedReport[u"frames"_s].toInteger();
+        QVERIFY(frames > 1);
+        QVERIFY(skippedReport[u"skippedFrames"_s].toInteger() > frames / 2);
+        QCOMPARE(renderedReport[u"skippedFrames"_s].toInteger(), 0);
+        QCOMPARE(renderedReport[u"frames"_s].toInteger(), frames);
+
+        // Reused frames are identical to rendered ones
+        const QByteArray skippedOutput = readFile(tempDir.filePath(u"skipped.nut"_s));
+        QVERIFY(!skippedOutput.isEmpty());
+        QVERIFY(skippedOutput == readFile(tempDir.filePath(u"rendered.nut"_s)));
+    }
+};
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+
+QTEST_GUILESS_MAIN(tst_RenderServer);
+#include "tst_renderserver.moc"
@@ -0,0 +1,119 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "tracer.h"
+#include <QByteArray>
+#include <QFile>
+#include <QIODevice>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QObject>
+#include <QString>
+#include <QTemporaryDir>
+#include <QtGlobal>
+#include <QtTest>
+#include <stdint.h>
+#include <thread>
+using namespace Qt::Literals::StringLiterals;
+
+class tst_Tracer : public QObject {
+    Q_OBJECT
+
+private:
+    QJsonArray readEvents(const QString& fileName)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+            return QJsonArray();
+        return QJsonDocument::fromJson(file.readAll()).object().value(u"traceEvents"_s).toArray();
+    }
+
+    QJsonObject findSpan(const QJsonArray& events, const QString& name)
+    {
+        for (const auto& event : events) {
+            QJsonObject object = event.toObject();
+            if (object.value(u"ph"_s).toString() == u"X"_s && object.value(u"name"_s).toString() == name)
+                return object;
+        }
+        return QJsonObject();
+    }
+
+private slots:
+
+    void disabled()
+    {
+        QVERIFY(!Tracer::isEnabled());
+        {
+            Tracer::Context context(u"source.mp4"_s, 1);
+            Tracer::Span span("disabled");
+            QCOMPARE(Tracer::currentFrame(), int64_t(-1));
+        }
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QString fileName = dir.filePath(u"trace.json"_s);
+        Tracer::start();
+        QVERIFY(Tracer::finish(fileName));
+        QVERIFY(findSpan(readEvents(fileName), u"disabled"_s).isEmpty());
+    }
+
+    void spans()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QString fileName = dir.filePath(u"trace.json"_s);
+
+        Tracer::start();
+        {
+            Tracer::Context context(u"source.mp4"_s, 7);
+            Tracer::Span outer("outer");
+            {
+                Tracer::Context frameContext(8);
+                Tracer::Span inner("inner");
+                QCOMPARE(Tracer::currentFrame(), int64_t(8));
+            }
+            QCOMPARE(Tracer::currentFrame(), int64_t(7));
+        }
+        QCOMPARE(Tracer::currentFrame(), int64_t(-1));
+        std::thread thread([]() {
+            Tracer::setThreadName(u"worker"_s);
+            Tracer::Span span("threaded");
+        });
+        thread.join();
+        QVERIFY(Tracer::finish(fileName));
+        QVERIFY(!Tracer::isEnabled());
+
+        QJsonArray events = readEvents(fileName);
+        QJsonObject outer = findSpan(events, u"outer"_s);
+        QJsonObject inner = findSpan(events, u"inner"_s);
+        QJsonObject threaded = findSpan(events, u"threaded"_s);
+        QVERIFY(!outer.isEmpty());
+        QVERIFY(!inner.isEmpty());
+        QVERIFY(!threaded.isEmpty());
+
+        QCOMPARE(outer.value(u"args"_s).toObject().value(u"source"_s).toString(), u"source.mp4"_s);
+        QCOMPARE(outer.value(u"args"_s).toObject().value(u"frame"_s).toInteger(), qint64(7));
+        QCOMPARE(inner.value(u"args"_s).toObject().value(u"source"_s).toString(), u"source.mp4"_s);
+        QCOMPARE(inner.value(u"args"_s).toObject().value(u"frame"_s).toInteger(), qint64(8));
+        QVERIFY(threaded.value(u"args"_s).toObject().isEmpty());
+
+        // Inner span is nested within outer, allowing for rounding
+        const double outerStart = outer.value(u"ts"_s).toDouble();
+        const double innerStart = inner.value(u"ts"_s).toDouble();
+        QVERIFY(innerStart >= outerStart);
+        QVERIFY(innerStart + inner.value(u"dur"_s).toDouble() <= outerStart + outer.value(u"dur"_s).toDouble() + 0.001);
+
+        QVERIFY(threaded.value(u"tid"_s) != outer.value(u"tid"_s));
+        bool foundThreadName = false;
+        for (const auto& event : events) {
+            QJsonObject object = event.toObject();
+            if (object.value(u"ph"_s).toString() == u"M"_s && object.value(u"tid"_s) == threaded.value(u"tid"_s))
+                foundThreadName = object.value(u"args"_s).toObject().value(u"name"_s).toString() == u"worker"_s;
+        }
+        QVERIFY(foundThreadName);
+    }
+};
+
+QTEST_APPLESS_MAIN(tst_Tracer);
+#include "tst_tracer.moc"
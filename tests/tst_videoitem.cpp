@@ -0,0 +1,85 @@
+// Copyright (C) 2024 Andrew Wason
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "formats.h"
+#include "video_frame_texture.h"
+#include "video_item.h"
+#include <QObject>
+#include <QSize>
+#include <QVideoFrame>
+#include <QVideoFrameFormat>
+#include <QtTest>
+#include <memory>
+#include <rhi/qrhi.h>
+#include <string.h>
+#include <vector>
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+class tst_VideoItem : public QObject {
+    Q_OBJECT
+
+private:
+    static QVideoFrame createVideoFrame(const QSize& size, int value)
+    {
+        QVideoFrame videoFrame(QVideoFrameFormat(size, VideoPixelFormat_Qt));
+        if (videoFrame.map(QVideoFrame::WriteOnly)) {
+            memset(videoFrame.bits(0), value, videoFrame.mappedBytes(0));
+            videoFrame.unmap();
+        }
+        return videoFrame;
+    }
+
+    static void renderItems(QRhi* rhi, const std::vector<std::shared_ptr<VideoFrameTexture>>& itemTextures)
+    {
+        // Each item's material commits the texture operations when drawn
+        for (const auto& texture : itemTextures) {
+            QRhiResourceUpdateBatch* resourceUpdates = rhi->nextResourceUpdateBatch();
+            texture->commitTextureOperations(rhi, resourceUpdates);
+            resourceUpdates->release();
+        }
+    }
+
+private slots:
+    void sharedTextureUploadsOnce()
+    {
+        QRhiNullInitParams params;
+        std::unique_ptr<QRhi> rhi(QRhi::create(QRhi::Null, &params));
+        QVERIFY(rhi);
+
+        const int itemCount = 3;
+        std::weak_ptr<VideoFrameTexture> sharedTexture;
+        std::vector<std::shared_ptr<VideoFrameTexture>> itemTextures;
+
+        QVideoFrame videoFrame = createVideoFrame(QSize(8, 4), 1);
+        for (int i = 0; i < itemCount; i++)
+            itemTextures.push_back(VideoItem::syncSharedTexture(sharedTexture, videoFrame));
+        for (const auto& texture : itemTextures)
+            QCOMPARE(texture.get(), itemTextures.front().get());
+        QCOMPARE(itemTextures.front()->textureSize(), QSize(8, 4));
+        renderItems(rhi.get(), itemTextures);
+        QCOMPARE(itemTextures.front()->uploadCount(), 1);
+
+        // Rendering the same frame again does not upload it
+        for (int i = 0; i < itemCount; i++)
+            VideoItem::syncSharedTexture(sharedTexture, videoFrame);
+        renderItems(rhi.get(), itemTextures);
+        QCOMPARE(itemTextures.front()->uploadCount(), 1);
+
+        videoFrame = createVideoFrame(QSize(16, 8), 2);
+        for (int i = 0; i < itemCount; i++)
+            VideoItem::syncSharedTexture(sharedTexture, videoFrame);
+        renderItems(rhi.get(), itemTextures);
+        QCOMPARE(itemTextures.front()->uploadCount(), 2);
+        QCOMPARE(itemTextures.front()->textureSize(), QSize(16, 8));
+
+        // The texture is released with the last item's node
+        itemTextures.clear();
+        QVERIFY(sharedTexture.expired());
+    }
+};
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+
+QTEST_MAIN(tst_VideoItem);
+#include "tst_videoitem.moc"
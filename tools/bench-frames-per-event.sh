@@ -0,0 +1,42 @@
+#!/usr/bin/env bash
+# Copyright (C) 2024 Andrew Wason
+# SPDX-License-Identifier: GPL-3.0-or-later
+usage="$0 <mediafxpath> <qml-file> [WxH] [frames-per-event...]"
+
+# Measures per frame event loop overhead removed by --framesPerEvent.
+# Every run renders the same frames, output is discarded.
+# Times come from the --report session time, so process and QML startup are excluded.
+# Each value is run RUNS times (default 5) and the median and spread are reported.
+
+MEDIAFX=${1:?$usage}
+QML=${2:?$usage}
+shift 2
+SIZE=${1:-160x90}
+(( $# )) && shift
+BATCHES=${*:-1 2 4 8 16}
+RUNS=${RUNS:-5}
+
+REPORTS=$(mktemp -d) || exit 1
+trap 'rm -rf "${REPORTS}"' EXIT
+
+echo "${QML} ${SIZE}, median of ${RUNS} runs"
+printf "%16s %8s %10s %10s %10s %12s %22s\n" framesPerEvent frames seconds min max "us/frame" "vs first"
+
+BASELINE=
+for N in ${BATCHES}; do
+    for (( RUN = 0; RUN < RUNS; RUN++ )); do
+        "${MEDIAFX}" encoder --size "${SIZE}" --framesPerEvent "${N}" --report "${REPORTS}/${N}-${RUN}.json" "${QML}" /dev/null || exit 1
+    done
+    RESULT=$(python3 -c '
+import json, statistics, sys
+reports = [json.load(open(path)) for path in sys.argv[3:]]
+seconds = [report["seconds"] for report in reports]
+frames = reports[0]["frames"]
+median = statistics.median(seconds)
+baseline = float(sys.argv[2]) if sys.argv[2] else median
+print("{} {:16d} {:8d} {:10.3f} {:10.3f} {:10.3f} {:12.1f} {:+12.1f} us/frame".format(
+    median, int(sys.argv[1]), frames, median, min(seconds), max(seconds), median / frames * 1e6, (median - baseline) / frames * 1e6))
+' "${N}" "${BASELINE}" "${REPORTS}/${N}"-*.json) || exit 1
+    : ${BASELINE:=${RESULT%% *}}
+    echo "${RESULT#* }"
+done
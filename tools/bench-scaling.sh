@@ -0,0 +1,65 @@
+#!/usr/bin/env bash
+# Copyright (C) 2024 Andrew Wason
+# SPDX-License-Identifier: GPL-3.0-or-later
+usage="$0 <mediafxpath> <corpusdir> <resultsdir> [axis...]"
+
+# Renders each scene generated by tools/generate-bench-corpus.sh, output is discarded.
+# Writes fps and peak RSS from the --report JSON to <resultsdir>/<axis>.csv
+# and plots the scaling curves to <resultsdir>/<axis>.png if gnuplot is installed.
+# Run headless with builders/Linux/docker-run.sh, which runs under Xvfb.
+
+MEDIAFX=${1:?$usage}
+CORPUS=${2:?$usage}
+RESULTS=${3:?$usage}
+shift 3
+AXES=${*:-clips resolution transitions audio sequence}
+SIZE=640x360
+RESOLUTIONS="640x360 1280x720 1920x1080 3840x2160"
+
+mkdir -p "${RESULTS}" || exit 1
+
+run() {
+    local axis=$1 value=$2 qml=$3 size=$4
+    local report="${RESULTS}/${axis}-${value}.json"
+    "${MEDIAFX}" encoder --size "${size}" --report "${report}" "${qml}" /dev/null || exit 1
+    python3 -c '
+import json, sys
+report = json.load(open(sys.argv[3]))
+print("{},{},{},{:.2f},{:.1f}".format(sys.argv[1], sys.argv[2], report["frames"], report["fps"], report["peakRssBytes"] / 1048576))
+' "${axis}" "${value}" "${report}" | tee -a "${RESULTS}/${axis}.csv"
+}
+
+plot() {
+    local axis=$1
+    command -v gnuplot > /dev/null || return 0
+    gnuplot <<EOF
+set terminal pngcairo size 800,500
+set output "${RESULTS}/${axis}.png"
+set datafile separator ","
+set key autotitle columnhead
+set title "${axis}"
+set xlabel "${axis}"
+set ylabel "fps"
+set y2label "peak RSS (MiB)"
+set ytics nomirror
+set y2tics
+set yrange [0:*]
+set y2range [0:*]
+plot "${RESULTS}/${axis}.csv" using 4:xtic(2) with linespoints axes x1y1, \
+     "" using 5:xtic(2) with linespoints axes x1y2
+EOF
+}
+
+for AXIS in ${AXES}; do
+    echo "axis,value,frames,fps,peakRssMiB" > "${RESULTS}/${AXIS}.csv"
+    if [ "${AXIS}" == "resolution" ]; then
+        for RESOLUTION in ${RESOLUTIONS}; do
+            run "${AXIS}" "${RESOLUTION}" "${CORPUS}/resolution.qml" "${RESOLUTION}"
+        done
+    else
+        for VALUE in $(cd "${CORPUS}" && ls "${AXIS}"-*.qml | sed -e "s/^${AXIS}-//" -e "s/\.qml$//" | sort -n); do
+            run "${AXIS}" "${VALUE}" "${CORPUS}/${AXIS}-${VALUE}.qml" "${SIZE}"
+        done
+    fi
+    plot "${AXIS}"
+done
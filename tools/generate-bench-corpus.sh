@@ -0,0 +1,162 @@
+#!/usr/bin/env bash
+# Copyright (C) 2024 Andrew Wason
+# SPDX-License-Identifier: GPL-3.0-or-later
+usage="$0 <outputdir>"
+
+# Generates QML scenes that each scale along a single axis, for tools/bench-scaling.sh.
+# Scenes are named <axis>-<value>.qml:
+#   clips        simultaneous clips tiled in a grid, each decoding its own stream
+#   resolution   a 4 clip grid, the driver varies the output size
+#   transitions  8 one second clips in a MediaSequence, value is the percentage of each clip in a GL transition
+#   audio        one clip mixed through a chain of value AudioRenderers
+#   sequence     value clips in a MediaSequence, splitting the same 3.2 seconds
+
+BASE=$(cd "${BASH_SOURCE%/*}"; pwd)
+ASSETS="${BASE}/../tests/fixtures/assets"
+OUTPUT=${1:?$usage}
+VIDEO="red-640x360-30fps-4s-rms44100.nut"
+
+if [ ! -f "${ASSETS}/${VIDEO}" ]; then
+    echo "$0: missing ${ASSETS}/${VIDEO}, run tools/generate-assets.sh"
+    exit 1
+fi
+mkdir -p "${OUTPUT}" || exit 1
+SOURCE="file://$(cd "${ASSETS}"; pwd)/${VIDEO}"
+
+TRANSITIONS=(Bounce Burn CrossZoom Dreamy Mosaic Ripple Swirl WaterDrop)
+
+header() {
+    cat <<EOF
+// Generated by tools/generate-bench-corpus.sh
+
+import QtQuick
+import MediaFX
+EOF
+}
+
+grid() {
+    local count=$1 columns=1
+    while (( columns * columns < count )); do
+        (( columns++ ))
+    done
+    header
+    cat <<EOF
+
+Grid {
+    id: root
+
+    columns: ${columns}
+
+    Component.onCompleted: clip0.clipEnded.connect(root.RenderSession.session.endSession)
+EOF
+    for (( i = 0; i < count; i++ )); do
+        cat <<EOF
+
+    MediaClip {
+        id: clip${i}
+
+        endTime: 3000
+        source: "${SOURCE}"
+        audioRenderer: AudioRenderer {}
+    }
+    VideoRenderer {
+        width: root.width / ${columns}
+        height: root.height / ${columns}
+        mediaClip: clip${i}
+    }
+EOF
+    done
+    echo "}"
+}
+
+sequence() {
+    local count=$1 clipDuration=$2 transitionDuration=$3
+    header
+    [ "${transitionDuration}" -gt 0 ] && echo "import MediaFX.Transition.GL"
+    cat <<EOF
+
+MediaSequence {
+    id: sequence
+
+    Component.onCompleted: sequence.mediaSequenceEnded.connect(sequence.RenderSession.session.endSession)
+EOF
+    for (( i = 0; i < count; i++ )); do
+        # Each clip seeks to a different part of the source.
+        # MediaSequence only transitions clips that start after 0
+        local startTime=$(( 500 + (i * clipDuration) % 3000 ))
+        cat <<EOF
+
+    Component {
+        MediaSequenceClip {
+            startTime: ${startTime}
+            endTime: $(( startTime + clipDuration ))
+            source: "${SOURCE}"
+            audioRenderer: AudioRenderer {}
+EOF
+        if [ "${transitionDuration}" -gt 0 ]; then
+            cat <<EOF
+            endTransition: ${TRANSITIONS[i % ${#TRANSITIONS[@]}]} {
+                duration: ${transitionDuration}
+            }
+EOF
+        fi
+        cat <<EOF
+        }
+    }
+EOF
+    done
+    echo "}"
+}
+
+audio() {
+    local depth=$1
+    header
+    cat <<EOF
+
+Item {
+    id: root
+
+    AudioRenderer {
+        id: bus1
+
+        volume: 0.9
+    }
+EOF
+    for (( i = 2; i <= depth; i++ )); do
+        cat <<EOF
+    AudioRenderer {
+        id: bus${i}
+
+        volume: 0.9
+        upstreamRenderer: bus$(( i - 1 ))
+    }
+EOF
+    done
+    cat <<EOF
+    MediaClip {
+        id: clip
+
+        endTime: 3000
+        source: "${SOURCE}"
+        audioRenderer: bus${depth}
+
+        Component.onCompleted: clip.clipEnded.connect(root.RenderSession.session.endSession)
+    }
+    VideoRenderer {
+        anchors.fill: parent
+        mediaClip: clip
+    }
+}
+EOF
+}
+
+for N in 1 2 4 8 16 32; do
+    grid "${N}" > "${OUTPUT}/clips-${N}.qml" || exit 1
+    audio "${N}" > "${OUTPUT}/audio-${N}.qml" || exit 1
+    sequence "${N}" $(( 3200 / N )) 0 > "${OUTPUT}/sequence-${N}.qml" || exit 1
+done
+grid 4 > "${OUTPUT}/resolution.qml" || exit 1
+for PERCENT in 0 25 50 75 100; do
+    sequence 8 1000 $(( PERCENT * 10 )) > "${OUTPUT}/transitions-${PERCENT}.qml" || exit 1
+done
+echo "Generated $(ls "${OUTPUT}"/*.qml | wc -l) scenes in ${OUTPUT}"